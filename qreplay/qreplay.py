@@ -0,0 +1,289 @@
+#=============================================================================
+# QReplay stand-in Target replaying QS captures into QSPY
+# Copyright (C) 2005 Quantum Leaps, LLC. All rights reserved.
+#
+# SPDX-License-Identifier: GPL-3.0-or-later OR LicenseRef-QL-commercial
+#
+# This software is dual-licensed under the terms of the open source GNU
+# General Public License version 3 (or any later version), or alternatively,
+# under the terms of one of the closed source Quantum Leaps commercial
+# licenses.
+#
+# The terms of the open source GNU General Public License version 3
+# can be found at: <www.gnu.org/licenses/gpl-3.0>
+#
+# The terms of the closed source Quantum Leaps commercial licenses
+# can be found at: <www.state-machine.com/licensing>
+#
+# Redistributions in source code must retain this top-level comment block.
+# Plagiarizing this software to sidestep the license obligations is illegal.
+#
+# Contact information:
+# <www.state-machine.com>
+# <info@state-machine.com>
+#=============================================================================
+##
+# @date Last updated on: 2022-07-27
+# @version Last updated for version: 7.0.0
+#
+# @file
+# @brief QReplay stand-in Target replaying QS captures into QSPY
+# @ingroup qtools
+
+import select
+import socket
+import sys
+import time
+
+from platform import python_version
+
+#=============================================================================
+## @brief QS capture (binary file saved by "qspy -s") split into frames
+#
+# The frames are kept decoded (without the transparency), so that they can
+# be re-numbered when the capture is replayed more than once.
+class Capture:
+    ## the HDLC-like framing of the QS protocol
+    _FRAME = 0x7E
+    _ESC   = 0x7D
+    _ESC_XOR = 0x20
+
+    ## QS_TARGET_INFO, sent by the Target after its reset
+    _TARGET_INFO = 64
+
+    ## QS records that carry the time stamp right after the record ID
+    # (the QP records up to QS_TEST_PAUSED except the state-machine topology
+    # (1..3, 55..57), QS_QEP_UNHANDLED, QS_QF_TICK, and
+    # QS_QF_TIMEEVT_AUTO_DISARM; QS_TEST_PROBE_GET, QS_TARGET_DONE,
+    # QS_QUERY_DATA, QS_PEEK_DATA, QS_ASSERT_FAIL, and all user records)
+    _TSTAMP_RECS = frozenset(
+        [r for r in range(4, 55) if r not in (9, 31, 33)]
+        + [59, 65, 67, 68, 69] + list(range(100, 125)))
+
+    def __init__(self, data, tstamp_size=4):
+        ## decoded frames without the sequence number and the checksum
+        self.bodies = []
+        ## the time stamp of each frame (None if the record has none)
+        self.tstamps = []
+        ## frames dropped because of bad checksums
+        self.bad = 0
+
+        tmask = (1 << (8*tstamp_size)) - 1
+        for raw in data.split(bytes([Capture._FRAME])):
+            if not raw:
+                continue
+            frame = Capture._unescape(raw)
+            if len(frame) < 3 or (sum(frame) & 0xFF) != 0xFF:
+                self.bad += 1
+                continue
+            body = frame[1:-1] # record ID + data
+            self.bodies.append(body)
+            if body[0] in Capture._TSTAMP_RECS \
+                and len(body) > tstamp_size:
+                self.tstamps.append(int.from_bytes(
+                    body[1:1+tstamp_size], "little") & tmask)
+            else:
+                self.tstamps.append(None)
+        self._tmask = tmask
+
+    @staticmethod
+    def _unescape(raw):
+        if Capture._ESC not in raw:
+            return raw
+        out = bytearray()
+        esc = False
+        for b in raw:
+            if esc:
+                out.append(b ^ Capture._ESC_XOR)
+                esc = False
+            elif b == Capture._ESC:
+                esc = True
+            else:
+                out.append(b)
+        return bytes(out)
+
+    @staticmethod
+    def escape(data):
+        return data.replace(b"\x7D", b"\x7D\x5D").replace(b"\x7E", b"\x7D\x5E")
+
+    ## the delta times [tstamp units] between the consecutive frames
+    # (0 for frames without time stamps), wrapping around the counter
+    # (the time stamps restart after a Target reset)
+    def deltas(self):
+        out = []
+        prev = None
+        for body, t in zip(self.bodies, self.tstamps):
+            if body[0] == Capture._TARGET_INFO:
+                prev = None
+            if t is None or prev is None:
+                out.append(0)
+            else:
+                out.append((t - prev) & self._tmask)
+            if t is not None:
+                prev = t
+        return out
+
+
+#=============================================================================
+## @brief stand-in Target connected to the QSPY TCP input (qspy -t)
+class QReplay:
+    ## current version of QReplay
+    VERSION = 700
+
+    ## the shortest sleep worth taking [s]; earlier frames go in one send
+    _SLEEP_MIN = 0.001
+
+    ## the largest chunk handed over to a single send()
+    _CHUNK_MAX = 64*1024
+
+    def __init__(self, capture, speed=1.0, tstamp_hz=0, loops=1):
+        self._cap = capture
+        self._loops = loops
+        # seconds per time stamp unit at the requested speed, 0 for no pacing
+        self._sec_per_tick = 0.0
+        if speed > 0.0 and tstamp_hz > 0:
+            self._sec_per_tick = 1.0 / (tstamp_hz * speed)
+
+        # the frames keep their escaped bodies, only the sequence numbers
+        # and checksums change between the loops
+        self._esc = [Capture.escape(b) for b in capture.bodies]
+        self._sum = [sum(b) & 0xFF for b in capture.bodies]
+        self._seq = 0
+        self.frames = 0
+        self.bytes = 0
+        self.h2t = 0
+
+    def _frame(self, i):
+        self._seq = (self._seq + 1) & 0xFF
+        seq = self._seq
+        chk = ~(seq + self._sum[i]) & 0xFF
+        return b"".join((Capture.escape(bytes([seq])), self._esc[i],
+                         Capture.escape(bytes([chk])), b"\x7E"))
+
+    def _drain(self, sock):
+        # the commands from QSPY (e.g., reset) are accepted and discarded
+        # (select() rather than MSG_DONTWAIT, which Windows lacks)
+        try:
+            while select.select([sock], [], [], 0)[0]:
+                data = sock.recv(4096)
+                if not data:
+                    break
+                self.h2t += len(data)
+        except InterruptedError:
+            pass
+
+    def run(self, sock):
+        deltas = self._cap.deltas()
+        n = len(self._esc)
+        loop = 0
+        start = time.perf_counter()
+        due = 0.0 # [s] since the start when the next frame is due
+        while self._loops == 0 or loop < self._loops:
+            i = 0
+            while i < n:
+                # collect all frames due by now (or up to the chunk size)
+                now = time.perf_counter() - start
+                chunk = []
+                size = 0
+                while i < n and size < QReplay._CHUNK_MAX:
+                    t = due + deltas[i]*self._sec_per_tick
+                    if t > now and chunk: # not yet due?
+                        break
+                    due = t
+                    frame = self._frame(i)
+                    chunk.append(frame)
+                    size += len(frame)
+                    i += 1
+                if chunk:
+                    sock.sendall(b"".join(chunk))
+                    self.frames += len(chunk)
+                    self.bytes += size
+                    self._drain(sock)
+                if i < n:
+                    wait = due + deltas[i]*self._sec_per_tick \
+                           - (time.perf_counter() - start)
+                    if wait >= QReplay._SLEEP_MIN:
+                        time.sleep(wait)
+            loop += 1
+        return time.perf_counter() - start
+
+
+#=============================================================================
+def main():
+    # process command-line arguments...
+    argv = sys.argv
+    argc = len(argv)
+    arg  = 1 # skip the "qreplay" argument
+
+    if "-h" in argv or "--help" in argv or "?" in argv or argc < 2:
+        print("\nusage: python qreplay.py [-x <speed>|max] [-r <tstamp_Hz>]"
+              " [-T <tstamp_size>] [-l <loops>] <capture_file>"
+              " [qspy_host[:tcp_port]]\n\n"
+              "-x <speed>|max  1   pace at N-times real time, or no pacing\n"
+              "-r <tstamp_Hz>      QS time stamp clock, required for pacing\n"
+              "-T <tstamp_size> 4  QS time stamp size (bytes)\n"
+              "-l <loops>       1  replays of the capture, 0 forever\n"
+              "qspy_host[:tcp_port] localhost:6601  the qspy -t input")
+        return sys.exit(0)
+
+    print("QReplay stand-in Target %d.%d.%d running on Python %s"%(
+            QReplay.VERSION//100,
+            (QReplay.VERSION//10) % 10,
+             QReplay.VERSION % 10, python_version()))
+    print("Copyright (c) 2005-2022 Quantum Leaps, www.state-machine.com")
+
+    speed = 1.0
+    tstamp_hz = 0
+    tstamp_size = 4
+    loops = 1
+    while arg + 1 < argc and argv[arg] in ("-x", "-r", "-T", "-l"):
+        opt, val = argv[arg], argv[arg + 1]
+        if opt == "-x":
+            speed = 0.0 if val == "max" else float(val)
+        elif opt == "-r":
+            tstamp_hz = float(val)
+        elif opt == "-T":
+            tstamp_size = int(val)
+        else:
+            loops = int(val)
+        arg += 2
+    if arg >= argc:
+        print("capture file missing")
+        return sys.exit(-1)
+
+    with open(argv[arg], "rb") as f:
+        capture = Capture(f.read(), tstamp_size)
+    arg += 1
+    host, port = "localhost", 6601
+    if arg < argc:
+        host_port = argv[arg].split(":")
+        host = host_port[0] or host
+        if len(host_port) > 1:
+            port = int(host_port[1])
+
+    if speed > 0.0 and tstamp_hz == 0:
+        print("no -r <tstamp_Hz> given, replaying at the maximum rate")
+        speed = 0.0
+    print("Capture: %d frames (%d bad), pacing: %s"%(
+          len(capture.bodies), capture.bad,
+          "%gx real time"%(speed) if speed > 0.0 else "max"))
+
+    replay = QReplay(capture, speed, tstamp_hz, loops)
+    try:
+        sock = socket.create_connection((host, port))
+        sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        elapsed = replay.run(sock)
+        sock.close()
+    except (OSError, KeyboardInterrupt) as err:
+        print("Stopped:", err)
+        return sys.exit(-1)
+
+    print("Sent: %d frames, %d bytes in %.3f s (%.0f frames/s, %.2f MB/s),"
+          " received %d bytes"%(replay.frames, replay.bytes, elapsed,
+          replay.frames/elapsed if elapsed > 0 else 0.0,
+          replay.bytes/elapsed/1e6 if elapsed > 0 else 0.0, replay.h2t))
+    return sys.exit(0)
+
+#=============================================================================
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,33 @@
+#!/usr/bin/env python
+'''
+Setup script.
+To build qreplay install:
+[sudo] python setup.py sdist bdist_wheel
+'''
+
+from setuptools import setup
+
+setup(
+    name="qreplay",
+    version="7.0.0",
+    author="Quantum Leaps",
+    author_email="info@state-machine.com",
+    description="qreplay stand-in Target replaying QS captures",
+    long_description=open("README.md").read(),
+    long_description_content_type="text/markdown",
+    url="https://www.state-machine.com/qtools/qspy.html",
+    license="GPL/commercial",
+    platforms="any",
+    py_modules=["qreplay"],
+    entry_points={"console_scripts": ["qreplay = qreplay:main"]},
+    classifiers=["Development Status :: 5 - Production/Stable",
+                 "Intended Audience :: Developers",
+                 "Topic :: Software Development :: Embedded Systems",
+                 "License :: OSI Approved :: GNU General Public License v3 or later (GPLv3+)",
+                 "License :: Other/Proprietary License",
+                 "Operating System :: Microsoft :: Windows",
+                 "Operating System :: POSIX :: Linux",
+                 "Operating System :: MacOS :: MacOS X",
+                 "Programming Language :: Python",
+                 "Programming Language :: Python :: 3"],
+)
@@ -43,7 +43,10 @@ int  BE_parseRecFromTarget(QSpyRecord * const qrec); /*see QSPY_CustParseFun*/
 
 void BE_onStartup(void);
 void BE_onCleanup(void);
+void BE_onDetach(int fe);   /* the PAL lost the connection to the Front-End */
 void BE_sendLine(void);     /* send the QSPY parsed line to the Front-End */
+void BE_flush(void);        /* flush the batched lines to the Front-End */
+void BE_sendDecoded(QSpyDecoded const * const dec); /* pre-decoded record */
 
 #ifdef __cplusplus
 }
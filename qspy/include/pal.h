@@ -44,7 +44,8 @@ typedef enum {
     QSPY_FE_INPUT_EVT,
     QSPY_KEYBOARD_EVT,
     QSPY_DONE_EVT,
-    QSPY_ERROR_EVT
+    QSPY_ERROR_EVT,
+    QSPY_TIMER_EVT   /* the periodic timer ticked (see PAL_setTimer()) */
 } QSPYEvtType;
 
 /* The PAL "virtual table" contains operations that are dependent
@@ -66,13 +67,26 @@ typedef int      enum_t;
 typedef float    float32_t;
 typedef double   float64_t;
 
+enum {
+    PAL_FE_MAX = 8  /* max # Front-Ends attached at the same time */
+};
+
 QSpyStatus PAL_openBE(int portNum); /* open Back-End socket */
+QSpyStatus PAL_openBEUnix(char const *path); /* Unix-domain Back-End */
+QSpyStatus PAL_openBETcp(int portNum); /* TCP Back-End (stream framing) */
+QSpyStatus PAL_configShmFE(int fe,  /* shared-memory ring to the FE */
+                           bool shm);
 void PAL_closeBE(void);             /* close Back-End socket */
-void PAL_send2FE(unsigned char const *buf, uint32_t nBytes); /* to Front-End */
-void PAL_detachFE(void);            /* detach Front-End */
+void PAL_send2FE(int fe,            /* to the given Front-End */
+                 unsigned char const *buf, uint32_t nBytes);
+void PAL_flushBE(void);             /* write out the coalesced packets */
+void PAL_detachFE(int fe);          /* detach the given Front-End */
+int  PAL_currFE(void);              /* Front-End of the last BE packet */
 void PAL_clearScreen(void);
 
 QSpyStatus PAL_openTargetSer(char const *comName, int baudRate);
+void PAL_configSer(int vmin, int vtime); /* before PAL_openTargetSer() */
+QSpyStatus PAL_configRxThread(uint32_t *pRingKB); /* before PAL_openTarget*/
 QSpyStatus PAL_openTargetTcp(int portNum);
 QSpyStatus PAL_openTargetFile(char const *fName);
 QSpyStatus PAL_openTargetRtt(char const *coreName, uint32_t const serNo);
@@ -82,7 +96,8 @@ void       PAL_closeKbd(void);
 
 QSPYEvtType PAL_receiveBe (unsigned char *buf, uint32_t *pBytes);
 QSPYEvtType PAL_receiveKbd(unsigned char *buf, uint32_t *pBytes);
-void PAL_updateReadySet(int targetConn);
+QSpyStatus PAL_setTimer(uint32_t periodMs); /* QSPY_TIMER_EVT, 0 stops */
+uint64_t   PAL_rxTimeUs(void); /* host receipt of the last Target data */
 
 #ifdef __cplusplus
 }
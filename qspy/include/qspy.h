@@ -59,7 +59,7 @@ enum {
     QS_RECORD_SIZE_MAX  = 512,  /* max QS record size [bytes] */
     QS_LINE_LEN_MAX     = 1000, /* max length of a QSPY line [chars] */
     QS_FNAME_LEN_MAX    = 256,  /* max length of filenames [chars] */
-    QS_SEQ_LIST_LEN_MAX = 300,  /* max length of the Seq list [chars] */
+    QS_SEQ_LIST_LEN_MAX = 2048, /* max length of the Seq list [chars] */
     QS_DNAME_LEN_MAX    = 64,   /* max dictionary name length [chars] */
 };
 
@@ -121,26 +121,91 @@ uint32_t QSPY_encodeResetCmd(uint8_t *dstBuf, uint32_t dstSize);
 uint32_t QSPY_encodeInfoCmd (uint8_t *dstBuf, uint32_t dstSize);
 uint32_t QSPY_encodeTickCmd (uint8_t *dstBuf, uint32_t dstSize, uint8_t rate);
 
+/*! helper macro to insert an un-escaped byte into the QSPY buffer
+* (expects dst, dstBuf, and dstSize in scope, returns 0 on overflow)
+*/
+#define QSPY_INSERT_BYTE(b_)                       \
+    *dst++ = (b_);                                 \
+    if ((uint32_t)(dst - &dstBuf[0]) >= dstSize) { \
+        return 0U;                                 \
+    }
+
+/*! helper macro to insert an escaped byte into the QS buffer
+* (also expects chksum in scope and QS_FRAME etc. from "qpc_qs_pkg.h")
+*/
+#define QSPY_INSERT_ESC_BYTE(b_)                  \
+    chksum = (uint8_t)(chksum + (b_));            \
+    if (((b_) != QS_FRAME) && ((b_) != QS_ESC)) { \
+        QSPY_INSERT_BYTE(b_)                      \
+    }                                             \
+    else {                                        \
+        QSPY_INSERT_BYTE(QS_ESC)                  \
+        QSPY_INSERT_BYTE((uint8_t)((b_) ^ QS_ESC_XOR)) \
+    }
+
 SigType QSPY_findSig(char const *name, ObjType obj);
 KeyType QSPY_findObj(char const *name);
 KeyType QSPY_findFun(char const *name);
 KeyType QSPY_findUsr(char const *name);
 
+/* the object a QS record is about (e.g., the state machine, the receiving
+* active object, the event queue or pool, or the time event), without
+* consuming the record; 0 for records not about a single object
+*/
+KeyType QSpyRecord_getObj(QSpyRecord const * const me);
+
+/* the timestamp of a QS record without consuming the record;
+* false for records without a timestamp (e.g., the dictionaries)
+*/
+bool QSpyRecord_getTstamp(QSpyRecord const * const me, uint32_t *pTstamp);
+
 void QSPY_cleanup(void); /* cleanup after the run */
 
 char const* QSPY_tstampStr(void);
 
 void QSPY_onPrintLn(void); /* callback to print the last line of output */
 
+/* callback for every healthy QS record before it is processed */
+void QSPY_onRecord(QSpyRecord const * const qrec);
+
+/*! pre-decoded QS record in the fixed, host-endian layout
+*
+* The arguments of a pre-defined QS record as decoded by QSPY (the same as
+* in the MATLAB output): the numeric arguments go to num[] and the object
+* and function pointers (normalized to 64 bits) go to key[]. The names are
+* IDs of the strings interned by the Back-End (0 for none).
+*
+* NOTE: the layout is free of padding and corresponds to the Python
+* struct format "=BBBBI5II3Q3II" (72 bytes)
+*/
+typedef struct {
+    uint8_t  rec;        /*!< the record-ID (see enum QSpyRecords in qs.h) */
+    uint8_t  sigIdx;     /*!< 1 + index of the signal in num[], 0 for none */
+    uint8_t  sigObjIdx;  /*!< 1 + index of the signal scope in key[], 0 global*/
+    uint8_t  reserved;
+    uint32_t tstamp;     /*!< timestamp (0 for records without it) */
+    uint32_t num[5];     /*!< numeric arguments */
+    uint32_t sigName;    /*!< name-ID of the signal */
+    uint64_t key[3];     /*!< object and function pointers */
+    uint32_t keyName[3]; /*!< name-IDs of the key[] */
+    uint32_t pad;
+} QSpyDecoded;
+
+/* callback to output the last QS record in the pre-decoded form */
+void QSPY_onDecoded(QSpyDecoded const * const dec);
+
 /* prints information message to the QSPY output (without sending it to FE) */
 void QSPY_printInfo(void);
 
 /* prints error message to the QSPY output (sending it to FE) */
 void QSPY_printError(void);
 
+/* prints statistics to the QSPY output (sending it to the requesting FE) */
+void QSPY_printStat(void);
+
 /* last human-readable line of output from QSPY ............................*/
 #define QS_LINE_OFFSET  8
-enum QSPY_LastOutputType { REG_OUT, INF_OUT, ERR_OUT };
+enum QSPY_LastOutputType { REG_OUT, INF_OUT, ERR_OUT, STAT_OUT };
 typedef struct {
     char buf[QS_LINE_OFFSET + QS_LINE_LEN_MAX];
     int  len;  /* the length of the composed string */
@@ -278,7 +343,15 @@ typedef enum {
     QSPY_SEND_AO_FILTER,  /*!< send Local Filter (QSPY supplying addr) */
     QSPY_SEND_CURR_OBJ,   /*!< send current Object (QSPY supplying addr) */
     QSPY_SEND_COMMAND,    /*!< send command (QSPY supplying cmdId) */
-    QSPY_SEND_TEST_PROBE  /*!< send Test-Probe (QSPY supplying apiId) */
+    QSPY_SEND_TEST_PROBE, /*!< send Test-Probe (QSPY supplying apiId) */
+    QSPY_TEXT_BATCH,      /*!< batch of text lines (QSPY to Front-End) */
+    QSPY_SUBSCRIBE,       /*!< subscribe the Front-End to records/objects */
+    QSPY_ACK,             /*!< cumulative acknowledgement (reliable mode) */
+    QSPY_NACK,            /*!< retransmit request / resync (reliable mode) */
+    QSPY_DECODED,         /*!< batch of pre-decoded records (QSPY to FE) */
+    QSPY_STR_TABLE,       /*!< interned strings (QSPY to Front-End) */
+    QSPY_STATS,           /*!< report the statistics to the Front-End */
+    QSPY_TRIGGER          /*!< trigger the flight-recorder dump in QSPY */
     /* ... */
 } QSpyCommands;
 
@@ -293,6 +366,7 @@ QSpyStatus QSPY_readDict(void);
 QSpyStatus QSPY_writeDict(void);
 
 bool QDIC_isActive(void);
+void QDIC_writeFile(FILE *dictFile);
 
 void Dictionary_write(Dictionary const* const me, FILE* stream);
 bool Dictionary_read(Dictionary* const me, FILE* stream);
@@ -301,7 +375,16 @@ void SigDictionary_write(SigDictionary const* const me, FILE* stream);
 bool SigDictionary_read(SigDictionary* const me, FILE* stream);
 char const* QSPY_getMatDict(char const* s);
 
+/* Sequence diagram output formats */
+typedef enum {
+    QSEQ_ASCII,    /* ASCII-art lanes (*.seq) */
+    QSEQ_PLANTUML, /* PlantUML (*.puml) */
+    QSEQ_MERMAID,  /* Mermaid (*.mmd) */
+} QSeqFormat;
+
 void QSEQ_configFile(void *seqFile);
+bool QSEQ_configFormat(char const *ext);
+char const *QSEQ_fileExt(void);
 bool QSEQ_isActive(void);
 void QSEQ_config(void* seqFile, const char* seqList);
 void QSEQ_updateDictionary(char const* name, KeyType key);
@@ -316,6 +399,29 @@ void QSEQ_genAnnotation(uint32_t tstamp, int obj, char const* ann);
 void QSEQ_genTick(uint32_t rate, uint32_t nTick);
 void QSEQ_dictionaryReset(void);
 
+/* Statistics and analytics of the QS data */
+void QSTAT_config(uint32_t tstampHz);
+void QSTAT_configOutlier(uint32_t outlierUs);
+void QSTAT_configLeak(uint32_t leakMs);
+void QSTAT_configCpu(uint32_t windowMs);
+void QSTAT_configCpuFile(void *cpuFile);
+void QSTAT_writeGraph(void *graphFile);
+void QSTAT_onRxChunk(uint64_t rxUs);
+void QSTAT_onRecord(QSpyRecord const * const qrec);
+void QSTAT_onDecoded(QSpyDecoded const * const dec);
+void QSTAT_report(void);
+double QSTAT_usPerTick(void);
+
+/* flight recorder of the raw QS data */
+QSpyStatus QFREC_config(uint32_t ringMB, uint32_t postPct);
+QSpyStatus QFREC_configTrigger(char const *spec);
+void QFREC_onRxChunk(uint8_t const *buf, uint32_t nBytes);
+void QFREC_onRecord(QSpyRecord const * const qrec);
+void QFREC_onDecoded(QSpyDecoded const * const dec);
+void QFREC_onPrintLn(char const *line);
+void QFREC_trigger(char const *what);
+void QFREC_cleanup(void);
+
 #endif /* QSPY_APP */
 
 #ifdef __cplusplus
@@ -33,18 +33,45 @@
 #ifndef RTT_LINK_H
 #define RTT_LINK_H
 
+#include <stdatomic.h>
+
 #ifndef RTT_QSPY_BUFFER_NAME
 #define RTT_QSPY_BUFFER_NAME "qspy"
 #endif /* RTT_QSPY_BUFFER_NAME */
 
 /**
- * Data about J-Link + fd for connection to the 'main' thread of QSPY
+ * Single-producer/single-consumer ring for the data from the target
+ * (written by the rtt_link_worker() thread, read by the 'main' thread)
+ */
+typedef struct {
+	uint8_t *buf;
+	uint32_t size; /* must be a power of 2 */
+	_Atomic uint32_t head; /* bytes written (by the worker) */
+	_Atomic uint32_t tail; /* bytes read (by the 'main' thread) */
+	_Atomic uint32_t highWater; /* the most bytes in the ring */
+	_Atomic uint32_t overruns; /* times the ring was full */
+	_Atomic int done; /* the worker is about to exit */
+	_Atomic int stop; /* the 'main' thread asks the worker to exit */
+	int wakeFd[2]; /* eventfd (both the same) or pipe to wake up 'main' */
+	int drained; /* 'main' cleared the wake-up, owns it (only 'main') */
+} rtt_ring_t;
+
+/**
+ * Data about J-Link + the connection to the 'main' thread of QSPY
+ *
+ * @note The worker writes the ring and then wakes up the 'main' thread
+ *  only if the ring was empty before, the 'main' thread clears the wake-up
+ *  only after it found the ring empty. So the wake-up is pending whenever
+ *  the ring holds data, except after the 'main' thread cleared it: until
+ *  the ring is empty again, the 'main' thread wakes up itself when it
+ *  leaves data in the ring. Wake-ups are 8-byte writes, as required by
+ *  eventfd.
  */
 typedef struct {
 	char const *device;
 	uint32_t serNo;
-	int fdT2H[2];
-	int fdH2T[2];	
+	rtt_ring_t t2h;
+	int fdH2T[2];
 } rtt_link_worker_arg_t;
 
 /**
@@ -0,0 +1,317 @@
+/*============================================================================
+* QP/C Real-Time Embedded Framework (RTEF)
+* Copyright (C) 2005 Quantum Leaps, LLC. All rights reserved.
+*
+* SPDX-License-Identifier: GPL-3.0-or-later OR LicenseRef-QL-commercial
+*
+* This software is dual-licensed under the terms of the open source GNU
+* General Public License version 3 (or any later version), or alternatively,
+* under the terms of one of the closed source Quantum Leaps commercial
+* licenses.
+*
+* The terms of the open source GNU General Public License version 3
+* can be found at: <www.gnu.org/licenses/gpl-3.0>
+*
+* The terms of the closed source Quantum Leaps commercial licenses
+* can be found at: <www.state-machine.com/licensing>
+*
+* Redistributions in source code must retain this top-level comment block.
+* Plagiarizing this software to sidestep the license obligations is illegal.
+*
+* Contact information:
+* <www.state-machine.com>
+* <info@state-machine.com>
+============================================================================*/
+/*!
+* @date Last updated on: 2022-07-27
+* @version Last updated for version: 7.0.0
+*
+* @file
+* @brief Mock of the J-Link shared library for testing the RTT link (POSIX)
+* @ingroup qpspy
+*
+* Stands in for libjlinkarm.so with only the exports used by rtt_link.c.
+* The "target" serves a QS stream over the RTT channel "qspy" and accepts
+* the host->target writes. Configured by the environment variables:
+*
+* JLINK_MOCK_FILE  recorded QS stream to serve (e.g., saved by qspy -s),
+*                  a synthetic stream of QS_USER records otherwise
+* JLINK_MOCK_LOOPS times to serve the stream (default 1, 0 forever)
+* JLINK_MOCK_BPS   bandwidth of the link [bytes/s] (default 0, unlimited)
+* JLINK_MOCK_H2T   file to append the host->target writes to
+*
+* Usage: JLINK_SHARED_LIB=rel/libjlinkarm.so qspy -j <any_device>
+* The throughput is reported to stderr when QSPY closes the J-Link.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <time.h>
+#include <rtt_link.h>
+
+#include "safe_std.h" /* "safe" <stdio.h> and <string.h> facilities */
+
+#define MOCK_SER_NO		123456U /* serial number of the only J-Link */
+#define MOCK_SYNTH_RECS	1000U /* records in the synthetic stream */
+#define MOCK_START_POLLS	3 /* RTT_CMD_GETNUMBUF not ready at first */
+
+static struct {
+	uint8_t *stream; /* the QS stream to serve */
+	uint32_t len; /* length of the stream */
+	uint32_t pos; /* position within the stream */
+	uint32_t loops; /* loops left to serve, 0 forever */
+	uint64_t bps; /* bandwidth, 0 unlimited */
+	FILE *h2t; /* log of the host->target writes */
+	int startPolls; /* RTT_CMD_GETNUMBUF polls left until ready */
+	uint64_t t0; /* time of the first read [ns] */
+	uint64_t t1; /* time of the last data read [ns] */
+	uint64_t sent; /* bytes served */
+	uint64_t rcvd; /* bytes written by the host */
+} mock;
+
+/* Helpers =================================================================*/
+
+/**
+ * @return	monotonic time [ns]
+ */
+static uint64_t mock_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000U) + (uint64_t)ts.tv_nsec;
+}
+/**
+ * Append a byte of a QS frame (with the transparency)
+ */
+static uint32_t mock_put(uint8_t *buf, uint32_t n, uint8_t b) {
+	if ((b == 0x7EU) || (b == 0x7DU)) { /* QS_FRAME or QS_ESC? */
+		buf[n++] = 0x7DU; /* QS_ESC */
+		b ^= 0x20U; /* QS_ESC_XOR */
+	}
+	buf[n++] = b;
+	return n;
+}
+/**
+ * Synthetic stream: QS_USER records with a 4-byte timestamp and a U32
+ * counter, as produced by QS_BEGIN_ID(QS_USER, 0U) QS_U32(0, n) QS_END()
+ */
+static void mock_synth(void) {
+	uint32_t const maxLen = MOCK_SYNTH_RECS * 2U * 13U; /* all escaped */
+	uint32_t i, n = 0U;
+
+	mock.stream = malloc(maxLen);
+	if (mock.stream == NULL) {
+		return;
+	}
+	for (i = 0U; i < MOCK_SYNTH_RECS; i++) {
+		uint8_t rec[11];
+		uint8_t sum = 0U;
+		uint32_t k;
+
+		rec[0] = (uint8_t)(i + 1U); /* sequence number */
+		rec[1] = 100U; /* QS_USER */
+		rec[2] = (uint8_t)(i * 100U); /* time stamp (little endian) */
+		rec[3] = (uint8_t)((i * 100U) >> 8);
+		rec[4] = (uint8_t)((i * 100U) >> 16);
+		rec[5] = (uint8_t)((i * 100U) >> 24);
+		rec[6] = 5U; /* QS_U32_T, width 0 */
+		rec[7] = (uint8_t)i;
+		rec[8] = (uint8_t)(i >> 8);
+		rec[9] = (uint8_t)(i >> 16);
+		rec[10] = (uint8_t)(i >> 24);
+		for (k = 0U; k < sizeof(rec); k++) {
+			sum = (uint8_t)(sum + rec[k]);
+			n = mock_put(mock.stream, n, rec[k]);
+		}
+		n = mock_put(mock.stream, n, (uint8_t)~sum);
+		mock.stream[n++] = 0x7EU; /* QS_FRAME */
+	}
+	mock.len = n;
+}
+/**
+ * Load the stream to serve and the configuration from the environment
+ */
+static void mock_load(void) {
+	char const *env;
+
+	env = getenv("JLINK_MOCK_FILE");
+	if (env != NULL) {
+		FILE *f = fopen(env, "rb");
+		if (f != NULL) {
+			fseek(f, 0L, SEEK_END);
+			long size = ftell(f);
+			fseek(f, 0L, SEEK_SET);
+			if (size > 0) {
+				mock.stream = malloc((size_t)size);
+			}
+			if (mock.stream != NULL) {
+				mock.len = (uint32_t)fread(mock.stream, 1U, (size_t)size, f);
+			}
+			fclose(f);
+		}
+		else {
+			fprintf(stderr, "jlink_mock: cannot open %s\n", env);
+		}
+	}
+	if (mock.stream == NULL) {
+		mock_synth();
+	}
+
+	env = getenv("JLINK_MOCK_LOOPS");
+	mock.loops = (env != NULL) ? (uint32_t)strtoul(env, NULL, 10) : 1U;
+	env = getenv("JLINK_MOCK_BPS");
+	mock.bps = (env != NULL) ? strtoull(env, NULL, 10) : 0U;
+	env = getenv("JLINK_MOCK_H2T");
+	if (env != NULL) {
+		mock.h2t = fopen(env, "ab");
+	}
+	mock.pos = 0U;
+	mock.startPolls = MOCK_START_POLLS;
+}
+
+/* J-Link exports ==========================================================*/
+
+char const *JLINKARM_Open(void) {
+	mock_load();
+	return NULL;
+}
+void JLINKARM_Close(void) {
+	double const sec = (mock.t1 > mock.t0)
+			? (double)(mock.t1 - mock.t0) / 1e9 : 0.0;
+	fprintf(stderr, "jlink_mock: T2H=%llu bytes in %.3f s (%.2f MB/s), "
+			"H2T=%llu bytes\n",
+			(unsigned long long)mock.sent, sec,
+			(sec > 0.0) ? (double)mock.sent / sec / 1e6 : 0.0,
+			(unsigned long long)mock.rcvd);
+	if (mock.h2t != NULL) {
+		fclose(mock.h2t);
+		mock.h2t = NULL;
+	}
+	free(mock.stream);
+	mock.stream = NULL;
+}
+int JLINKARM_EMU_GetList(int hostIFs, void *const pInfo, int maxInfos) {
+	jlink_info_t *const info = (jlink_info_t *)pInfo;
+	(void)hostIFs;
+	if (maxInfos < 1) {
+		return 0;
+	}
+	memset(info, 0, sizeof(*info));
+	info->serial_number = MOCK_SER_NO;
+	info->host_if = HOST_IF_USB;
+	return 1;
+}
+int JLINKARM_EMU_SelectByUSBSN(uint32_t serNo) {
+	return (serNo == MOCK_SER_NO) ? 0 : -1;
+}
+void JLINKARM_EMU_SelectIPBySN(uint32_t serNo) {
+	(void)serNo;
+}
+int JLINKARM_ExecCommand(char const *in, char *out, int size) {
+	(void)in;
+	if (size > 0) {
+		out[0] = '\0'; /* success */
+	}
+	return 0;
+}
+void JLINKARM_TIF_GetAvailable(uint32_t *pMask) {
+	*pMask = (1U << 1); /* SWD */
+}
+int JLINKARM_TIF_Select(int tif) {
+	(void)tif;
+	return 0;
+}
+void JLINKARM_SetMaxSpeed(void) {
+}
+int JLINKARM_Connect(void) {
+	return 0;
+}
+int JLINKARM_EMU_GetNumConnections(void) {
+	return 1;
+}
+char JLINKARM_IsHalted(void) {
+	return 0;
+}
+void JLINKARM_Go(void) {
+}
+
+/* RTT exports =============================================================*/
+
+int JLINK_RTTERMINAL_Control(uint32_t cmd, void *p) {
+	switch (cmd) {
+		case RTT_CMD_START: {
+			mock.startPolls = MOCK_START_POLLS;
+			return 0;
+		}
+		case RTT_CMD_GETNUMBUF: {
+			if (mock.startPolls > 0) {
+				mock.startPolls--;
+				return -2; /* control block not found yet */
+			}
+			return 1; /* only the "qspy" buffer in each direction */
+		}
+		case RTT_CMD_GETDESC: {
+			jlink_rtt_desc_t *const desc = (jlink_rtt_desc_t *)p;
+			if (desc->idx != 0U) {
+				return -1;
+			}
+			STRNCPY_S(desc->acName, sizeof(desc->acName), RTT_QSPY_BUFFER_NAME);
+			desc->size = 1024U;
+			return 0;
+		}
+		default: {
+			return 0;
+		}
+	}
+}
+int JLINK_RTTERMINAL_Read(uint32_t idx, void *const buf, uint32_t size) {
+	uint64_t const now = mock_now();
+	uint32_t n;
+
+	if ((idx != 0U) || (mock.stream == NULL)) {
+		return -1;
+	}
+	if (mock.pos == mock.len) { /* end of the stream? */
+		if (mock.loops == 1U) {
+			return 0; /* nothing more to serve */
+		}
+		if (mock.loops != 0U) {
+			mock.loops--;
+		}
+		mock.pos = 0U;
+	}
+	if (mock.t0 == 0U) {
+		mock.t0 = now;
+	}
+
+	n = mock.len - mock.pos;
+	if (n > size) {
+		n = size;
+	}
+	if (mock.bps != 0U) { /* limited bandwidth? */
+		/* in double, as ns * B/s overflows 64 bits in seconds */
+		double const sec = (double)(now - mock.t0) / 1e9;
+		uint64_t const allowed = (uint64_t)(sec * (double)mock.bps);
+		uint64_t const avail = (allowed > mock.sent) ? (allowed - mock.sent) : 0U;
+		if (n > avail) {
+			n = (uint32_t)avail;
+		}
+	}
+	memcpy(buf, &mock.stream[mock.pos], n);
+	mock.pos += n;
+	mock.sent += n;
+	if (n != 0U) {
+		mock.t1 = now;
+	}
+	return (int)n;
+}
+int JLINK_RTTERMINAL_Write(uint32_t idx, void const *const buf, uint32_t size) {
+	if (idx != 0U) {
+		return -1;
+	}
+	if (mock.h2t != NULL) {
+		fwrite(buf, 1U, size, mock.h2t);
+		fflush(mock.h2t);
+	}
+	mock.rcvd += size;
+	return (int)size;
+}
@@ -0,0 +1,538 @@
+/*============================================================================
+* QP/C Real-Time Embedded Framework (RTEF)
+* Copyright (C) 2005 Quantum Leaps, LLC. All rights reserved.
+*
+* SPDX-License-Identifier: GPL-3.0-or-later OR LicenseRef-QL-commercial
+*
+* This software is dual-licensed under the terms of the open source GNU
+* General Public License version 3 (or any later version), or alternatively,
+* under the terms of one of the closed source Quantum Leaps commercial
+* licenses.
+*
+* The terms of the open source GNU General Public License version 3
+* can be found at: <www.gnu.org/licenses/gpl-3.0>
+*
+* The terms of the closed source Quantum Leaps commercial licenses
+* can be found at: <www.state-machine.com/licensing>
+*
+* Redistributions in source code must retain this top-level comment block.
+* Plagiarizing this software to sidestep the license obligations is illegal.
+*
+* Contact information:
+* <www.state-machine.com>
+* <info@state-machine.com>
+============================================================================*/
+/*!
+* @date Last updated on: 2022-07-27
+* @version Last updated for version: 7.0.0
+*
+* @file
+* @brief QSGEN synthetic QS traffic generator for stress-testing QSPY
+* @ingroup qpspy
+*
+* Synthesizes a valid framed QS stream (encoded exactly like QSPY_encode()),
+* as produced by a Target with the default QSPY configuration (-v 6.6,
+* -T 4 -O 4 -F 4 -S 2 -Q 1 -P 2 -C 2). The stream starts with the object,
+* function, and signal dictionaries, so that QSPY shows symbolic names.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+
+#include "safe_std.h" /* "safe" <stdio.h> and <string.h> facilities */
+#include "qspy.h"     /* QSPY_INSERT_ESC_BYTE() etc. */
+#include "pal.h"      /* enum_t etc. used by the QS headers */
+
+#define Q_SPY   1       /* this is QP implementation */
+#define QP_IMPL 1       /* this is QP implementation */
+#include "qpc_qs.h"     /* QS target-resident interface */
+#include "qpc_qs_pkg.h" /* QS package-scope interface */
+
+/* record mix groups (-m option) */
+enum {
+    MIX_SM, MIX_AO, MIX_EQ, MIX_MP, MIX_TE, MIX_USR,
+    MIX_MAX
+};
+static char const * const l_mixName[MIX_MAX] = {
+    "sm", "ao", "eq", "mp", "te", "usr"
+};
+
+enum {
+    GEN_STATES   = 4,      /* states of each state machine */
+    GEN_POOLS    = 3,      /* event pools */
+    GEN_REC_MAX  = 64,     /* the longest raw record */
+    GEN_OUT_SIZE = 64*1024 /* output coalesced into chunks */
+};
+
+/* synthetic addresses of the Target objects and functions */
+#define AO_ADDR(i_)    (0x20000000U + ((uint32_t)(i_) << 8))
+#define EQ_ADDR(i_)    (0x20010000U + ((uint32_t)(i_) << 8))
+#define MP_ADDR(i_)    (0x20020000U + ((uint32_t)(i_) << 8))
+#define TE_ADDR(i_)    (0x20030000U + ((uint32_t)(i_) << 8))
+#define ST_ADDR(i_, s_) (0x08000000U + ((uint32_t)(i_) << 8) + ((s_) << 4))
+#define GEN_USER_SIG   4U  /* the first user signal (Q_USER_SIG) */
+
+/* configuration (command-line options) */
+static uint32_t l_nRec      = 100000U; /* records to generate, 0 forever */
+static uint32_t l_nObj      = 8U;      /* active objects/state machines */
+static uint32_t l_nSig      = 16U;     /* signals */
+static uint32_t l_mix[MIX_MAX] = { 4U, 3U, 1U, 1U, 1U, 1U }; /* weights */
+static uint32_t l_escPpm    = 0U;      /* forced 0x7D/0x7E data bytes */
+static uint32_t l_badPpm    = 0U;      /* frames with bad checksums */
+static uint32_t l_seqPpm    = 0U;      /* sequence discontinuities */
+static uint32_t l_burst     = 0U;      /* records per burst, 0 no gaps */
+static uint32_t l_gapUs     = 0U;      /* gap between bursts [us] */
+static uint32_t l_seed      = 1U;      /* of the pseudo-random generator */
+
+/* state */
+static uint8_t  l_txSeq;               /* transmit sequence number */
+static uint32_t l_tstamp;              /* Target time stamp */
+static uint32_t l_rnd;                 /* pseudo-random generator */
+static uint8_t  l_rec[GEN_REC_MAX];    /* raw record being built */
+static uint32_t l_recLen;
+static uint8_t  l_out[GEN_OUT_SIZE + 2U*GEN_REC_MAX + 4U];
+static uint32_t l_outLen;
+static int      l_sock = -1;           /* TCP output */
+static FILE    *l_file;                /* file output */
+static uint64_t l_bytes;               /* bytes written */
+static uint32_t l_nBad;                /* injected bad checksums */
+static uint32_t l_nSeq;                /* injected discontinuities */
+
+static char const l_helpStr[] =
+    "Usage: qsgen [options]    <arg> = required, [arg] = optional\n"
+    "\n"
+    "OPTION            DEFAULT COMMENT\n"
+    "---------------------------------------------------------------\n"
+    "-h                        help (show this message)\n"
+    "-t [host:]<port>  localhost:6601 TCP output to qspy -t\n"
+    "-f <file_name>            file output (e.g., for qspy -f)\n"
+    "-n <records>      100000  records to generate, 0-forever\n"
+    "-m <mix>  sm:4,ao:3,eq:1,mp:1,te:1,usr:1 record mix weights\n"
+    "-o <objects>      8       active objects (state machines)\n"
+    "-s <signals>      16      signals\n"
+    "-e <ppm>          0       data bytes forced to 0x7D/0x7E\n"
+    "-b <burst>:<gap_us>       records per burst and gap between\n"
+    "-c <ppm>          0       frames with injected bad checksums\n"
+    "-d <ppm>          0       injected sequence discontinuities\n"
+    "-r <seed>         1       seed of the pseudo-random generator\n";
+
+/*..........................................................................*/
+static uint32_t gen_rand(void) { /* xorshift32 */
+    l_rnd ^= l_rnd << 13;
+    l_rnd ^= l_rnd >> 17;
+    l_rnd ^= l_rnd << 5;
+    return l_rnd;
+}
+/*..........................................................................*/
+static bool gen_chance(uint32_t ppm) {
+    return (ppm != 0U) && ((gen_rand() % 1000000U) < ppm);
+}
+/*..........................................................................*/
+static void gen_begin(uint8_t rec, bool tstamp) {
+    l_rec[0] = 0U; /* sequence number, supplied by gen_encode() */
+    l_rec[1] = rec;
+    l_recLen = 2U;
+    if (tstamp) {
+        l_tstamp += 1U + (gen_rand() % 100U);
+        uint32_t t = l_tstamp;
+        uint32_t i;
+        for (i = 0U; i < 4U; ++i, t >>= 8) {
+            l_rec[l_recLen++] = (uint8_t)t;
+        }
+    }
+}
+/*..........................................................................*/
+static void gen_u(uint32_t d, uint32_t size) { /* little endian */
+    for (; size > 0U; --size, d >>= 8) {
+        l_rec[l_recLen++] = (uint8_t)d;
+    }
+}
+/*..........................................................................*/
+static void gen_str(char const *str) {
+    do {
+        l_rec[l_recLen++] = (uint8_t)*str;
+    } while (*str++ != '\0');
+}
+/*..........................................................................*/
+/* encode the record into the output like QSPY_encode(), with the
+* injected errors (bad checksum, discontinuity)
+*/
+static uint32_t gen_encode(uint8_t *dstBuf, uint32_t dstSize,
+                           uint8_t const *srcBuf, uint32_t srcBytes)
+{
+    uint8_t chksum = 0U;
+    uint8_t *dst = &dstBuf[0];
+    uint8_t const *src = &srcBuf[1]; /* skip the sequence from the source */
+
+    --srcBytes; /* account for skipping the sequence number in the source */
+
+    if (gen_chance(l_seqPpm)) {
+        ++l_txSeq; /* a lost frame, as seen by QSPY */
+        ++l_nSeq;
+    }
+    ++l_txSeq;
+    uint8_t b = l_txSeq;
+    QSPY_INSERT_ESC_BYTE(b); /* insert esceped sequence */
+
+    for (; srcBytes > 0U; ++src, --srcBytes) {
+        b = *src;
+        QSPY_INSERT_ESC_BYTE(b) /* insert all escaped bytes */
+    }
+
+    b = chksum;
+    b ^= 0xFFU;                /* invert the bits of the checksum */
+    if (gen_chance(l_badPpm)) {
+        b ^= 0x01U;            /* corrupt the checksum */
+        ++l_nBad;
+    }
+    QSPY_INSERT_ESC_BYTE(b)    /* insert the escaped checksum */
+    QSPY_INSERT_BYTE(QS_FRAME) /* insert un-escaped frame */
+
+    return dst - &dstBuf[0];  /* number of bytes in the destination */
+}
+/*..........................................................................*/
+static bool gen_flush(void) {
+    uint32_t n = 0U;
+    while (n < l_outLen) {
+        ssize_t nBytes;
+        if (l_sock >= 0) {
+            nBytes = send(l_sock, &l_out[n], l_outLen - n, 0);
+        }
+        else {
+            nBytes = (ssize_t)fwrite(&l_out[n], 1U, l_outLen - n, l_file);
+            if (nBytes == 0) {
+                nBytes = -1;
+            }
+        }
+        if (nBytes < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            FPRINTF_S(stderr, "output error errno=%d\n", errno);
+            return false;
+        }
+        n += (uint32_t)nBytes;
+    }
+    l_bytes += l_outLen;
+    l_outLen = 0U;
+    return true;
+}
+/*..........................................................................*/
+static bool gen_end(void) {
+    uint8_t const rec = l_rec[1];
+    uint32_t i;
+    for (i = 2U; i < l_recLen; ++i) { /* escape-byte density */
+        /* the dictionaries and the format bytes must stay parseable */
+        bool const keep = ((QS_SIG_DICT <= rec) && (rec <= QS_USR_DICT))
+                          || ((rec >= QS_USER) && (i == 6U));
+        if (!keep && gen_chance(l_escPpm)) {
+            l_rec[i] = ((gen_rand() & 1U) != 0U) ? QS_FRAME : QS_ESC;
+        }
+    }
+    l_outLen += gen_encode(&l_out[l_outLen], sizeof(l_out) - l_outLen,
+                           l_rec, l_recLen);
+    return (l_outLen < GEN_OUT_SIZE) || gen_flush();
+}
+/*..........................................................................*/
+static bool gen_dictionaries(void) {
+    char name[QS_DNAME_LEN_MAX];
+    uint32_t i;
+    uint32_t s;
+    bool ok = true;
+
+    for (i = 0U; (i < l_nObj) && ok; ++i) {
+        gen_begin(QS_OBJ_DICT, false);
+        gen_u(AO_ADDR(i), 4U);
+        SNPRINTF_S(name, sizeof(name), "AO_%u", (unsigned)i);
+        gen_str(name);
+        ok = gen_end();
+        gen_begin(QS_OBJ_DICT, false);
+        gen_u(EQ_ADDR(i), 4U);
+        SNPRINTF_S(name, sizeof(name), "EQ_%u", (unsigned)i);
+        gen_str(name);
+        ok = ok && gen_end();
+        gen_begin(QS_OBJ_DICT, false);
+        gen_u(TE_ADDR(i), 4U);
+        SNPRINTF_S(name, sizeof(name), "TE_%u", (unsigned)i);
+        gen_str(name);
+        ok = ok && gen_end();
+        for (s = 0U; (s < GEN_STATES) && ok; ++s) {
+            gen_begin(QS_FUN_DICT, false);
+            gen_u(ST_ADDR(i, s), 4U);
+            SNPRINTF_S(name, sizeof(name), "AO_%u_s%u",
+                       (unsigned)i, (unsigned)s);
+            gen_str(name);
+            ok = gen_end();
+        }
+    }
+    for (i = 0U; (i < GEN_POOLS) && ok; ++i) {
+        gen_begin(QS_OBJ_DICT, false);
+        gen_u(MP_ADDR(i), 4U);
+        SNPRINTF_S(name, sizeof(name), "MP_%u", (unsigned)i);
+        gen_str(name);
+        ok = gen_end();
+    }
+    for (i = 0U; (i < l_nSig) && ok; ++i) {
+        gen_begin(QS_SIG_DICT, false);
+        gen_u(GEN_USER_SIG + i, 2U);
+        gen_u(0U, 4U); /* global signal */
+        SNPRINTF_S(name, sizeof(name), "SIG_%u", (unsigned)i);
+        gen_str(name);
+        ok = gen_end();
+    }
+    return ok;
+}
+/*..........................................................................*/
+static bool gen_record(uint32_t group) {
+    uint32_t const obj = gen_rand() % l_nObj;
+    uint32_t const sig = GEN_USER_SIG + (gen_rand() % l_nSig);
+    uint32_t const pool = 1U + (gen_rand() % GEN_POOLS);
+
+    switch (group) {
+        case MIX_SM: {
+            uint32_t const st = gen_rand() % GEN_STATES;
+            if ((gen_rand() & 1U) != 0U) {
+                gen_begin(QS_QEP_DISPATCH, true);
+                gen_u(sig, 2U);
+                gen_u(AO_ADDR(obj), 4U);
+                gen_u(ST_ADDR(obj, st), 4U);
+            }
+            else {
+                gen_begin(QS_QEP_TRAN, true);
+                gen_u(sig, 2U);
+                gen_u(AO_ADDR(obj), 4U);
+                gen_u(ST_ADDR(obj, st), 4U);
+                gen_u(ST_ADDR(obj, (st + 1U) % GEN_STATES), 4U);
+            }
+            break;
+        }
+        case MIX_AO: {
+            uint32_t const nFree = gen_rand() % 10U;
+            if ((gen_rand() & 1U) != 0U) {
+                gen_begin(QS_QF_ACTIVE_POST, true);
+                gen_u(AO_ADDR(gen_rand() % l_nObj), 4U); /* sender */
+                gen_u(sig, 2U);
+                gen_u(AO_ADDR(obj), 4U);
+                gen_u(pool, 1U);
+                gen_u(1U, 1U);         /* reference counter */
+                gen_u(nFree, 1U);
+                gen_u(nFree / 2U, 1U); /* minimum */
+            }
+            else {
+                gen_begin(QS_QF_ACTIVE_GET, true);
+                gen_u(sig, 2U);
+                gen_u(AO_ADDR(obj), 4U);
+                gen_u(pool, 1U);
+                gen_u(1U, 1U);
+                gen_u(nFree, 1U);
+            }
+            break;
+        }
+        case MIX_EQ: {
+            uint32_t const nFree = gen_rand() % 10U;
+            gen_begin(QS_QF_EQUEUE_POST, true);
+            gen_u(sig, 2U);
+            gen_u(EQ_ADDR(obj), 4U);
+            gen_u(pool, 1U);
+            gen_u(1U, 1U);
+            gen_u(nFree, 1U);
+            gen_u(nFree / 2U, 1U);
+            break;
+        }
+        case MIX_MP: {
+            uint32_t const nFree = gen_rand() % 100U;
+            gen_begin(QS_QF_MPOOL_GET, true);
+            gen_u(MP_ADDR(pool - 1U), 4U);
+            gen_u(nFree, 2U);
+            gen_u(nFree / 2U, 2U);
+            break;
+        }
+        case MIX_TE: {
+            gen_begin(QS_QF_TIMEEVT_ARM, true);
+            gen_u(TE_ADDR(obj), 4U);
+            gen_u(AO_ADDR(obj), 4U);
+            gen_u(1U + (gen_rand() % 100U), 2U); /* timeout */
+            gen_u(((gen_rand() & 1U) != 0U) ? 100U : 0U, 2U); /* interval */
+            gen_u(0U, 1U); /* tick rate */
+            break;
+        }
+        default: { /* MIX_USR */
+            gen_begin((uint8_t)(QS_USER + (gen_rand() % 5U)), true);
+            gen_u(QS_U32_T, 1U); /* format */
+            gen_u(gen_rand(), 4U);
+            break;
+        }
+    }
+    return gen_end();
+}
+/*..........................................................................*/
+static bool parse_mix(char *str) {
+    char *tok;
+    memset(l_mix, 0, sizeof(l_mix));
+    for (tok = strtok(str, ","); tok != NULL; tok = strtok(NULL, ",")) {
+        char *colon = strchr(tok, ':');
+        uint32_t g;
+        if (colon == NULL) {
+            return false;
+        }
+        *colon = '\0';
+        for (g = 0U; (g < MIX_MAX) && (strcmp(tok, l_mixName[g]) != 0); ++g) {
+        }
+        if (g == MIX_MAX) {
+            return false;
+        }
+        l_mix[g] = (uint32_t)strtoul(colon + 1, NULL, 10);
+    }
+    return true;
+}
+/*..........................................................................*/
+static int open_tcp(char const *hostPort) {
+    char host[64] = "localhost";
+    char const *port = hostPort;
+    char const *colon = strchr(hostPort, ':');
+    struct addrinfo hints;
+    struct addrinfo *res;
+    int sock = -1;
+
+    if (colon != NULL) {
+        uint32_t len = (uint32_t)(colon - hostPort);
+        if (len >= sizeof(host)) {
+            len = sizeof(host) - 1U;
+        }
+        if (len > 0U) {
+            memcpy(host, hostPort, len);
+            host[len] = '\0';
+        }
+        port = colon + 1;
+    }
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, port, &hints, &res) != 0) {
+        FPRINTF_S(stderr, "unknown host %s:%s\n", host, port);
+        return -1;
+    }
+    sock = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if ((sock < 0) || (connect(sock, res->ai_addr, res->ai_addrlen) != 0)) {
+        FPRINTF_S(stderr, "cannot connect to %s:%s errno=%d\n",
+                  host, port, errno);
+        if (sock >= 0) {
+            close(sock);
+        }
+        sock = -1;
+    }
+    freeaddrinfo(res);
+    return sock;
+}
+/*..........................................................................*/
+int main(int argc, char *argv[]) {
+    char const *tcp  = "6601";
+    char const *file = NULL;
+    uint32_t mixSum = 0U;
+    uint32_t n;
+    uint32_t g;
+    struct timespec t0;
+    struct timespec t1;
+    int optChar;
+    bool ok;
+
+    while ((optChar = getopt(argc, argv, "ht:f:n:m:o:s:e:b:c:d:r:")) != -1) {
+        switch (optChar) {
+            case 't': tcp  = optarg; break;
+            case 'f': file = optarg; break;
+            case 'n': l_nRec   = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'o': l_nObj   = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 's': l_nSig   = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'e': l_escPpm = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'c': l_badPpm = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'd': l_seqPpm = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'r': l_seed   = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'b': {
+                char *pEnd;
+                l_burst = (uint32_t)strtoul(optarg, &pEnd, 10);
+                if (*pEnd == ':') {
+                    l_gapUs = (uint32_t)strtoul(pEnd + 1, NULL, 10);
+                }
+                break;
+            }
+            case 'm': {
+                if (!parse_mix(optarg)) {
+                    FPRINTF_S(stderr, "incorrect mix: %s\n", optarg);
+                    return -1;
+                }
+                break;
+            }
+            default: { /* -h and unknown options */
+                FPRINTF_S(stderr, "%s", l_helpStr);
+                return (optChar == 'h') ? 0 : -1;
+            }
+        }
+    }
+    for (g = 0U; g < MIX_MAX; ++g) {
+        mixSum += l_mix[g];
+    }
+    if ((mixSum == 0U) || (l_nObj == 0U) || (l_nSig == 0U)) {
+        FPRINTF_S(stderr, "%s\n", "the mix, objects, and signals "
+                  "must not be empty");
+        return -1;
+    }
+    l_rnd = (l_seed != 0U) ? l_seed : 1U;
+
+    if (file != NULL) {
+        FOPEN_S(l_file, file, "wb");
+        if (l_file == NULL) {
+            FPRINTF_S(stderr, "cannot open %s\n", file);
+            return -1;
+        }
+    }
+    else {
+        l_sock = open_tcp(tcp);
+        if (l_sock < 0) {
+            return -1;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    ok = gen_dictionaries();
+    for (n = 0U; ok && ((l_nRec == 0U) || (n < l_nRec)); ++n) {
+        uint32_t w = gen_rand() % mixSum;
+        for (g = 0U; w >= l_mix[g]; ++g) { /* weighted pick */
+            w -= l_mix[g];
+        }
+        ok = gen_record(g);
+        if (ok && (l_burst != 0U) && (((n + 1U) % l_burst) == 0U)) {
+            ok = gen_flush(); /* the burst goes out before the gap */
+            if (l_gapUs != 0U) {
+                usleep(l_gapUs);
+            }
+        }
+    }
+    if (ok) {
+        ok = gen_flush();
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    double const sec = (double)(t1.tv_sec - t0.tv_sec)
+                       + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+    FPRINTF_S(stderr, "qsgen: %u records, %llu bytes in %.3f s "
+              "(%.0f rec/s, %.2f MB/s), injected BadChksum=%u,Discont=%u\n",
+              (unsigned)n, (unsigned long long)l_bytes, sec,
+              (sec > 0.0) ? (double)n / sec : 0.0,
+              (sec > 0.0) ? (double)l_bytes / sec / 1e6 : 0.0,
+              (unsigned)l_nBad, (unsigned)l_nSeq);
+
+    if (l_sock >= 0) {
+        close(l_sock);
+    }
+    if (l_file != NULL) {
+        fclose(l_file);
+    }
+    return ok ? 0 : -1;
+}
@@ -30,8 +30,12 @@
 * @brief QSPY PAL implementation for POSIX
 * @ingroup qpspy
 */
+#ifdef __linux__
+#define _GNU_SOURCE  /* for memfd_create() */
+#endif
 #include <stdlib.h>  /* for system() */
 #include <stdint.h>
+#include <inttypes.h>
 #include <stdbool.h>
 #include <fcntl.h>
 #include <termios.h>
@@ -39,13 +43,25 @@
 #include <sys/select.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <linux/serial.h> /* for ASYNC_LOW_LATENCY */
+#endif
+#include <poll.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <errno.h>
 #include <time.h>
 #include <signal.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <rtt_link.h>
 
 #include "safe_std.h" /* "safe" <stdio.h> and <string.h> facilities */
@@ -57,28 +73,31 @@
 PAL_VtblType PAL_vtbl;   /* global PAL virtual table */
 
 /* specific implementations of the PAL "virutal functions" .................*/
-static QSPYEvtType ser_getEvt(unsigned char *buf, uint32_t *pBytes);
+static QSPYEvtType ser_receive(unsigned char *buf, uint32_t *pBytes);
 static QSpyStatus  ser_send2Target(unsigned char *buf, uint32_t nBytes);
 static void ser_cleanup(void);
+static QSpyStatus ser_setBaud(int baudRate);
 
-static QSPYEvtType tcp_getEvt(unsigned char *buf, uint32_t *pBytes);
+static QSPYEvtType tcp_receive(unsigned char *buf, uint32_t *pBytes);
 static QSpyStatus  tcp_send2Target(unsigned char *buf, uint32_t nBytes);
 static void tcp_cleanup(void);
 
-static QSPYEvtType file_getEvt(unsigned char *buf, uint32_t *pBytes);
+static QSPYEvtType file_receive(unsigned char *buf, uint32_t *pBytes);
 static QSpyStatus  file_send2Target(unsigned char *buf, uint32_t nBytes);
 static void file_cleanup(void);
 
-static QSPYEvtType rtt_getEvt(unsigned char *buf, uint32_t *pBytes);
+static QSPYEvtType rtt_receive(unsigned char *buf, uint32_t *pBytes);
 static QSpyStatus  rtt_send2Target(unsigned char *buf, uint32_t nBytes);
 static void rtt_cleanup(void);
 
+static void rx_watch(int fd);
+static void rx_stop(void);
+
 /*..........................................................................*/
 enum PAL_Constants { /* local constants... */
     INVALID_SOCKET = -1,
     SOCKET_ERROR   = -1,
     FE_DETACHED    = 0,   /* Front-End detached */
-    PAL_TOUT_MS    = 10,  /* determines how long to wait for an event [ms] */
 };
 
 /* fron-end address */
@@ -94,14 +113,182 @@ static int l_serverSock = INVALID_SOCKET;
 static int l_clientSock = INVALID_SOCKET;
 static int l_beSock     = INVALID_SOCKET;
 
-static fe_addr   l_feAddr;
-static socklen_t l_feAddrSize = FE_DETACHED;
+/* table of Front-Ends, FE_DETACHED size means a free entry */
+static fe_addr   l_feAddr[PAL_FE_MAX];
+static socklen_t l_feAddrSize[PAL_FE_MAX];
+static int       l_feCurr; /* Front-End of the last received packet */
+
+/* connection-oriented Back-End (instead of UDP), either Unix-domain
+* (see PAL_openBEUnix()) or TCP (see PAL_openBETcp())
+*/
+static bool l_beConn = false;
+static bool l_beTcp  = false;
+static struct sockaddr_un l_beUnixAddr;
+static int  l_feSock[PAL_FE_MAX]; /* connected Front-Ends */
+
+/* TCP stream framing: { [len-lo][len-hi][packet] }...
+* the packets to a Front-End are coalesced in tx[] and written out once
+* per iteration of the QSPY event loop (see PAL_flushBE()).
+*/
+enum {
+    TCP_FRAME_HDR  = 2,           /* [len-lo][len-hi] */
+    TCP_RX_SIZE    = 4096,        /* max frame from a Front-End [bytes] */
+    TCP_TX_SIZE    = (64 * 1024)  /* coalesced frames to a Front-End */
+};
+
+static struct {
+    uint32_t rxLen;  /* bytes of the current frame received so far */
+    uint32_t txLen;  /* bytes of the coalesced frames not written yet */
+    uint8_t  rx[TCP_RX_SIZE];
+    uint8_t  tx[TCP_TX_SIZE];
+} l_feTcp[PAL_FE_MAX];
+
+#ifdef __linux__
+/* shared-memory SPSC ring from QSPY to a local Front-End
+* (the Front-End gets the memfd and the eventfd with the ATTACH confirmation)
+*
+* The ring carries the same packets as the socket, each as
+* [len-lo][len-hi][packet] padded to 4 bytes. A packet never wraps around;
+* the length SHM_WRAP instead tells the Front-End to continue at offset 0.
+* The eventfd is signalled only when the ring was empty before a packet.
+*/
+typedef struct {
+    uint32_t magic;     /* SHM_MAGIC */
+    uint32_t size;      /* size of data[] (power of 2) [bytes] */
+    uint32_t dropped;   /* packets dropped because the ring was full */
+    uint32_t reserved[13];
+    uint32_t head;      /* written by QSPY (free-running) */
+    uint32_t pad1[15];
+    uint32_t tail;      /* written by the Front-End (free-running) */
+    uint32_t pad2[15];
+    uint8_t  data[];
+} ShmRing;
+
+enum {
+    SHM_MAGIC = 0x52505351U, /* "QSPR" */
+    SHM_SIZE  = (1U << 20),  /* 1MB of ring data */
+    SHM_WRAP  = 0xFFFFU      /* length of the wrap-around marker */
+};
+
+static struct {
+    ShmRing *ring;   /* mapped ring or NULL */
+    int memFd;       /* to be passed to the Front-End, or -1 */
+    int evtFd;       /* eventfd to wake up the Front-End */
+} l_feShm[PAL_FE_MAX];
+
+static void shm_close(int fe);
+static void shm_send2FE(int fe, unsigned char const *buf, uint32_t nBytes);
+#endif /* __linux__ */
+
+static void conn_accept(void);
+static QSPYEvtType conn_receiveFE(int fe, unsigned char *buf,
+                                  uint32_t *pBytes);
+static void conn_closeFE(int fe);
+static void unix_send2FE(int fe, unsigned char const *buf, uint32_t nBytes);
+static int  tcp_recvFE(int fe, unsigned char *buf, uint32_t *pBytes);
+static void tcp_send2FE(int fe, unsigned char const *buf, uint32_t nBytes);
+static void tcp_flushFE(int fe);
+static QSpyStatus conn_listen(int sock, char const *kind);
+
+/* the event loop (see loop_getEvt())
+*
+* All input sources are watched by a single epoll instance (poll() on the
+* other POSIX systems), which is not rebuilt when the sources come and go.
+* The sources found ready by one wait are served round-robin, one event at
+* a time, each up to its budget of events per wait. This way a busy Target
+* cannot starve the keyboard and the Front-Ends (or the reverse), while the
+* sources still readable after spending their budget are simply reported
+* again by the next wait (level-triggered).
+*/
+typedef enum {
+    SRC_KBD,        /* keyboard (stdin) */
+    SRC_TARGET,     /* Target connection (see l_targetRecv) */
+    SRC_FILE,       /* Target file (always ready, cannot be polled) */
+    SRC_BE,         /* Back-End socket (UDP or listening) */
+    SRC_FE,         /* connected Front-End SRC_FE + fe */
+    SRC_TIMER = SRC_FE + PAL_FE_MAX, /* periodic timer (PAL_setTimer()) */
+    SRC_MAX
+} LoopSrc;
+
+enum {
+    LOOP_BUDGET_TARGET = 4,  /* Target chunks per wait */
+    LOOP_BUDGET_FE     = 16  /* Front-End packets per wait */
+};
+
+typedef struct {
+    uint8_t src;    /* LoopSrc */
+    uint8_t budget; /* events left for the source until the next wait */
+} LoopReady;
+
+static LoopReady l_ready[SRC_MAX]; /* sources ready after the last wait */
+static int  l_nReady;              /* number of entries in l_ready[] */
+static int  l_iReady;              /* next entry in l_ready[] to serve */
+static bool l_busy;                /* events since the last QSPY_NO_EVT? */
+static uint32_t l_timerPeriod;     /* [ms], 0 means no timer */
+static uint64_t l_timerNext;       /* deadline of the next tick [ms] */
+static QSPYEvtType (*l_targetRecv)(unsigned char *buf, uint32_t *pBytes);
+static uint64_t l_rxUs;            /* receipt of the last Target data [us] */
+#ifdef __linux__
+static int l_epollFd = -1;         /* the epoll instance */
+#else
+static struct pollfd l_pollFd[SRC_MAX];
+static uint8_t       l_pollSrc[SRC_MAX];
+static int           l_nPoll;
+#endif
+
+static QSPYEvtType loop_getEvt(unsigned char *buf, uint32_t *pBytes);
+static QSPYEvtType loop_serve(uint8_t src,
+                              unsigned char *buf, uint32_t *pBytes);
+static QSpyStatus loop_wait(void);
+static void loop_ready(uint8_t src);
+static void loop_drop(int idx);
+static void loop_add(int fd, uint8_t src);
+static void loop_del(int fd, uint8_t src);
+static uint64_t loop_nowMs(void);
+static uint64_t loop_nowUs(void);
 
 static FILE *l_file = (FILE *)0;
 
 static struct termios l_termios_saved; /* saved terminal attributes */
-static fd_set l_readSet; /* descriptor set for reading all input sources */
-static int l_maxFd;      /* maximum file descriptor for select() */
+
+#if defined(__linux__) && defined(TCGETS2)
+/* the kernel termios2 for the baud rates without a B* constant
+* NOTE: <asm/termbits.h> defines it too, but conflicts with <termios.h>
+*/
+struct termios2 {
+    tcflag_t c_iflag;
+    tcflag_t c_oflag;
+    tcflag_t c_cflag;
+    tcflag_t c_lflag;
+    cc_t     c_line;
+    cc_t     c_cc[19];
+    speed_t  c_ispeed;
+    speed_t  c_ospeed;
+};
+#ifndef BOTHER
+#define BOTHER 0010000
+#endif
+#define SER_ANY_BAUD 1
+#endif
+
+/* serial reads (see PAL_configSer()) and their statistics, reported
+* when the port is closed. The gaps between the reads show the latency
+* added by the driver and the tty layer (e.g., the FTDI latency timer).
+*/
+enum {
+    SER_HIST_MAX = 8 /* read sizes <16, <64, ... <64K, >=64K [bytes] */
+};
+static uint8_t l_serVmin  = 0U;
+static uint8_t l_serVtime = 1U;
+static struct {
+    uint32_t reads;   /* number of non-empty reads */
+    uint64_t bytes;   /* bytes read */
+    uint32_t maxRead; /* largest read [bytes] */
+    uint32_t hist[SER_HIST_MAX]; /* histogram of the read sizes */
+    uint64_t tLast;   /* time of the last read [us] */
+    uint64_t gapSum;  /* sum of the gaps between the reads [us] */
+    uint32_t gapMax;  /* longest gap between the reads [us] */
+} l_serStats;
 
 /*==========================================================================*/
 /* Keyboard input */
@@ -148,6 +335,7 @@ QSpyStatus PAL_openKbd(bool kbd_inp, bool color) {
         }
 
         l_kbd_inp = true;
+        loop_add(0, SRC_KBD); /* terminal to be watched in the event loop */
     }
     return QSPY_SUCCESS;
 }
@@ -167,9 +355,10 @@ QSpyStatus PAL_openTargetSer(char const *comName, int baudRate) {
     speed_t spd;
 
     /* setup the PAL virtual table for the Serial communication... */
-    PAL_vtbl.getEvt      = &ser_getEvt;
+    PAL_vtbl.getEvt      = &loop_getEvt;
     PAL_vtbl.send2Target = &ser_send2Target;
     PAL_vtbl.cleanup     = &ser_cleanup;
+    l_targetRecv         = &ser_receive;
 
     l_serFD = open(comName, O_RDWR | O_NOCTTY | O_NONBLOCK);/* R/W,no-block */
     if (l_serFD == -1) {
@@ -187,8 +376,8 @@ QSpyStatus PAL_openTargetSer(char const *comName, int baudRate) {
         QSPY_printError();
         return QSPY_ERROR; /* getting attributes failed */
     }
-    t.c_cc[VMIN]  = 0;
-    t.c_cc[VTIME] = 1;
+    t.c_cc[VMIN]  = l_serVmin;
+    t.c_cc[VTIME] = l_serVtime;
 
     t.c_iflag = 0;
     t.c_iflag &= ~(BRKINT | IGNPAR | PARMRK | INPCK |
@@ -263,10 +452,15 @@ QSpyStatus PAL_openTargetSer(char const *comName, int baudRate) {
 #endif
 
         default:
+#ifdef SER_ANY_BAUD
+            spd = B38400; /* placeholder, see ser_setBaud() */
+            break;
+#else
             SNPRINTF_LINE("   <COMMS> ERROR    Unsupported rate Baud=%d",
                           baudRate);
             QSPY_printError();
             return QSPY_ERROR;
+#endif
     }
 
     t.c_cflag &= ~(PARENB | PARODD); /* no parity */
@@ -297,53 +491,63 @@ QSpyStatus PAL_openTargetSer(char const *comName, int baudRate) {
         QSPY_printError();
         return QSPY_ERROR;
     }
+    if (ser_setBaud(baudRate) != QSPY_SUCCESS) {
+        return QSPY_ERROR;
+    }
 
-    PAL_updateReadySet(l_serFD); /* Serial port to be checked in select() */
+#ifdef __linux__
+    /* ask the driver to deliver the data right away (e.g., FTDI latency
+    * timer of 1ms instead of 16ms). Not all drivers support it.
+    */
+    struct serial_struct ss;
+    if (ioctl(l_serFD, TIOCGSERIAL, &ss) == 0) {
+        ss.flags |= ASYNC_LOW_LATENCY;
+        (void)ioctl(l_serFD, TIOCSSERIAL, &ss);
+    }
+#endif
+
+    memset(&l_serStats, 0, sizeof(l_serStats));
+    rx_watch(l_serFD); /* to be watched in the event loop */
 
     return QSPY_SUCCESS;
 }
 /*..........................................................................*/
-static QSPYEvtType ser_getEvt(unsigned char *buf, uint32_t *pBytes) {
-    QSPYEvtType evtType;
-    fd_set readSet = l_readSet;
-
-    /* block indefinitely until any input source has input */
-    int nrec = select(l_maxFd, &readSet, 0, 0, NULL);
+static QSPYEvtType ser_receive(unsigned char *buf, uint32_t *pBytes) {
+    ssize_t nBytes = read(l_serFD, buf, *pBytes); /* non-blocking */
+    if (nBytes > 0) {
+        uint64_t const now = loop_nowUs();
+        uint32_t n;
+        int i;
+        if (l_serStats.reads != 0U) {
+            uint64_t const gap = now - l_serStats.tLast;
+            l_serStats.gapSum += gap;
+            if (l_serStats.gapMax < gap) {
+                l_serStats.gapMax = (gap < 0xFFFFFFFFU)
+                                    ? (uint32_t)gap : 0xFFFFFFFFU;
+            }
+        }
+        l_serStats.tLast = now;
+        ++l_serStats.reads;
+        l_serStats.bytes += (uint64_t)nBytes;
+        if (l_serStats.maxRead < (uint32_t)nBytes) {
+            l_serStats.maxRead = (uint32_t)nBytes;
+        }
+        for (i = 0, n = (uint32_t)nBytes >> 4;
+             (n != 0U) && (i < SER_HIST_MAX - 1);
+             ++i, n >>= 2)
+        {
+        }
+        ++l_serStats.hist[i];
 
-    if (nrec == 0) {
-        return QSPY_NO_EVT;
+        *pBytes = (uint32_t)nBytes;
+        return QSPY_TARGET_INPUT_EVT;
     }
-    else if (nrec < 0) {
-        SNPRINTF_LINE("   <COMMS> ERROR    select() errno=%d", errno);
+    else if ((nBytes < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+        SNPRINTF_LINE("   <COMMS> ERROR    reading serial port errno=%d",
+                      errno);
         QSPY_printError();
         return QSPY_ERROR_EVT;
     }
-
-    /* any input available from the keyboard? */
-    if (l_kbd_inp && FD_ISSET(0, &readSet)) {
-        evtType = PAL_receiveKbd(buf, pBytes);
-        if (evtType != QSPY_NO_EVT) {
-            return evtType;
-        }
-    }
-
-    /* any input available from the Back-End socket? */
-    if ((l_beSock != INVALID_SOCKET) && FD_ISSET(l_beSock, &readSet)) {
-        evtType = PAL_receiveBe(buf, pBytes);
-        if (evtType != QSPY_NO_EVT) {
-            return evtType;
-        }
-    }
-
-    /* any input available from the Serial port? */
-    if (FD_ISSET(l_serFD, &readSet)) {
-        uint32_t nBytes = read(l_serFD, buf, *pBytes);
-        if (nBytes > 0) {
-            *pBytes = (uint32_t)nBytes;
-            return QSPY_TARGET_INPUT_EVT;
-        }
-    }
-
     return QSPY_NO_EVT;
 }
 /*..........................................................................*/
@@ -362,10 +566,78 @@ static QSpyStatus ser_send2Target(unsigned char *buf, uint32_t nBytes) {
 /*..........................................................................*/
 static void ser_cleanup(void) {
     if (l_serFD != 0) {
+        rx_stop();
         close(l_serFD); /* close the serial port */
         l_serFD = 0;
+
+        if (l_serStats.reads != 0U) {
+            SNPRINTF_LINE("   <COMMS> Serial   Reads=%u,Bytes=%"PRIu64","
+                          "Avg=%u,Max=%u,Gap<Avg=%uus,Max=%uus>",
+                (unsigned)l_serStats.reads, l_serStats.bytes,
+                (unsigned)(l_serStats.bytes / l_serStats.reads),
+                (unsigned)l_serStats.maxRead,
+                (unsigned)((l_serStats.reads > 1U)
+                    ? (l_serStats.gapSum / (l_serStats.reads - 1U)) : 0U),
+                (unsigned)l_serStats.gapMax);
+            QSPY_printInfo();
+            SNPRINTF_LINE("   <COMMS> Serial   Sizes<16=%u,<64=%u,<256=%u,"
+                          "<1K=%u,<4K=%u,<16K=%u,<64K=%u,>=64K=%u",
+                (unsigned)l_serStats.hist[0], (unsigned)l_serStats.hist[1],
+                (unsigned)l_serStats.hist[2], (unsigned)l_serStats.hist[3],
+                (unsigned)l_serStats.hist[4], (unsigned)l_serStats.hist[5],
+                (unsigned)l_serStats.hist[6], (unsigned)l_serStats.hist[7]);
+            QSPY_printInfo();
+        }
     }
 }
+/*..........................................................................*/
+void PAL_configSer(int vmin, int vtime) {
+    l_serVmin  = (uint8_t)vmin;
+    l_serVtime = (uint8_t)vtime;
+}
+/*..........................................................................*/
+/* set the baud rate that has no B* constant (see PAL_openTargetSer()) */
+static QSpyStatus ser_setBaud(int baudRate) {
+#ifdef SER_ANY_BAUD
+    struct termios t;
+    struct termios2 t2;
+
+    if ((tcgetattr(l_serFD, &t) == -1)
+        || (cfgetospeed(&t) != B38400)) /* not the placeholder? */
+    {
+        return QSPY_SUCCESS; /* the B* constant is in use */
+    }
+    if (baudRate == 38400) {
+        return QSPY_SUCCESS;
+    }
+    if (ioctl(l_serFD, TCGETS2, &t2) == -1) {
+        SNPRINTF_LINE("   <COMMS> ERROR    getting serial speed errno=%d",
+                      errno);
+        QSPY_printError();
+        return QSPY_ERROR;
+    }
+    t2.c_cflag &= ~(tcflag_t)CBAUD;
+    t2.c_cflag |= BOTHER;
+    t2.c_ispeed = (speed_t)baudRate;
+    t2.c_ospeed = (speed_t)baudRate;
+    if ((ioctl(l_serFD, TCSETS2, &t2) == -1)
+        || (ioctl(l_serFD, TCGETS2, &t2) == -1))
+    {
+        SNPRINTF_LINE("   <COMMS> ERROR    Unsupported rate Baud=%d,"
+                      "errno=%d", baudRate, errno);
+        QSPY_printError();
+        return QSPY_ERROR;
+    }
+    if (t2.c_ospeed != (speed_t)baudRate) { /* the closest possible rate */
+        SNPRINTF_LINE("   <COMMS> Serial   Baud=%d,Actual=%u",
+                      baudRate, (unsigned)t2.c_ospeed);
+        QSPY_printInfo();
+    }
+#else
+    (void)baudRate; /* unused parameter */
+#endif
+    return QSPY_SUCCESS;
+}
 
 /*==========================================================================*/
 /* POSIX TCP/IP communication with the Target */
@@ -377,9 +649,10 @@ QSpyStatus PAL_openTargetTcp(int portNum) {
     struct sockaddr_in local;
 
     /* setup the PAL virtual table for the TCP/IP Target connection... */
-    PAL_vtbl.getEvt      = &tcp_getEvt;
+    PAL_vtbl.getEvt      = &loop_getEvt;
     PAL_vtbl.send2Target = &tcp_send2Target;
     PAL_vtbl.cleanup     = &tcp_cleanup;
+    l_targetRecv         = &tcp_receive;
 
     /* create TCP socket */
     l_serverSock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
@@ -413,97 +686,66 @@ QSpyStatus PAL_openTargetTcp(int portNum) {
         return QSPY_ERROR;
     }
 
-    PAL_updateReadySet(l_serverSock); /* to be checked in select() */
+    loop_add(l_serverSock, SRC_TARGET); /* wait for the client */
 
     return QSPY_SUCCESS;
 }
 /*..........................................................................*/
 static void tcp_cleanup(void) {
+    rx_stop();
     if (l_serverSock != INVALID_SOCKET) {
         close(l_serverSock);
     }
 }
 /*..........................................................................*/
-static QSPYEvtType tcp_getEvt(unsigned char *buf, uint32_t *pBytes) {
-    QSPYEvtType evtType;
-    fd_set readSet = l_readSet;
-
-    /* block indefinitely until any input source has input */
-    int nrec = select(l_maxFd, &readSet, 0, 0, NULL);
-
-    if (nrec == 0) {
-        return QSPY_NO_EVT;
-    }
-    else if (nrec < 0) {
-        SNPRINTF_LINE("   <COMMS> ERROR    select() errno=%d", errno);
-        QSPY_printError();
-        return QSPY_ERROR_EVT;
-    }
-
-    /* any input available from the keyboard? */
-    if (l_kbd_inp && FD_ISSET(0, &readSet)) {
-        evtType = PAL_receiveKbd(buf, pBytes);
-        if (evtType != QSPY_NO_EVT) {
-            return evtType;
-        }
-    }
-
-    /* any input available from the Back-End socket? */
-    if ((l_beSock != INVALID_SOCKET) && FD_ISSET(l_beSock, &readSet)) {
-        evtType = PAL_receiveBe(buf, pBytes);
-        if (evtType != QSPY_NO_EVT) {
-            return evtType;
-        }
-    }
-
+static QSPYEvtType tcp_receive(unsigned char *buf, uint32_t *pBytes) {
     /* still waiting for the client? */
     if (l_clientSock == INVALID_SOCKET) {
-        if (FD_ISSET(l_serverSock, &readSet)) {
-           socklen_t clientAddrLen = (socklen_t)sizeof(l_clientAddr);
-           l_clientSock = accept(l_serverSock,
-                                  (struct sockaddr *)&l_clientAddr,
-                                  &clientAddrLen);
-            if (l_clientSock == INVALID_SOCKET) {
-                SNPRINTF_LINE("   <COMMS> ERROR    socket accept errno=%d",
-                              errno);
-                QSPY_printError();
-                return QSPY_ERROR_EVT;
-            }
+        socklen_t clientAddrLen = (socklen_t)sizeof(l_clientAddr);
+        l_clientSock = accept(l_serverSock,
+                              (struct sockaddr *)&l_clientAddr,
+                              &clientAddrLen);
+        if (l_clientSock == INVALID_SOCKET) {
+            SNPRINTF_LINE("   <COMMS> ERROR    socket accept errno=%d",
+                          errno);
+            QSPY_printError();
+            return QSPY_ERROR_EVT;
+        }
 
-            QSPY_reset();   /* reset the QSPY parser to start over cleanly */
-            QSPY_txReset(); /* reset the QSPY transmitter */
+        QSPY_reset();   /* reset the QSPY parser to start over cleanly */
+        QSPY_txReset(); /* reset the QSPY transmitter */
 
-            SNPRINTF_LINE("   <COMMS> TCP-IP   Connected to Host=%s,Port=%d",
-                   inet_ntoa(l_clientAddr.sin_addr),
-                   (int)ntohs(l_clientAddr.sin_port));
-            QSPY_printInfo();
+        SNPRINTF_LINE("   <COMMS> TCP-IP   Connected to Host=%s,Port=%d",
+               inet_ntoa(l_clientAddr.sin_addr),
+               (int)ntohs(l_clientAddr.sin_port));
+        QSPY_printInfo();
 
-            /* re-evaluate the ready set and max FD for select() */
-            PAL_updateReadySet(l_clientSock);
-        }
+        /* watch the client instead of the server socket */
+        loop_del(l_serverSock, SRC_TARGET);
+        rx_watch(l_clientSock);
     }
     else {
-        if (FD_ISSET(l_clientSock, &readSet)) {
-            nrec = recv(l_clientSock, (char *)buf, *pBytes, 0);
-
-            if (nrec <= 0) { /* the client hang up */
-                SNPRINTF_LINE("   <COMMS> TCP-IP   Disconn from "
-                              "Host=%s,Port=%d",
-                              inet_ntoa(l_clientAddr.sin_addr),
-                              (int)ntohs(l_clientAddr.sin_port));
-                QSPY_printInfo();
-
-                /* go back to waiting for a client */
-                close(l_clientSock);
-                l_clientSock = INVALID_SOCKET;
-
-                /* re-evaluate the ready set and max FD for select() */
-                PAL_updateReadySet(l_serverSock);
-            }
-            else {
-                *pBytes = (uint32_t)nrec;
-                return QSPY_TARGET_INPUT_EVT;
-            }
+        ssize_t nrec = recv(l_clientSock, (char *)buf, *pBytes,
+                            MSG_DONTWAIT);
+        if (nrec > 0) {
+            *pBytes = (uint32_t)nrec;
+            return QSPY_TARGET_INPUT_EVT;
+        }
+        else if ((nrec == 0)
+                 || ((errno != EAGAIN) && (errno != EWOULDBLOCK)))
+        {
+            /* the client hang up */
+            SNPRINTF_LINE("   <COMMS> TCP-IP   Disconn from "
+                          "Host=%s,Port=%d",
+                          inet_ntoa(l_clientAddr.sin_addr),
+                          (int)ntohs(l_clientAddr.sin_port));
+            QSPY_printInfo();
+
+            /* go back to waiting for a client */
+            loop_del(l_clientSock, SRC_TARGET);
+            close(l_clientSock);
+            l_clientSock = INVALID_SOCKET;
+            loop_add(l_serverSock, SRC_TARGET);
         }
     }
 
@@ -526,10 +768,8 @@ static QSpyStatus tcp_send2Target(unsigned char *buf, uint32_t nBytes) {
 /*==========================================================================*/
 /* File communication with the "Target" */
 QSpyStatus PAL_openTargetFile(char const *fName) {
-    int fd;
-
     /* setup the PAL virtual table for the File connection... */
-    PAL_vtbl.getEvt      = &file_getEvt;
+    PAL_vtbl.getEvt      = &loop_getEvt;
     PAL_vtbl.send2Target = &file_send2Target;
     PAL_vtbl.cleanup     = &file_cleanup;
 
@@ -543,8 +783,9 @@ QSpyStatus PAL_openTargetFile(char const *fName) {
     QSPY_reset();   /* reset the QSPY parser to start over cleanly */
     QSPY_txReset(); /* reset the QSPY transmitter */
 
-    fd = fileno(l_file); /* FILE* to file-descriptor */
-    PAL_updateReadySet(fd);  /* fd to be checked in select() */
+    /* NOTE: a regular file cannot be watched by epoll, but it is always
+    * ready, so the event loop does not block while the file is open
+    */
 
     SNPRINTF_LINE("   <COMMS> File     Opened File=%s", fName);
     QSPY_printInfo();
@@ -552,41 +793,9 @@ QSpyStatus PAL_openTargetFile(char const *fName) {
     return QSPY_SUCCESS;
 }
 /*..........................................................................*/
-static QSPYEvtType file_getEvt(unsigned char *buf, uint32_t *pBytes) {
-    QSPYEvtType evtType;
-    uint32_t nBytes;
-    fd_set readSet = l_readSet;
-
-    /* block indefinitely until any input source has input */
-    int nrec = select(l_maxFd, &readSet, 0, 0, NULL);
-
-    if (nrec == 0) {
-        return QSPY_NO_EVT;
-    }
-    else if (nrec < 0) {
-        SNPRINTF_LINE("   <COMMS> ERROR    select() errno=%d", errno);
-        QSPY_printError();
-        return QSPY_ERROR_EVT;
-    }
-
-    /* any input available from the keyboard? */
-    if (l_kbd_inp && FD_ISSET(0, &readSet)) {
-        evtType = PAL_receiveKbd(buf, pBytes);
-        if (evtType != QSPY_NO_EVT) {
-            return evtType;
-        }
-    }
-
-    /* any input available from the Back-End socket? */
-    if ((l_beSock != INVALID_SOCKET) && FD_ISSET(l_beSock, &readSet)) {
-        evtType = PAL_receiveBe(buf, pBytes);
-        if (evtType != QSPY_NO_EVT) {
-            return evtType;
-        }
-    }
-
+static QSPYEvtType file_receive(unsigned char *buf, uint32_t *pBytes) {
     /* try to receive data from the File... */
-    nBytes = FREAD_S(buf, *pBytes, 1U, *pBytes, l_file);
+    uint32_t nBytes = FREAD_S(buf, *pBytes, 1U, *pBytes, l_file);
     if (nBytes > 0) {
         *pBytes = nBytes;
         return QSPY_TARGET_INPUT_EVT;
@@ -612,26 +821,47 @@ static void file_cleanup(void) {
 /*==========================================================================*/
 /* RTT communication with the "Target" via a J-Link probe */
 
+/* NOTE: the J-Link worker thread is already a receive thread, so it
+* fills its own ring (see rtt_link.h) instead of going through rx_watch()
+*/
+enum {
+    RTT_RING_SIZE = 1024*1024 /* must be a power of 2 */
+};
+static uint8_t l_rttRing[RTT_RING_SIZE];
+
 static pthread_t l_threadRTT;
 static rtt_link_worker_arg_t l_rtt_link_args;
 
 QSpyStatus PAL_openTargetRtt(char const *device, uint32_t const serNo) {
 
 	/* setup the PAL virtual table for the RTT Target connection... */
-    PAL_vtbl.getEvt      = &rtt_getEvt;
+    PAL_vtbl.getEvt      = &loop_getEvt;
     PAL_vtbl.send2Target = &rtt_send2Target;
     PAL_vtbl.cleanup     = &rtt_cleanup;
+    l_targetRecv         = &rtt_receive;
 
     l_rtt_link_args.device = device;
     l_rtt_link_args.serNo = serNo;
-    if ((pipe(l_rtt_link_args.fdT2H) == -1) || (pipe(l_rtt_link_args.fdH2T) == -1)) {
+    l_rtt_link_args.t2h.buf  = l_rttRing;
+    l_rtt_link_args.t2h.size = RTT_RING_SIZE;
+    l_rtt_link_args.t2h.drained = 0;
+#ifdef __linux__
+    l_rtt_link_args.t2h.wakeFd[0] = eventfd(0U, EFD_CLOEXEC | EFD_NONBLOCK);
+    l_rtt_link_args.t2h.wakeFd[1] = l_rtt_link_args.t2h.wakeFd[0];
+    if ((l_rtt_link_args.t2h.wakeFd[0] == -1)
+        || (pipe(l_rtt_link_args.fdH2T) == -1))
+#else
+    if ((pipe(l_rtt_link_args.t2h.wakeFd) == -1)
+        || (fcntl(l_rtt_link_args.t2h.wakeFd[0], F_SETFL, O_NONBLOCK) == -1)
+        || (fcntl(l_rtt_link_args.t2h.wakeFd[1], F_SETFL, O_NONBLOCK) == -1)
+        || (pipe(l_rtt_link_args.fdH2T) == -1))
+#endif
+    {
         SNPRINTF_LINE("   <COMMS> ERROR    Cannot open pipe for J-Link");
         QSPY_printError();
         return QSPY_ERROR;
     }
-    if ((fcntl(l_rtt_link_args.fdT2H[0], F_SETFL, O_NONBLOCK) == -1)
-    		|| (fcntl(l_rtt_link_args.fdT2H[1], F_SETFL, O_NONBLOCK) == -1)
-			|| (fcntl(l_rtt_link_args.fdH2T[0], F_SETFL, O_NONBLOCK) == -1)
+    if ((fcntl(l_rtt_link_args.fdH2T[0], F_SETFL, O_NONBLOCK) == -1)
 			|| (fcntl(l_rtt_link_args.fdH2T[1], F_SETFL, O_NONBLOCK) == -1)) {
         SNPRINTF_LINE("   <COMMS> ERROR    Cannot manipulate pipe(s) for J-Link");
         QSPY_printError();
@@ -645,63 +875,54 @@ QSpyStatus PAL_openTargetRtt(char const *device, uint32_t const serNo) {
         return QSPY_ERROR;
     }
 	SNPRINTF_LINE("   <COMMS> RTT      Connecting...");
-    PAL_updateReadySet(l_rtt_link_args.fdT2H[0]);
+    loop_add(l_rtt_link_args.t2h.wakeFd[0], SRC_TARGET);
  	QSPY_reset();   /* reset the QSPY parser to start over cleanly */
 	QSPY_txReset(); /* reset the QSPY transmitter */
 	QSPY_printInfo();
 	return QSPY_SUCCESS;
 }
 /*..........................................................................*/
-static QSPYEvtType rtt_getEvt(unsigned char *buf, uint32_t *pBytes) {
-    QSPYEvtType evtType;
-    int nrec;
-    fd_set readSet = l_readSet;
-
-    /* block indefinitely until any input source has input */
-    do {
-     	nrec = select(l_maxFd, &readSet, 0, 0, NULL);
-    } while (nrec == 0);
-
-    if (nrec == 0) {
-        return QSPY_NO_EVT;
-    }
-    else if (nrec < 0) {
-        SNPRINTF_LINE("   <COMMS> ERROR    select() errno=%d", errno);
-        QSPY_printError();
-        return QSPY_ERROR_EVT;
-    }
-
-    /* any input available from the keyboard? */
-    if (l_kbd_inp && FD_ISSET(0, &readSet)) {
-        evtType = PAL_receiveKbd(buf, pBytes);
-        if (evtType != QSPY_NO_EVT) {
-            return evtType;
+static QSPYEvtType rtt_receive(unsigned char *buf, uint32_t *pBytes) {
+    rtt_ring_t * const ring = &l_rtt_link_args.t2h;
+    uint32_t const tail = atomic_load(&ring->tail);
+    uint32_t head = atomic_load(&ring->head);
+
+    if (head == tail) { /* ring empty? */
+        uint64_t tmp[8];
+        int const done = atomic_load(&ring->done); /* before the head */
+        while (read(ring->wakeFd[0], tmp, sizeof(tmp)) > 0) {
         }
-    }
-
-    /* any input available from the Back-End socket? */
-    if ((l_beSock != INVALID_SOCKET) && FD_ISSET(l_beSock, &readSet)) {
-        evtType = PAL_receiveBe(buf, pBytes);
-        if (evtType != QSPY_NO_EVT) {
-            return evtType;
+        ring->drained = 1;
+        head = atomic_load(&ring->head); /* data since the last check? */
+        if (head == tail) {
+            // A reason will be known at pthread_join()
+            return (done != 0) ? QSPY_ERROR_EVT : QSPY_NO_EVT;
         }
     }
 
-    /* any input available from the RTT? */
-    if (l_rtt_link_args.fdT2H[0] && FD_ISSET(l_rtt_link_args.fdT2H[0], &readSet)) {
-        ssize_t nBytes = read(l_rtt_link_args.fdT2H[0], buf, *pBytes);
-		if (nBytes > 0) {
-            *pBytes = (uint32_t)nBytes;
-            PAL_updateReadySet(l_rtt_link_args.fdT2H[0]);
-            return QSPY_TARGET_INPUT_EVT;
-		}
-		if (nBytes <= 0) {
-			// A reason will be known at pthread_join()
-			return QSPY_ERROR_EVT;
-		}
+    /* the worker read the data straight into the ring, one copy here */
+    uint32_t const off = tail & (ring->size - 1U);
+    uint32_t n = head - tail;
+    if (n > ring->size - off) {
+        n = ring->size - off;
+    }
+    if (n > *pBytes) {
+        n = *pBytes;
     }
+    memcpy(buf, &ring->buf[off], n);
+    atomic_store(&ring->tail, tail + n);
 
-    return QSPY_NO_EVT;
+    /* NOTE: the data left behind after clearing the wake-up must wake up
+    * this side again (see the wake-up protocol in rtt_link.h and the same
+    * in rx_receive())
+    */
+    if ((ring->drained != 0) && (atomic_load(&ring->head) != tail + n)) {
+        uint64_t const one = 1U;
+        ring->drained = 0;
+        (void)write(ring->wakeFd[1], &one, sizeof(one));
+    }
+    *pBytes = n;
+    return QSPY_TARGET_INPUT_EVT;
 }
 /*..........................................................................*/
 static QSpyStatus rtt_send2Target(unsigned char *buf, uint32_t nBytes) {
@@ -720,7 +941,8 @@ static QSpyStatus rtt_send2Target(unsigned char *buf, uint32_t nBytes) {
 /*..........................................................................*/
 static void rtt_cleanup(void) {
 	char const * p;
-	if ((close(l_rtt_link_args.fdT2H[0]) == -1) || close(l_rtt_link_args.fdH2T[1])) {
+    atomic_store(&l_rtt_link_args.t2h.stop, 1); /* ask the worker to exit */
+	if (close(l_rtt_link_args.fdH2T[1]) == -1) {
         SNPRINTF_LINE("   <COMMS> ERROR    Cannot close pipe ends for J-Link");
         QSPY_printError();
 	}
@@ -728,6 +950,17 @@ static void rtt_cleanup(void) {
         SNPRINTF_LINE("   <COMMS> ERROR    Cannot close thread for J-Link");
         QSPY_printError();
 	}
+    loop_del(l_rtt_link_args.t2h.wakeFd[0], SRC_TARGET);
+    close(l_rtt_link_args.t2h.wakeFd[0]);
+    if (l_rtt_link_args.t2h.wakeFd[1] != l_rtt_link_args.t2h.wakeFd[0]) {
+        close(l_rtt_link_args.t2h.wakeFd[1]);
+    }
+    SNPRINTF_LINE("   <COMMS> RTT      Ring=%uK,HighWater=%uK,Overruns=%u",
+                  (unsigned)(l_rtt_link_args.t2h.size / 1024U),
+                  (unsigned)((atomic_load(&l_rtt_link_args.t2h.highWater)
+                              + 1023U) / 1024U),
+                  (unsigned)atomic_load(&l_rtt_link_args.t2h.overruns));
+    QSPY_printInfo();
 	if (p == NULL) {
 		SNPRINTF_LINE("   <COMMS> RTT      J-Link Done");
 		QSPY_printInfo();
@@ -738,6 +971,266 @@ static void rtt_cleanup(void) {
 	}
 }
 
+/*==========================================================================*/
+/* Receive thread (see PAL_configRxThread())
+*
+* The thread only drains the Target link into a single-producer/single-
+* consumer byte ring, so that the Target data keep flowing while the main
+* thread is busy formatting, printing, or writing files. The main thread
+* watches the read end of the wake pipe instead of the link itself.
+*
+* The thread writes to the wake pipe only when the ring was empty before
+* the new data, and the main thread drains the pipe only after it finds
+* the ring empty, so that neither side misses the other.
+*
+* When the ring is full, the thread stops reading the link (an overrun),
+* and the Target data back up into the kernel buffer and ultimately into
+* the Target. When the link reports EOF or an error, the thread exits
+* without consuming it, and the link is given back to the event loop to
+* handle it as without the thread (e.g., the TCP client hang up).
+*/
+enum {
+    RX_RING_MAX = 16*1024*1024, /* must be a power of 2 */
+    RX_FULL_MS  = 1             /* re-check of a full ring [ms] */
+};
+static uint8_t l_rxRing[RX_RING_MAX];
+
+static struct {
+    uint32_t size;          /* ring size, 0 means no receive thread */
+    _Atomic uint32_t head;  /* bytes written (by the receive thread) */
+    _Atomic uint32_t tail;  /* bytes read (by the main thread) */
+    _Atomic bool done;      /* the thread is about to exit */
+    _Atomic uint32_t highWater; /* the most bytes in the ring */
+    _Atomic uint32_t overruns;  /* times the ring was full */
+    _Atomic uint64_t rxUs;  /* receipt of the latest data [us] */
+    bool overrunSeen;       /* the first overrun reported already? */
+    bool drained;           /* main cleared the wake pipe (see rx_receive) */
+    uint64_t bytes;         /* bytes passed to the parser */
+    int fd;                 /* the Target link drained by the thread */
+    int wakeFd[2];          /* pipe thread -> main: data available */
+    int stopFd[2];          /* pipe main -> thread: exit */
+    bool running;
+    pthread_t thread;
+    QSPYEvtType (*recv)(unsigned char *buf, uint32_t *pBytes); /* link's */
+} l_rx;
+
+static void *rx_thread(void *arg);
+static QSPYEvtType rx_receive(unsigned char *buf, uint32_t *pBytes);
+static void rx_join(void);
+
+/*..........................................................................*/
+QSpyStatus PAL_configRxThread(uint32_t *pRingKB) {
+    if ((*pRingKB == 0U) || (*pRingKB > RX_RING_MAX / 1024U)) {
+        return QSPY_ERROR;
+    }
+    uint32_t size = RX_RING_MAX;
+    while (size > *pRingKB * 1024U) { /* the largest power of 2 that fits */
+        size >>= 1;
+    }
+    l_rx.size = size;
+    *pRingKB  = size / 1024U; /* the size actually used */
+    return QSPY_SUCCESS;
+}
+/*..........................................................................*/
+/* watch the Target link in the event loop, via the receive thread if any */
+static void rx_watch(int fd) {
+    if (l_rx.size == 0U) {
+        loop_add(fd, SRC_TARGET);
+        return;
+    }
+
+    if ((pipe(l_rx.wakeFd) == -1) || (pipe(l_rx.stopFd) == -1)
+        || (fcntl(l_rx.wakeFd[0], F_SETFL, O_NONBLOCK) == -1)
+        || (fcntl(l_rx.wakeFd[1], F_SETFL, O_NONBLOCK) == -1))
+    {
+        SNPRINTF_LINE("   <COMMS> ERROR    Cannot open pipe for "
+                      "the receive thread errno=%d", errno);
+        QSPY_printError();
+        loop_add(fd, SRC_TARGET); /* without the receive thread */
+        return;
+    }
+    l_rx.fd = fd;
+    atomic_store(&l_rx.head, 0U);
+    atomic_store(&l_rx.tail, 0U);
+    atomic_store(&l_rx.done, false);
+    atomic_store(&l_rx.highWater, 0U);
+    atomic_store(&l_rx.overruns, 0U);
+    l_rx.overrunSeen = false;
+    l_rx.drained     = false;
+    l_rx.bytes       = 0U;
+    l_rx.recv    = l_targetRecv;
+    l_targetRecv = &rx_receive;
+    loop_add(l_rx.wakeFd[0], SRC_TARGET);
+
+    if (pthread_create(&l_rx.thread, NULL, &rx_thread, NULL) != 0) {
+        SNPRINTF_LINE("   <COMMS> ERROR    %s",
+                      "Cannot create the receive thread");
+        QSPY_printError();
+        rx_join(); /* clean up and fall back to the link itself */
+        return;
+    }
+    l_rx.running = true;
+}
+/*..........................................................................*/
+/* stop the receive thread before closing the Target link */
+static void rx_stop(void) {
+    if (l_rx.running) {
+        (void)write(l_rx.stopFd[1], "x", 1U);
+        rx_join();
+        loop_del(l_rx.fd, SRC_TARGET);
+    }
+}
+/*..........................................................................*/
+/* join the receive thread and give the link back to the event loop */
+static void rx_join(void) {
+    if (l_rx.running) {
+        pthread_join(l_rx.thread, (void **)0);
+        l_rx.running = false;
+
+        SNPRINTF_LINE("   <COMMS> RxThread Ring=%uK,HighWater=%uK,"
+                      "Overruns=%u,Bytes=%"PRIu64,
+                      (unsigned)(l_rx.size / 1024U),
+                      (unsigned)((atomic_load(&l_rx.highWater) + 1023U)
+                                 / 1024U),
+                      (unsigned)atomic_load(&l_rx.overruns),
+                      l_rx.bytes);
+        QSPY_printInfo();
+    }
+    loop_del(l_rx.wakeFd[0], SRC_TARGET);
+    close(l_rx.wakeFd[0]);
+    close(l_rx.wakeFd[1]);
+    close(l_rx.stopFd[0]);
+    close(l_rx.stopFd[1]);
+    l_targetRecv = l_rx.recv;
+    loop_add(l_rx.fd, SRC_TARGET);
+}
+/*..........................................................................*/
+static void *rx_thread(void *arg) {
+    uint32_t const mask = l_rx.size - 1U;
+    uint32_t head = atomic_load(&l_rx.head);
+    bool full = false;
+    struct pollfd pfd[2];
+
+    (void)arg; /* unused parameter */
+
+    pfd[0].fd     = l_rx.stopFd[0];
+    pfd[0].events = POLLIN;
+    pfd[1].fd     = l_rx.fd;
+    pfd[1].events = POLLIN;
+    for (;;) {
+        uint32_t const used = head - atomic_load(&l_rx.tail);
+        if (used == l_rx.size) { /* ring full? */
+            if (!full) {
+                full = true;
+                atomic_fetch_add(&l_rx.overruns, 1U);
+            }
+            if (poll(pfd, 1, RX_FULL_MS) > 0) { /* stop requested? */
+                break;
+            }
+            continue;
+        }
+        full = false;
+
+        if (poll(pfd, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (pfd[0].revents != 0) { /* stop requested? */
+            break;
+        }
+        if (pfd[1].revents == 0) {
+            continue;
+        }
+
+        /* read straight into the contiguous free space of the ring */
+        uint32_t const off = head & mask;
+        uint32_t n = l_rx.size - used;
+        if (n > l_rx.size - off) {
+            n = l_rx.size - off;
+        }
+        ssize_t nBytes = read(l_rx.fd, &l_rxRing[off], n);
+        if (nBytes > 0) {
+            uint32_t const prev = head;
+            atomic_store(&l_rx.rxUs, loop_nowUs()); /* before the head */
+            head += (uint32_t)nBytes;
+            atomic_store(&l_rx.head, head);
+            if (atomic_load(&l_rx.tail) == prev) { /* was empty? */
+                (void)write(l_rx.wakeFd[1], "x", 1U);
+            }
+            if (used + (uint32_t)nBytes > atomic_load(&l_rx.highWater)) {
+                atomic_store(&l_rx.highWater, used + (uint32_t)nBytes);
+            }
+        }
+        else if ((nBytes == 0)
+                 || ((errno != EAGAIN) && (errno != EWOULDBLOCK)
+                     && (errno != EINTR)))
+        {
+            break; /* EOF or error, left to the link (see rx_join()) */
+        }
+    }
+
+    atomic_store(&l_rx.done, true);
+    (void)write(l_rx.wakeFd[1], "x", 1U);
+    return (void *)0;
+}
+/*..........................................................................*/
+static QSPYEvtType rx_receive(unsigned char *buf, uint32_t *pBytes) {
+    uint32_t const tail = atomic_load(&l_rx.tail);
+    uint32_t head = atomic_load(&l_rx.head);
+
+    if (head == tail) { /* ring empty? */
+        uint8_t tmp[64];
+        bool const done = atomic_load(&l_rx.done); /* before the head */
+        while (read(l_rx.wakeFd[0], tmp, sizeof(tmp)) > 0) {
+        }
+        l_rx.drained = true;
+        head = atomic_load(&l_rx.head); /* data since the last check? */
+        if (head == tail) {
+            if (done) {
+                rx_join(); /* the link goes back to the event loop */
+            }
+            return QSPY_NO_EVT;
+        }
+    }
+
+    uint32_t const off = tail & (l_rx.size - 1U);
+    uint32_t n = head - tail;
+    if (n > l_rx.size - off) {
+        n = l_rx.size - off;
+    }
+    if (n > *pBytes) {
+        n = *pBytes;
+    }
+    memcpy(buf, &l_rxRing[off], n);
+    atomic_store(&l_rx.tail, tail + n);
+
+    /* NOTE: the thread wakes up this side only when the ring was empty,
+    * so the wake pipe is readable whenever the ring holds data, except
+    * after this side drained the pipe. From then on until the ring is
+    * empty again, the wake-up is owed by this side: the data left behind
+    * (e.g., the event loop drops the Target out of its budget next) must
+    * wake it up again. The head is read after the tail is published, so
+    * either the thread or this side sees the data of a concurrent write.
+    */
+    if (l_rx.drained && (atomic_load(&l_rx.head) != tail + n)) {
+        l_rx.drained = false;
+        (void)write(l_rx.wakeFd[1], "x", 1U);
+    }
+    l_rxUs = atomic_load(&l_rx.rxUs); /* not when the chunk was taken */
+    l_rx.bytes += n;
+    *pBytes = n;
+
+    if (!l_rx.overrunSeen && (atomic_load(&l_rx.overruns) != 0U)) {
+        l_rx.overrunSeen = true; /* the totals come with rx_join() */
+        SNPRINTF_LINE("   <COMMS> RxThread %s",
+                      "Ring full, reading paused (consider larger -R)");
+        QSPY_printError();
+    }
+    return QSPY_TARGET_INPUT_EVT;
+}
+
 /*==========================================================================*/
 /* Front-End interface  */
 QSpyStatus PAL_openBE(int portNum) {
@@ -787,22 +1280,36 @@ QSpyStatus PAL_openBE(int portNum) {
     }
 
     BE_onStartup();  /* Back-End startup callback */
-
-    /* NOTE:
-    * The Back-End socket l_beSock needs to be checked in select() just
-    * like all other sources of input. However, the l_beSock socket is
-    * added automatically in the PAL_updateReadySet() function *later* in
-    * the initialization phase. This assumes that PAL_openBE() is called
-    * always *before* opening the specific Target link (see configure() in
-    * main.c).
-    */
+    loop_add(l_beSock, SRC_BE); /* to be watched in the event loop */
 
     return QSPY_SUCCESS;
 }
 /*..........................................................................*/
 void PAL_closeBE(void) {
     if (l_beSock != INVALID_SOCKET) {
-        if (l_feAddrSize != FE_DETACHED) { /* front-end attached? */
+        int fe;
+        for (fe = 0; fe < PAL_FE_MAX; ++fe) {
+            if (l_beConn
+                ? (l_feSock[fe] != INVALID_SOCKET)
+                : (l_feAddrSize[fe] != FE_DETACHED)) /* attached? */
+            {
+                break;
+            }
+        }
+        if (l_beConn) {
+            /* Back-End cleanup callback (send detach packet)... */
+            BE_onCleanup(); /* NOTE: the connected sends are blocking */
+
+            for (fe = 0; fe < PAL_FE_MAX; ++fe) {
+                conn_closeFE(fe); /* flushes the coalesced TCP frames */
+            }
+            if (!l_beTcp) {
+                unlink(l_beUnixAddr.sun_path);
+            }
+            l_beConn = false;
+            l_beTcp  = false;
+        }
+        else if (fe < PAL_FE_MAX) { /* any front-end attached? */
             fd_set writeSet;
             struct timeval delay;
 
@@ -830,12 +1337,19 @@ void PAL_closeBE(void) {
     }
 }
 /*..........................................................................*/
-void PAL_send2FE(unsigned char const *buf, uint32_t nBytes) {
-    if (l_feAddrSize != FE_DETACHED) { /* front-end attached? */
+void PAL_send2FE(int fe, unsigned char const *buf, uint32_t nBytes) {
+    if (l_beTcp) {
+        tcp_send2FE(fe, buf, nBytes);
+    }
+    else if (l_beConn) {
+        unix_send2FE(fe, buf, nBytes);
+    }
+    else if (l_feAddrSize[fe] != FE_DETACHED) { /* front-end attached? */
         if (sendto(l_beSock, (char *)buf, (int)nBytes, 0,
-                   &l_feAddr.addr, l_feAddrSize) == SOCKET_ERROR)
+                   &l_feAddr[fe].addr, l_feAddrSize[fe]) == SOCKET_ERROR)
         {
-            PAL_detachFE(); /* detach the Front-End */
+            PAL_detachFE(fe); /* detach the Front-End */
+            BE_onDetach(fe);
 
             SNPRINTF_LINE("   <F-END> ERROR    UDP socket failed errno=%d",
                           errno);
@@ -844,10 +1358,489 @@ void PAL_send2FE(unsigned char const *buf, uint32_t nBytes) {
     }
 }
 /*..........................................................................*/
-void PAL_detachFE(void) {
-    l_feAddrSize = FE_DETACHED;
+void PAL_detachFE(int fe) {
+    if (l_beConn) {
+        conn_closeFE(fe);
+    }
+    else {
+        l_feAddrSize[fe] = FE_DETACHED;
+    }
+}
+/*..........................................................................*/
+void PAL_flushBE(void) {
+    if (l_beTcp) {
+        int fe;
+        for (fe = 0; fe < PAL_FE_MAX; ++fe) {
+            tcp_flushFE(fe);
+        }
+    }
+}
+/*..........................................................................*/
+int PAL_currFE(void) {
+    return l_feCurr;
 }
 
+/*==========================================================================*/
+/* Unix-domain Front-End interface (local Front-Ends only)
+*
+* Each Front-End has its own SOCK_SEQPACKET connection, which preserves
+* the packet boundaries of the UDP Back-End (see BE_parse()), but does not
+* drop packets when the Front-End falls behind.
+*/
+QSpyStatus PAL_openBEUnix(char const *path) {
+    struct stat st;
+
+    memset(&l_beUnixAddr, 0, sizeof(l_beUnixAddr));
+    l_beUnixAddr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(l_beUnixAddr.sun_path)) {
+        SNPRINTF_LINE("   <F-END> ERROR    Unix socket path too long "
+                      "Path=%s", path);
+        QSPY_printError();
+        return QSPY_ERROR;
+    }
+    STRNCPY_S(l_beUnixAddr.sun_path, sizeof(l_beUnixAddr.sun_path), path);
+
+    l_beSock = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    if (l_beSock == INVALID_SOCKET) {
+        SNPRINTF_LINE("   <F-END> ERROR    Unix socket create errno=%d",
+                      errno);
+        QSPY_printError();
+        return QSPY_ERROR;
+    }
+
+    /* remove the stale socket left by a previous QSPY run (only a socket) */
+    if ((stat(path, &st) == 0) && S_ISSOCK(st.st_mode)) {
+        unlink(path);
+    }
+    if (bind(l_beSock, (struct sockaddr *)&l_beUnixAddr,
+             sizeof(l_beUnixAddr)) == SOCKET_ERROR)
+    {
+        SNPRINTF_LINE("   <F-END> ERROR    Unix socket binding "
+                      "Path=%s,errno=%d", path, errno);
+        QSPY_printError();
+        return QSPY_ERROR;
+    }
+    return conn_listen(l_beSock, "Unix");
+}
+/*..........................................................................*/
+/* TCP Front-End interface (remote Front-Ends)
+*
+* TCP does not preserve the packet boundaries (see BE_parse()), so each
+* packet travels in a frame [len-lo][len-hi][packet] in both directions.
+* Nagle's algorithm is disabled and the frames are coalesced per iteration
+* of the event loop instead. The blocking writes provide the flow control.
+*/
+QSpyStatus PAL_openBETcp(int portNum) {
+    struct sockaddr_in local;
+    int on = 1;
+
+    l_beSock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (l_beSock == INVALID_SOCKET) {
+        SNPRINTF_LINE("   <F-END> ERROR    TCP socket create errno=%d",
+                      errno);
+        QSPY_printError();
+        return QSPY_ERROR;
+    }
+    setsockopt(l_beSock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = INADDR_ANY;
+    local.sin_port = htons((unsigned short)portNum);
+    if (bind(l_beSock, (struct sockaddr *)&local, sizeof(local))
+        == SOCKET_ERROR)
+    {
+        SNPRINTF_LINE("   <F-END> ERROR    TCP socket binding errno=%d",
+                      errno);
+        QSPY_printError();
+        return QSPY_ERROR;
+    }
+    l_beTcp = true;
+
+    return conn_listen(l_beSock, "TCP");
+}
+/*..........................................................................*/
+static QSpyStatus conn_listen(int sock, char const *kind) {
+    int flags;
+    int fe;
+
+    if (listen(sock, PAL_FE_MAX) == SOCKET_ERROR) {
+        SNPRINTF_LINE("   <F-END> ERROR    %s socket listen errno=%d",
+                      kind, errno);
+        QSPY_printError();
+        return QSPY_ERROR;
+    }
+
+    /* put the listening socket into NON-BLOCKING mode (for accept()) */
+    flags = fcntl(sock, F_GETFL, 0);
+    if ((flags == SOCKET_ERROR)
+        || (fcntl(sock, F_SETFL, flags | O_NONBLOCK) != 0))
+    {
+        SNPRINTF_LINE("   <F-END> ERROR    %s socket fcntl() errno=%d",
+                      kind, errno);
+        QSPY_printError();
+        return QSPY_ERROR;
+    }
+
+    for (fe = 0; fe < PAL_FE_MAX; ++fe) {
+        l_feSock[fe] = INVALID_SOCKET;
+        l_feTcp[fe].rxLen = 0U;
+        l_feTcp[fe].txLen = 0U;
+#ifdef __linux__
+        l_feShm[fe].ring  = (ShmRing *)0;
+        l_feShm[fe].memFd = -1;
+        l_feShm[fe].evtFd = -1;
+#endif
+    }
+    l_beConn = true;
+
+    BE_onStartup();  /* Back-End startup callback */
+    loop_add(sock, SRC_BE); /* watch for the connecting Front-Ends */
+
+    return QSPY_SUCCESS;
+}
+/*..........................................................................*/
+static void conn_accept(void) {
+    int fe;
+
+    /* a new Front-End connecting? */
+    int sock = accept(l_beSock, (struct sockaddr *)0, (socklen_t *)0);
+    if (sock == INVALID_SOCKET) {
+        return;
+    }
+    for (fe = 0; fe < PAL_FE_MAX; ++fe) {
+        if (l_feSock[fe] == INVALID_SOCKET) {
+            break;
+        }
+    }
+    if (fe == PAL_FE_MAX) { /* no free entries? */
+        SNPRINTF_LINE("   <F-END> WARN     %s socket in use "
+                      "(too many Front-Ends)", l_beTcp ? "TCP" : "Unix");
+        QSPY_printError();
+        close(sock);
+    }
+    else {
+        /* don't let a stalled Front-End block QSPY indefinitely */
+        struct timeval tout;
+        tout.tv_sec  = 1;
+        tout.tv_usec = 0;
+        setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tout, sizeof(tout));
+        if (l_beTcp) {
+            int on = 1; /* the frames are coalesced by QSPY instead */
+            setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+            l_feTcp[fe].rxLen = 0U;
+            l_feTcp[fe].txLen = 0U;
+        }
+
+        l_feSock[fe] = sock;
+        loop_add(sock, (uint8_t)(SRC_FE + fe)); /* watch in the event loop */
+    }
+}
+/*..........................................................................*/
+static QSPYEvtType conn_receiveFE(int fe, unsigned char *buf,
+                                  uint32_t *pBytes)
+{
+    if (l_feSock[fe] == INVALID_SOCKET) { /* disconnected meanwhile? */
+        return QSPY_NO_EVT;
+    }
+    ssize_t nBytes = l_beTcp
+        ? tcp_recvFE(fe, buf, pBytes)
+        : recv(l_feSock[fe], buf, *pBytes, MSG_DONTWAIT);
+    if (nBytes > 0) {
+        l_feCurr = fe;
+        *pBytes = (uint32_t)nBytes;
+        return QSPY_FE_INPUT_EVT;
+    }
+    else if ((nBytes == 0)
+             || ((errno != EAGAIN) && (errno != EWOULDBLOCK)))
+    {
+        /* the Front-End went away without detaching */
+        l_feTcp[fe].txLen = 0U; /* nobody to send to anymore */
+        conn_closeFE(fe);
+        BE_onDetach(fe);
+        SNPRINTF_LINE("   <F-END> Disconn  FE=%d", fe);
+        QSPY_printInfo();
+    }
+    return QSPY_NO_EVT;
+}
+/*..........................................................................*/
+static void unix_send2FE(int fe, unsigned char const *buf, uint32_t nBytes) {
+    struct iovec  iov;
+    struct msghdr msg;
+
+    if (l_feSock[fe] == INVALID_SOCKET) { /* not connected? */
+        return;
+    }
+#ifdef __linux__
+    union { /* aligned space for passing the ring's file descriptors */
+        struct cmsghdr hdr;
+        char buf[CMSG_SPACE(2 * sizeof(int))];
+    } ctrl;
+
+    if ((l_feShm[fe].ring != (ShmRing *)0) && (l_feShm[fe].memFd < 0)) {
+        shm_send2FE(fe, buf, nBytes); /* the ring is in use */
+        return;
+    }
+#endif
+
+    iov.iov_base = (void *)buf;
+    iov.iov_len  = nBytes;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov    = &iov;
+    msg.msg_iovlen = 1;
+#ifdef __linux__
+    if (l_feShm[fe].memFd >= 0) { /* pass the ring with this packet? */
+        struct cmsghdr *cmsg;
+        int fds[2];
+        fds[0] = l_feShm[fe].memFd;
+        fds[1] = l_feShm[fe].evtFd;
+        memset(&ctrl, 0, sizeof(ctrl));
+        msg.msg_control    = ctrl.buf;
+        msg.msg_controllen = sizeof(ctrl.buf);
+        cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type  = SCM_RIGHTS;
+        cmsg->cmsg_len   = CMSG_LEN(sizeof(fds));
+        memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+    }
+#endif
+
+    if (sendmsg(l_feSock[fe], &msg, MSG_NOSIGNAL) == SOCKET_ERROR) {
+        conn_closeFE(fe);
+        BE_onDetach(fe);
+
+        SNPRINTF_LINE("   <F-END> ERROR    Unix socket failed "
+                      "FE=%d,errno=%d", fe, errno);
+        QSPY_printError();
+        return;
+    }
+#ifdef __linux__
+    if (l_feShm[fe].memFd >= 0) { /* the ring has been passed? */
+        close(l_feShm[fe].memFd); /* the mapping remains */
+        l_feShm[fe].memFd = -1;   /* the next packets go to the ring */
+    }
+#endif
+}
+/*..........................................................................*/
+static void conn_closeFE(int fe) {
+    if (l_feSock[fe] != INVALID_SOCKET) {
+        if (l_beTcp) {
+            tcp_flushFE(fe); /* e.g., the DETACH confirmation */
+        }
+        loop_del(l_feSock[fe], (uint8_t)(SRC_FE + fe));
+        close(l_feSock[fe]);
+        l_feSock[fe] = INVALID_SOCKET;
+    }
+#ifdef __linux__
+    shm_close(fe);
+#endif
+}
+
+/*..........................................................................*/
+/* receive (a part of) the next frame from the Front-End. Only the bytes
+* of the current frame are read, so that the following frames remain in
+* the socket and keep it readable for select().
+* returns: the packet length when the frame is complete, -1 with errno
+* EAGAIN when the frame is still incomplete, 0 or -1 when disconnected.
+*/
+static int tcp_recvFE(int fe, unsigned char *buf, uint32_t *pBytes) {
+    uint32_t const rxLen = l_feTcp[fe].rxLen;
+    uint32_t need = TCP_FRAME_HDR - rxLen;
+    if (rxLen >= TCP_FRAME_HDR) {
+        need = TCP_FRAME_HDR + ((uint32_t)l_feTcp[fe].rx[0]
+                                | ((uint32_t)l_feTcp[fe].rx[1] << 8)) - rxLen;
+    }
+
+    ssize_t n = recv(l_feSock[fe], &l_feTcp[fe].rx[rxLen], need,
+                     MSG_DONTWAIT);
+    if (n <= 0) {
+        return (int)n;
+    }
+    l_feTcp[fe].rxLen += (uint32_t)n;
+
+    if (l_feTcp[fe].rxLen == TCP_FRAME_HDR) { /* just got the header? */
+        uint32_t len = (uint32_t)l_feTcp[fe].rx[0]
+                       | ((uint32_t)l_feTcp[fe].rx[1] << 8);
+        if ((len == 0U) || (len > TCP_RX_SIZE - TCP_FRAME_HDR)
+            || (len > *pBytes))
+        {
+            SNPRINTF_LINE("   <F-END> ERROR    TCP frame size FE=%d,Len=%d",
+                          fe, (int)len);
+            QSPY_printError();
+            return 0; /* the stream is out of sync, disconnect */
+        }
+    }
+    else if (l_feTcp[fe].rxLen > TCP_FRAME_HDR) {
+        uint32_t len = (uint32_t)l_feTcp[fe].rx[0]
+                       | ((uint32_t)l_feTcp[fe].rx[1] << 8);
+        if (l_feTcp[fe].rxLen == TCP_FRAME_HDR + len) { /* complete? */
+            memcpy(buf, &l_feTcp[fe].rx[TCP_FRAME_HDR], len);
+            l_feTcp[fe].rxLen = 0U;
+            *pBytes = len;
+            return (int)len;
+        }
+    }
+    errno = EAGAIN;
+    return -1;
+}
+/*..........................................................................*/
+static void tcp_send2FE(int fe, unsigned char const *buf, uint32_t nBytes) {
+    if (l_feSock[fe] == INVALID_SOCKET) { /* not connected? */
+        return;
+    }
+    if (l_feTcp[fe].txLen + TCP_FRAME_HDR + nBytes > TCP_TX_SIZE) {
+        tcp_flushFE(fe); /* make room */
+    }
+    uint8_t *pos = &l_feTcp[fe].tx[l_feTcp[fe].txLen];
+    *pos++ = (uint8_t)nBytes;
+    *pos++ = (uint8_t)(nBytes >> 8);
+    memcpy(pos, buf, nBytes);
+    l_feTcp[fe].txLen += TCP_FRAME_HDR + nBytes;
+}
+/*..........................................................................*/
+static void tcp_flushFE(int fe) {
+    uint32_t sent = 0U;
+    while (sent < l_feTcp[fe].txLen) {
+        /* blocking write, bounded by SO_SNDTIMEO (flow control) */
+        ssize_t n = send(l_feSock[fe], &l_feTcp[fe].tx[sent],
+                         l_feTcp[fe].txLen - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            l_feTcp[fe].txLen = 0U;
+            conn_closeFE(fe);
+            BE_onDetach(fe);
+
+            SNPRINTF_LINE("   <F-END> ERROR    TCP socket failed "
+                          "FE=%d,errno=%d", fe, errno);
+            QSPY_printError();
+            return;
+        }
+        sent += (uint32_t)n;
+    }
+    l_feTcp[fe].txLen = 0U;
+}
+/*..........................................................................*/
+QSpyStatus PAL_configShmFE(int fe, bool shm) {
+#ifdef __linux__
+    size_t const size = sizeof(ShmRing) + SHM_SIZE;
+    ShmRing *ring;
+    int memFd;
+    int evtFd;
+
+    if (l_beConn) {
+        shm_close(fe); /* discard the previous ring (if any) */
+    }
+    if (!shm) {
+        return QSPY_SUCCESS;
+    }
+    if (!l_beConn || l_beTcp) {
+        SNPRINTF_LINE("   <F-END> ERROR    %s",
+                      "Shared memory requires the Unix-domain Back-End");
+        QSPY_printError();
+        return QSPY_ERROR;
+    }
+
+    memFd = memfd_create("qspy-ring", MFD_CLOEXEC);
+    if ((memFd < 0) || (ftruncate(memFd, (off_t)size) != 0)) {
+        SNPRINTF_LINE("   <F-END> ERROR    Shared memory create errno=%d",
+                      errno);
+        QSPY_printError();
+        if (memFd >= 0) {
+            close(memFd);
+        }
+        return QSPY_ERROR;
+    }
+    ring = (ShmRing *)mmap((void *)0, size, PROT_READ | PROT_WRITE,
+                           MAP_SHARED, memFd, 0);
+    evtFd = eventfd(0U, EFD_CLOEXEC | EFD_NONBLOCK);
+    if ((ring == (ShmRing *)MAP_FAILED) || (evtFd < 0)) {
+        SNPRINTF_LINE("   <F-END> ERROR    Shared memory map errno=%d",
+                      errno);
+        QSPY_printError();
+        if (ring != (ShmRing *)MAP_FAILED) {
+            munmap(ring, size);
+        }
+        if (evtFd >= 0) {
+            close(evtFd);
+        }
+        close(memFd);
+        return QSPY_ERROR;
+    }
+
+    ring->magic   = SHM_MAGIC;
+    ring->size    = SHM_SIZE;
+    ring->dropped = 0U;
+    ring->head    = 0U;
+    ring->tail    = 0U;
+
+    l_feShm[fe].ring  = ring;
+    l_feShm[fe].memFd = memFd; /* to be passed with the next packet */
+    l_feShm[fe].evtFd = evtFd;
+    return QSPY_SUCCESS;
+#else
+    (void)fe; /* unused parameter */
+    if (!shm) {
+        return QSPY_SUCCESS;
+    }
+    SNPRINTF_LINE("   <F-END> ERROR    %s",
+                  "Shared memory not supported on this platform");
+    QSPY_printError();
+    return QSPY_ERROR;
+#endif
+}
+
+#ifdef __linux__
+/*..........................................................................*/
+static void shm_close(int fe) {
+    if (l_feShm[fe].ring != (ShmRing *)0) {
+        munmap(l_feShm[fe].ring, sizeof(ShmRing) + SHM_SIZE);
+        l_feShm[fe].ring = (ShmRing *)0;
+    }
+    if (l_feShm[fe].memFd >= 0) {
+        close(l_feShm[fe].memFd);
+        l_feShm[fe].memFd = -1;
+    }
+    if (l_feShm[fe].evtFd >= 0) {
+        close(l_feShm[fe].evtFd);
+        l_feShm[fe].evtFd = -1;
+    }
+}
+/*..........................................................................*/
+static void shm_send2FE(int fe, unsigned char const *buf, uint32_t nBytes) {
+    ShmRing * const ring = l_feShm[fe].ring;
+    uint32_t const need = (2U + nBytes + 3U) & ~3U; /* padded to 4 bytes */
+    uint32_t const head0 = ring->head; /* only QSPY writes the head */
+    uint32_t const tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    uint32_t head = head0;
+    uint32_t pos  = head & (SHM_SIZE - 1U);
+    uint32_t skip = 0U;
+
+    if (SHM_SIZE - pos < need) { /* the packet would wrap around? */
+        skip = SHM_SIZE - pos;
+    }
+    if (SHM_SIZE - (head - tail) < skip + need) { /* no room? */
+        ++ring->dropped; /* NOTE: the Front-End also sees the gap in seq */
+        return;
+    }
+    if (skip != 0U) {
+        ring->data[pos]      = (uint8_t)SHM_WRAP;
+        ring->data[pos + 1U] = (uint8_t)(SHM_WRAP >> 8);
+        head += skip;
+        pos = 0U;
+    }
+    ring->data[pos]      = (uint8_t)nBytes;
+    ring->data[pos + 1U] = (uint8_t)(nBytes >> 8);
+    memcpy(&ring->data[pos + 2U], buf, nBytes);
+    __atomic_store_n(&ring->head, head + need, __ATOMIC_SEQ_CST); /* publish */
+
+    /* wake up the Front-End only if it has consumed everything before */
+    if (__atomic_load_n(&ring->tail, __ATOMIC_SEQ_CST) == head0) {
+        uint64_t const one = 1U;
+        ssize_t n = write(l_feShm[fe].evtFd, &one, sizeof(one));
+        (void)n; /* a saturated counter still wakes the Front-End */
+    }
+}
+#endif /* __linux__ */
+
 /*..........................................................................*/
 void PAL_clearScreen(void) {
     int status = system("clear");
@@ -862,72 +1855,293 @@ void PAL_clearScreen(void) {
 QSPYEvtType PAL_receiveBe(unsigned char *buf, uint32_t *pBytes) {
     fe_addr feAddr;
     socklen_t feAddrSize;
-    uint32_t nBytes;
+    ssize_t nBytes;
 
     if (l_beSock == INVALID_SOCKET) { /* Back-End socket not initialized? */
         return QSPY_NO_EVT;
     }
+    if (l_beConn) {
+        conn_accept(); /* the Front-Ends are watched separately */
+        return QSPY_NO_EVT;
+    }
 
-    /* receive a packet from the Back-End socket */
+    /* receive a packet from the (non-blocking) Back-End socket */
     feAddrSize = sizeof(feAddr);
     nBytes = recvfrom(l_beSock, buf, *pBytes, 0,
                       &feAddr.addr, &feAddrSize);
 
-    if (nBytes == 0)  { /* socket error */
-        PAL_detachFE(); /* detach from the Front-End */
+    if ((nBytes < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK))) {
+        return QSPY_NO_EVT; /* all packets received */
+    }
+    else if (nBytes <= 0)  { /* socket error */
         SNPRINTF_LINE("   <F-END> ERROR    "
             "UDP socket recvfrom() errno=%d", errno);
         QSPY_printError();
         return QSPY_ERROR_EVT;
     }
-    else if (l_feAddrSize == 0) { /* not attached yet? */
-        memcpy(&l_feAddr, &feAddr, feAddrSize);
-        l_feAddrSize = feAddrSize; /* attach connection */
-        *pBytes = nBytes;
-        return QSPY_FE_INPUT_EVT;
-    }
-    else { /* already attached */
-        /* is this from the attached front-end address? */
-        if ((feAddrSize == l_feAddrSize)
-            && (feAddr.data[1] == l_feAddr.data[1])
-            && (feAddr.data[0] == l_feAddr.data[0]))
-        {
-            *pBytes = nBytes;
-            return QSPY_FE_INPUT_EVT;
+    else {
+        int fe;
+        int feFree = PAL_FE_MAX;
+
+        /* is this from one of the attached front-end addresses? */
+        for (fe = 0; fe < PAL_FE_MAX; ++fe) {
+            if (l_feAddrSize[fe] == FE_DETACHED) {
+                if (feFree == PAL_FE_MAX) {
+                    feFree = fe; /* remember the first free entry */
+                }
+            }
+            else if ((feAddrSize == l_feAddrSize[fe])
+                && (feAddr.data[1] == l_feAddr[fe].data[1])
+                && (feAddr.data[0] == l_feAddr[fe].data[0]))
+            {
+                break;
+            }
         }
-        else {
-            SNPRINTF_LINE("   <F-END> WARN     %s",
-                          "UDP socket in use");
-            QSPY_printError();
-            /* this packet is from a DIFFERENT front-end -- ignore it */
+        if (fe == PAL_FE_MAX) { /* a new front-end? */
+            if (feFree == PAL_FE_MAX) { /* no free entries? */
+                SNPRINTF_LINE("   <F-END> WARN     %s",
+                              "UDP socket in use (too many Front-Ends)");
+                QSPY_printError();
+                /* this packet is from yet another front-end -- ignore it */
+                return QSPY_NO_EVT;
+            }
+            fe = feFree;
+            memcpy(&l_feAddr[fe], &feAddr, feAddrSize);
+            l_feAddrSize[fe] = feAddrSize; /* attach connection */
         }
+        l_feCurr = fe;
+        *pBytes = (uint32_t)nBytes;
+        return QSPY_FE_INPUT_EVT;
     }
-    return QSPY_NO_EVT;
 }
 
 /*..........................................................................*/
 QSPYEvtType PAL_receiveKbd(unsigned char *buf, uint32_t *pBytes) {
-    *pBytes = read(0, buf, 1); /* the key pressed */
-    if (*pBytes > 0) {
+    ssize_t nBytes = read(0, buf, 1); /* the key pressed */
+    if (nBytes > 0) {
+        *pBytes = (uint32_t)nBytes;
         return QSPY_KEYBOARD_EVT;
     }
     return QSPY_NO_EVT;
 }
 /*..........................................................................*/
-void PAL_updateReadySet(int targetConn) {
-    FD_ZERO(&l_readSet);
-    FD_SET(0, &l_readSet); /* terminal to be checked in select */
-    l_maxFd = 1;
-    FD_SET(targetConn, &l_readSet); /* check in select */
-    if (l_maxFd < targetConn + 1) {
-        l_maxFd = targetConn + 1;
+QSpyStatus PAL_setTimer(uint32_t periodMs) {
+    l_timerPeriod = periodMs;
+    l_timerNext   = loop_nowMs() + periodMs;
+    return QSPY_SUCCESS;
+}
+
+/*..........................................................................*/
+uint64_t PAL_rxTimeUs(void) {
+    return l_rxUs; /* 0 for the file input, which has no receipt times */
+}
+
+/*==========================================================================*/
+/* the event loop */
+static QSPYEvtType loop_getEvt(unsigned char *buf, uint32_t *pBytes) {
+    uint32_t const size = *pBytes;
+    for (;;) {
+        /* serve the ready sources round-robin, one event at a time */
+        while (l_nReady > 0) {
+            if (l_iReady >= l_nReady) {
+                l_iReady = 0; /* wrap around */
+            }
+            uint8_t const src = l_ready[l_iReady].src;
+            *pBytes = size;
+            QSPYEvtType evt = loop_serve(src, buf, pBytes);
+
+            /* NOTE: serving the source might have removed it already
+            * (see loop_del()), in which case l_iReady is the next one
+            */
+            if ((l_iReady < l_nReady) && (l_ready[l_iReady].src == src)) {
+                if ((evt == QSPY_NO_EVT)
+                    || (--l_ready[l_iReady].budget == 0U))
+                {
+                    loop_drop(l_iReady); /* drained or out of budget */
+                }
+                else {
+                    ++l_iReady; /* the next source goes next */
+                }
+            }
+            if (evt != QSPY_NO_EVT) {
+                l_busy = true;
+                return evt;
+            }
+        }
+
+        /* all ready sources drained, a good time to flush the output */
+        if (l_busy) {
+            l_busy = false;
+            *pBytes = 0U;
+            return QSPY_NO_EVT;
+        }
+        if (loop_wait() != QSPY_SUCCESS) {
+            return QSPY_ERROR_EVT;
+        }
+    }
+}
+/*..........................................................................*/
+static QSPYEvtType loop_serve(uint8_t src,
+                              unsigned char *buf, uint32_t *pBytes)
+{
+    switch (src) {
+        case SRC_KBD:
+            return PAL_receiveKbd(buf, pBytes);
+        case SRC_TARGET:
+            l_rxUs = loop_nowUs(); /* NOTE: rx_receive() knows better */
+            return (*l_targetRecv)(buf, pBytes);
+        case SRC_FILE:
+            return file_receive(buf, pBytes);
+        case SRC_BE:
+            return PAL_receiveBe(buf, pBytes);
+        case SRC_TIMER:
+            return QSPY_TIMER_EVT;
+        default:
+            return conn_receiveFE(src - SRC_FE, buf, pBytes);
     }
-    if (l_beSock != INVALID_SOCKET) {
-        FD_SET(l_beSock, &l_readSet); /* check in select */
-        if (l_maxFd < l_beSock + 1) {
-            l_maxFd = l_beSock + 1;
+}
+/*..........................................................................*/
+static QSpyStatus loop_wait(void) {
+    int tout = -1; /* block indefinitely */
+    int n;
+    int i;
+
+    if (l_timerPeriod != 0U) {
+        uint64_t const now = loop_nowMs();
+        tout = (l_timerNext > now) ? (int)(l_timerNext - now) : 0;
+    }
+    if (l_file != (FILE *)0) {
+        tout = 0; /* the file is always ready */
+    }
+
+#ifdef __linux__
+    struct epoll_event evts[SRC_MAX];
+    if (l_epollFd < 0) { /* no sources to watch (yet)? */
+        l_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    }
+    n = epoll_wait(l_epollFd, evts, SRC_MAX, tout);
+#else
+    n = poll(l_pollFd, (nfds_t)l_nPoll, tout);
+#endif
+    if (n < 0) {
+        if (errno == EINTR) { /* interrupted by a signal? */
+            return QSPY_SUCCESS; /* nothing ready, wait again */
+        }
+        SNPRINTF_LINE("   <COMMS> ERROR    Event loop wait errno=%d", errno);
+        QSPY_printError();
+        return QSPY_ERROR;
+    }
+
+    l_nReady = 0;
+    l_iReady = 0;
+#ifdef __linux__
+    for (i = 0; i < n; ++i) {
+        loop_ready((uint8_t)evts[i].data.u32);
+    }
+#else
+    for (i = 0; (i < l_nPoll) && (n > 0); ++i) {
+        if (l_pollFd[i].revents != 0) {
+            loop_ready(l_pollSrc[i]);
+            --n;
+        }
+    }
+#endif
+    if (l_file != (FILE *)0) {
+        loop_ready(SRC_FILE);
+    }
+    if (l_timerPeriod != 0U) {
+        uint64_t const now = loop_nowMs();
+        if (now >= l_timerNext) {
+            loop_ready(SRC_TIMER);
+            l_timerNext += l_timerPeriod;
+            if (l_timerNext <= now) { /* fell behind, e.g., a long event? */
+                l_timerNext = now + l_timerPeriod;
+            }
+        }
+    }
+    return QSPY_SUCCESS;
+}
+/*..........................................................................*/
+static void loop_ready(uint8_t src) {
+    uint8_t budget = 1U; /* keyboard, timer, accepting new connections */
+    if (src == SRC_TARGET || src == SRC_FILE) {
+        budget = LOOP_BUDGET_TARGET;
+    }
+    else if ((src >= SRC_FE) && (src < SRC_TIMER)) {
+        budget = LOOP_BUDGET_FE;
+    }
+    else if ((src == SRC_BE) && !l_beConn) { /* UDP Front-End packets? */
+        budget = LOOP_BUDGET_FE;
+    }
+    l_ready[l_nReady].src    = src;
+    l_ready[l_nReady].budget = budget;
+    ++l_nReady;
+}
+/*..........................................................................*/
+static void loop_drop(int idx) {
+    --l_nReady;
+    memmove(&l_ready[idx], &l_ready[idx + 1],
+            (size_t)(l_nReady - idx) * sizeof(l_ready[0]));
+    if (idx < l_iReady) {
+        --l_iReady;
+    }
+}
+/*..........................................................................*/
+static void loop_add(int fd, uint8_t src) {
+#ifdef __linux__
+    struct epoll_event evt;
+    if (l_epollFd < 0) {
+        l_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    }
+    memset(&evt, 0, sizeof(evt));
+    evt.events   = EPOLLIN;
+    evt.data.u32 = src;
+    if (epoll_ctl(l_epollFd, EPOLL_CTL_ADD, fd, &evt) != 0) {
+        SNPRINTF_LINE("   <COMMS> ERROR    Event loop add errno=%d", errno);
+        QSPY_printError();
+    }
+#else
+    Q_ASSERT(l_nPoll < SRC_MAX);
+    l_pollFd[l_nPoll].fd      = fd;
+    l_pollFd[l_nPoll].events  = POLLIN;
+    l_pollFd[l_nPoll].revents = 0;
+    l_pollSrc[l_nPoll]        = src;
+    ++l_nPoll;
+#endif
+}
+/*..........................................................................*/
+/* NOTE: must be called before closing the fd */
+static void loop_del(int fd, uint8_t src) {
+    int i;
+#ifdef __linux__
+    epoll_ctl(l_epollFd, EPOLL_CTL_DEL, fd, (struct epoll_event *)0);
+#else
+    for (i = 0; i < l_nPoll; ++i) {
+        if (l_pollFd[i].fd == fd) {
+            --l_nPoll;
+            l_pollFd[i]  = l_pollFd[l_nPoll];
+            l_pollSrc[i] = l_pollSrc[l_nPoll];
+            break;
         }
     }
+#endif
+    /* the source might be still waiting to be served after the last wait */
+    for (i = 0; i < l_nReady; ++i) {
+        if (l_ready[i].src == src) {
+            loop_drop(i);
+            break;
+        }
+    }
+}
+/*..........................................................................*/
+static uint64_t loop_nowMs(void) {
+    return loop_nowUs() / 1000U;
+}
+/*..........................................................................*/
+static uint64_t loop_nowUs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000U) + ((uint64_t)ts.tv_nsec / 1000U);
 }
 
 /*..........................................................................*/
@@ -31,9 +31,11 @@
 * @ingroup qpspy
 */
 #include <stdint.h>
+#include <stdlib.h>
 #include <dlfcn.h>
 #include <unistd.h>
 #include <errno.h>
+#include <sched.h>
 #include <pthread.h>
 #include <rtt_link.h>
 
@@ -50,10 +52,17 @@ static lib_exports_t lib_exports = { .lib_name = JLINK_SHARED_LIB };
  * Open shared library and locate necessary exports
  */
 static void lib_open(void) {
+	static char errMsg[256];
+	char const *env = getenv("JLINK_SHARED_LIB"); /* e.g., the mock */
+
+	if (env != NULL) {
+		lib_exports.lib_name = env;
+	}
 	if (lib_exports.lib == NULL) {
 		lib_exports.lib = dlopen(lib_exports.lib_name, RTLD_NOW);
 		if (lib_exports.lib == NULL) {
-			pthread_exit(JLINK_SHARED_LIB " not found");
+			SNPRINTF_S(errMsg, sizeof(errMsg), "%s not found", lib_exports.lib_name);
+			pthread_exit(errMsg);
 		}
 	}
 }
@@ -324,42 +333,94 @@ static void rtt_stop(void) {
 	rtt_system.qspy_buffer_down = NO_BUFFER;
 	rtt_system.bRTTrunning = 0;
 }
+#define RTT_SPIN_MAX	 16	/* polls without sleeping after the last data */
+#define RTT_SLEEP_MIN	 50	/* [us] the first sleep when idle */
+#define RTT_SLEEP_MAX	 5000	/* [us] the longest sleep when idle */
+/**
+ * Adaptive polling of the target: spin under load, back off when idle
+ *
+ * @param bData	the last poll delivered some data
+ */
+static void rtt_poll_wait(int bData) {
+	static uint32_t idle = 0; /* polls without data */
+	uint32_t us;
+
+	if (bData) {
+		idle = 0;
+		return; /* more data is likely --> poll again right away */
+	}
+	if (idle < RTT_SPIN_MAX) {
+		idle++;
+		sched_yield();
+		return;
+	}
+	us = RTT_SLEEP_MIN << ((idle - RTT_SPIN_MAX) < 7 ? (idle - RTT_SPIN_MAX) : 7);
+	if (us >= RTT_SLEEP_MAX) {
+		us = RTT_SLEEP_MAX; /* no need to hurry now */
+	}
+	else {
+		idle++;
+	}
+	usleep(us);
+}
+/**
+ * Wake up the main thread
+ *
+ * @param ring	ring from the target device to the host
+ */
+static void rtt_wake(rtt_ring_t *const ring) {
+	uint64_t const one = 1U;
+	(void)write(ring->wakeFd[1], &one, sizeof(one));
+}
 /**
  * RTT communication from the target device to the host
  *
- * @param bExit	global flags of unrecoverable problems
- * @param fd	communication link to the main thread
+ * @param ring	ring shared with the main thread
  * @return		skip RTT for this iteration
+ * @note The data go from J-Link straight into the ring (no copy here).
  */
-static int rtt_target2host(int *const bExit, int fd) {
-	char buf[2048];
-	int total, cnt, i;
+static int rtt_target2host(rtt_ring_t *const ring) {
+	static int bFull = 0;
+	uint32_t const head = atomic_load(&ring->head);
+	uint32_t const used = head - atomic_load(&ring->tail);
+	uint32_t const off = head & (ring->size - 1U);
+	uint32_t n;
+	int total;
+
+	if (used == ring->size) {
+		/* The ring is full --> 1ms relax for busy host device */
+		if (bFull == 0) {
+			bFull = 1;
+			atomic_fetch_add(&ring->overruns, 1U);
+		}
+		usleep(1000);
+		return 1;
+	}
+	bFull = 0;
 
-	total = lib_exports.pfnRTT_Read(rtt_system.qspy_buffer_up, buf,
-			sizeof(buf));
+	/* Contiguous free space up to the end of the ring */
+	n = ring->size - used;
+	if (n > ring->size - off) {
+		n = ring->size - off;
+	}
+	total = lib_exports.pfnRTT_Read(rtt_system.qspy_buffer_up,
+			&ring->buf[off], n);
 	if (total < 0) {
 		/* Problem with RTT communication, stop it for now */
 		rtt_stop();
 		return 1;
 	}
+	rtt_poll_wait(total > 0);
 	if (total == 0) {
-		/* No new data --> no need to hurry now */
-		usleep(2000); // 2ms
 		return 0;
 	}
-	/* Transmit additional data for the host */
-	for (i = 0; i < total; i += cnt) {
-		cnt = write(fd, buf + i, total - i);
-		if (cnt == -1) {
-			cnt = 0;
-			if ((errno == EAGAIN) || (errno == EINTR)) {
-				/* 1ms relax for busy host device */
-				usleep(1000);
-				continue;
-			}
-			*bExit = 1; // read-end closed or ERR
-			return 1;
-		}
+	/* Publish additional data for the host */
+	atomic_store(&ring->head, head + (uint32_t)total);
+	if (atomic_load(&ring->tail) == head) {
+		rtt_wake(ring); /* the ring was empty */
+	}
+	if (used + (uint32_t)total > atomic_load(&ring->highWater)) {
+		atomic_store(&ring->highWater, used + (uint32_t)total);
 	}
 	return 0;
 }
@@ -402,12 +463,13 @@ static int rtt_host2target(int *const bExit, int fd) {
 /**
  * End of rtt_link_worker() task
  *
- * @param  arg	data about J-Link + fd for connection to the main thread
- * @note Closed pipes are signals for the main thread.
+ * @param  arg	data about J-Link + the connection to the main thread
+ * @note The done flag with a wake-up is the signal for the main thread.
  */
-static void close_pipes(void * arg) {
-	rtt_link_worker_arg_t const * const args = (rtt_link_worker_arg_t *)arg;
-	close(args->fdT2H[1]); // write-end
+static void close_link(void * arg) {
+	rtt_link_worker_arg_t * const args = (rtt_link_worker_arg_t *)arg;
+	atomic_store(&args->t2h.done, 1);
+	rtt_wake(&args->t2h);
 	close(args->fdH2T[0]); // read-end
 }
 /**
@@ -421,10 +483,10 @@ static void close_pipes(void * arg) {
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wclobbered"
 void* rtt_link_worker(void *arg) {
-	rtt_link_worker_arg_t const * const args = (rtt_link_worker_arg_t *)arg;
+	rtt_link_worker_arg_t * const args = (rtt_link_worker_arg_t *)arg;
 	int bGoToExit = 0;
 
-	pthread_cleanup_push(close_pipes, arg);
+	pthread_cleanup_push(close_link, arg);
 	lib_open();
 	pthread_cleanup_push(lib_close, &(lib_exports.lib));
 	lib_get_exports(lib_exports.lib);
@@ -432,14 +494,14 @@ void* rtt_link_worker(void *arg) {
 	pthread_cleanup_push(jlink_close, NULL);
 	connect_device(args->device);
 
-	while (bGoToExit == 0) {
+	while ((bGoToExit == 0) && (atomic_load(&args->t2h.stop) == 0)) {
 		if (rtt_system.bRTTrunning == 0) {
 			/* RTT has been interrupted, needs to be started again */
 			rtt_system.bRTTrunning = rtt_start();
 		}
 		else {
 			/* Target --> Host (mandatory) */
-			if (rtt_target2host(&bGoToExit, args->fdT2H[1]) == 0) {
+			if (rtt_target2host(&args->t2h) == 0) {
 				/* Host --> Target (optional) */
 				if (rtt_system.qspy_buffer_down != NO_BUFFER) {
 					(void)rtt_host2target(&bGoToExit, args->fdH2T[0]);
@@ -451,7 +513,7 @@ void* rtt_link_worker(void *arg) {
 	rtt_stop();
 	pthread_cleanup_pop(1); // jlink_close()
 	pthread_cleanup_pop(1); // lib_close()
-	pthread_cleanup_pop(1); // close_pipes()
+	pthread_cleanup_pop(1); // close_link()
 	return NULL;
 }
 #pragma GCC diagnostic pop
@@ -537,6 +537,143 @@ uint8_t const *QSpyRecord_getMem(QSpyRecord * const me,
 
     return (uint8_t *)0;
 }
+/*..........................................................................*/
+KeyType QSpyRecord_getObj(QSpyRecord const * const me) {
+    uint32_t skip; /* number of bytes preceding the object in the record */
+
+    switch (me->rec) {
+        case QS_QEP_STATE_ENTRY:
+        case QS_QEP_STATE_EXIT:
+        case QS_QEP_STATE_INIT:
+        case QS_QEP_TRAN_HIST:
+        case QS_QEP_TRAN_EP:
+        case QS_QEP_TRAN_XP:
+        case QS_QF_TIMEEVT_AUTO_DISARM: {
+            skip = 0U; /* [obj]... */
+            break;
+        }
+        case QS_QEP_INIT_TRAN:
+        case QS_QF_ACTIVE_DEFER:
+        case QS_QF_ACTIVE_RECALL:
+        case QS_QF_MPOOL_GET:
+        case QS_QF_MPOOL_GET_ATTEMPT:
+        case QS_QF_MPOOL_PUT:
+        case QS_QF_TIMEEVT_ARM:
+        case QS_QF_TIMEEVT_DISARM:
+        case QS_QF_TIMEEVT_DISARM_ATTEMPT:
+        case QS_QF_TIMEEVT_REARM:
+        case QS_QF_TIMEEVT_POST: {
+            skip = QSPY_conf.tstampSize; /* [t][obj]... */
+            break;
+        }
+        case QS_QF_ACTIVE_RECALL_ATTEMPT: {
+            skip = (QSPY_conf.version >= 620U) /* former QS_QF_EQUEUE_INIT */
+                   ? QSPY_conf.tstampSize
+                   : 0U;
+            break;
+        }
+        case QS_QEP_INTERN_TRAN:
+        case QS_QEP_TRAN:
+        case QS_QEP_IGNORED:
+        case QS_QEP_DISPATCH:
+        case QS_QF_ACTIVE_SUBSCRIBE:
+        case QS_QF_ACTIVE_UNSUBSCRIBE:
+        case QS_QF_ACTIVE_POST_LIFO:
+        case QS_QF_ACTIVE_GET:
+        case QS_QF_ACTIVE_GET_LAST:
+        case QS_QF_EQUEUE_GET:
+        case QS_QF_EQUEUE_GET_LAST:
+        case QS_QF_EQUEUE_POST:
+        case QS_QF_EQUEUE_POST_ATTEMPT:
+        case QS_QF_EQUEUE_POST_LIFO: {
+            skip = QSPY_conf.tstampSize + QSPY_conf.sigSize; /* [t][sig][obj] */
+            break;
+        }
+        case QS_QEP_UNHANDLED: {
+            skip = QSPY_conf.sigSize; /* [sig][obj]... */
+            break;
+        }
+        case QS_QF_ACTIVE_POST:
+        case QS_QF_ACTIVE_POST_ATTEMPT: {
+            skip = QSPY_conf.tstampSize + QSPY_conf.sigSize; /* receiver */
+            if (QSPY_conf.version >= 420U) { /* sender included? */
+                skip += QSPY_conf.objPtrSize;
+            }
+            break;
+        }
+        case QS_QF_PUBLISH: {
+            if (QSPY_conf.version < 420U) { /* no sender? */
+                return (KeyType)0;
+            }
+            skip = QSPY_conf.tstampSize; /* [t][sender]... */
+            break;
+        }
+        default: {
+            return (KeyType)0; /* the record is not about a single object */
+        }
+    }
+
+    /* NOTE: the record is not consumed, so it can be parsed afterwards */
+    if (me->len < (int32_t)(skip + QSPY_conf.objPtrSize)) {
+        return (KeyType)0; /* record too short; reported by the parser */
+    }
+    KeyType obj = 0U;
+    uint8_t const *pos = me->pos + skip + QSPY_conf.objPtrSize;
+    while (pos > me->pos + skip) { /* little-endian */
+        --pos;
+        obj = (obj << 8) | (KeyType)*pos;
+    }
+    return obj;
+}
+
+/*..........................................................................*/
+bool QSpyRecord_getTstamp(QSpyRecord const * const me, uint32_t *pTstamp) {
+    if (me->rec < l_userRec) { /* pre-defined record? */
+        switch (me->rec) {
+            case QS_EMPTY:
+            case QS_QEP_STATE_ENTRY:
+            case QS_QEP_STATE_EXIT:
+            case QS_QEP_STATE_INIT:
+            case QS_QEP_UNHANDLED:
+            case QS_QF_TICK:
+            case QS_QF_TIMEEVT_AUTO_DISARM:
+            case QS_QF_INT_DISABLE:
+            case QS_QF_INT_ENABLE:
+            case QS_QEP_TRAN_HIST:
+            case QS_QEP_TRAN_EP:
+            case QS_QEP_TRAN_XP: {
+                return false; /* [obj]... or [sig][obj]... */
+            }
+            case QS_TEST_PROBE_GET:
+            case QS_TARGET_DONE:
+            case QS_RX_STATUS:
+            case QS_QUERY_DATA:
+            case QS_PEEK_DATA:
+            case QS_ASSERT_FAIL: {
+                break; /* [t]... */
+            }
+            default: {
+                if (me->rec >= QS_TEST_PAUSED) { /* dictionaries, etc.? */
+                    return false;
+                }
+                break;
+            }
+        }
+    }
+
+    /* NOTE: the record is not consumed, so it can be parsed afterwards */
+    if (me->len < (int32_t)QSPY_conf.tstampSize) {
+        return false; /* record too short; reported by the parser */
+    }
+    uint32_t t = 0U;
+    uint8_t const *pos = me->pos + QSPY_conf.tstampSize;
+    while (pos > me->pos) { /* little-endian */
+        --pos;
+        t = (t << 8) | (uint32_t)*pos;
+    }
+    *pTstamp = t;
+    return true;
+}
 
 /*==========================================================================*/
 /* application-specific (user) QS records... */
@@ -739,8 +876,8 @@ static void QSpyRecord_processUser(QSpyRecord * const me) {
 /*==========================================================================*/
 /* pre-defined QS records... */
 static void QSpyRecord_process(QSpyRecord * const me) {
-    uint32_t t, a, b, c, d, e;
-    uint64_t p, q, r;
+    uint32_t t = 0U, a = 0U, b = 0U, c = 0U, d = 0U, e = 0U;
+    uint64_t p = 0U, q = 0U, r = 0U;
     char buf[QS_FNAME_LEN_MAX];
     char const *s = 0;
     char const *w = 0;
@@ -2106,8 +2243,80 @@ static void QSpyRecord_process(QSpyRecord * const me) {
             SNPRINTF_LINE("           Unknown Rec=%d,Len=%d",
                    (int)me->rec, (int)me->len);
             QSPY_onPrintLn();
-            break;
+            return; /* not decoded */
+        }
+    }
+
+    /* the dictionaries and the session records are not decoded */
+    if ((me->len == 0)
+        && (me->rec != QS_EMPTY) && (me->rec != QS_TARGET_INFO)
+        && ((me->rec < QS_SIG_DICT) || (me->rec > QS_USR_DICT)))
+    {
+        QSpyDecoded dec;
+        memset(&dec, 0, sizeof(dec));
+        dec.rec    = me->rec;
+        dec.tstamp = t;
+        dec.num[0] = a;
+        dec.num[1] = b;
+        dec.num[2] = c;
+        dec.num[3] = d;
+        dec.num[4] = e;
+        dec.key[0] = p;
+        dec.key[1] = q;
+        dec.key[2] = r;
+
+        /* the signal argument and its scope (as in SigDictionary_get()) */
+        switch (me->rec) {
+            case QS_QF_NEW_ATTEMPT:
+            case QS_QF_NEW:
+                dec.sigIdx = 3U; /* c */
+                break;
+            case QS_QF_DELETE_REF: /* former QS_QF_TIMEEVT_CTR */
+                if (QSPY_conf.version >= 620U) {
+                    dec.sigIdx = 1U; /* a, global signal */
+                }
+                break;
+            case QS_QF_ACTIVE_DEFER:  /* former QS_QF_ACTIVE_ADD */
+            case QS_QF_ACTIVE_RECALL: /* former QS_QF_ACTIVE_REMOVE */
+                if (QSPY_conf.version >= 620U) {
+                    dec.sigIdx    = 1U; /* a */
+                    dec.sigObjIdx = 1U; /* p */
+                }
+                break;
+            case QS_QF_PUBLISH:
+            case QS_QF_NEW_REF:
+            case QS_QF_GC_ATTEMPT:
+            case QS_QF_GC:
+                dec.sigIdx = 1U; /* a, global signal */
+                break;
+            case QS_QF_TIMEEVT_POST:
+                dec.sigIdx    = 1U; /* a */
+                dec.sigObjIdx = 2U; /* q */
+                break;
+            case QS_QEP_INTERN_TRAN:
+            case QS_QEP_TRAN:
+            case QS_QEP_IGNORED:
+            case QS_QEP_DISPATCH:
+            case QS_QEP_UNHANDLED:
+            case QS_QF_ACTIVE_SUBSCRIBE:
+            case QS_QF_ACTIVE_UNSUBSCRIBE:
+            case QS_QF_ACTIVE_POST:
+            case QS_QF_ACTIVE_POST_ATTEMPT:
+            case QS_QF_ACTIVE_POST_LIFO:
+            case QS_QF_ACTIVE_GET:
+            case QS_QF_EQUEUE_GET:
+            case QS_QF_ACTIVE_GET_LAST:
+            case QS_QF_EQUEUE_GET_LAST:
+            case QS_QF_EQUEUE_POST:
+            case QS_QF_EQUEUE_POST_ATTEMPT:
+            case QS_QF_EQUEUE_POST_LIFO:
+                dec.sigIdx    = 1U; /* a */
+                dec.sigObjIdx = 1U; /* p */
+                break;
+            default:
+                break;
         }
+        QSPY_onDecoded(&dec);
     }
 }
 /*..........................................................................*/
@@ -2120,6 +2329,11 @@ void QSPY_printError(void) {
     QSPY_output.type = ERR_OUT; /* this is an error message */
     QSPY_onPrintLn();
 }
+/*..........................................................................*/
+void QSPY_printStat(void) {
+    QSPY_output.type = STAT_OUT; /* this is a statistics report */
+    QSPY_onPrintLn();
+}
 
 /*==========================================================================*/
 static uint8_t l_record[QS_RECORD_SIZE_MAX];
@@ -2225,6 +2439,7 @@ void QSPY_parse(uint8_t const *buf, uint32_t nBytes) {
                 l_seq = l_record[0];
 
                 QSpyRecord_init(&qrec, l_record, (int32_t)(l_pos - l_record));
+                QSPY_onRecord(&qrec); /* does not consume the record */
 
                 if (l_custParseFun != (QSPY_CustParseFun)0) {
                     parse = (*l_custParseFun)(&qrec);
@@ -43,18 +43,128 @@
 #include "qpc_qs.h"     /* QS target-resident interface */
 #include "qpc_qs_pkg.h" /* QS package-scope interface */
 
-/*..........................................................................*/
-static uint8_t  l_rxBeSeq;     /* receive  Back-End  sequence number */
-static uint8_t  l_txBeSeq;     /* transmit Back-End sequence number */
-static uint8_t  l_channels;    /* channels of the output (bitmask) */
-
 enum Channels {
-    BINARY_CH = (1 << 0),
-    TEXT_CH   = (1 << 1)
+    BINARY_CH     = (1 << 0),
+    TEXT_CH       = (1 << 1),
+    TEXT_BATCH_CH = (1 << 2), /* batch the text lines (with TEXT_CH) */
+    SHM_CH        = (1 << 3), /* shared-memory ring (Unix-domain BE only) */
+    RELIABLE_CH   = (1 << 4), /* retransmit the packets lost on the way */
+    DECODED_CH    = (1 << 5)  /* pre-decoded records (QSpyDecoded) */
+};
+
+/* batched text lines for the Front-End (TEXT_BATCH_CH)
+* packet layout: [seq][QSPY_TEXT_BATCH] { [rec][len-lo][len-hi][text] }...
+*/
+enum {
+    BE_BATCH_SIZE_MAX = 1472, /* Ethernet MTU - IP header - UDP header */
+    BE_BATCH_HDR_SIZE = 2,    /* [seq][QSPY_TEXT_BATCH] */
+    BE_LINE_HDR_SIZE  = 3     /* [rec][len-lo][len-hi] */
+};
+
+/* pre-decoded records for the Front-End (DECODED_CH)
+* packet layout: [seq][QSPY_DECODED] { QSpyDecoded }...
+*
+* The names in the records are IDs of the strings interned by the Back-End.
+* Every string is pushed to the Front-End only once, before the first
+* batch of records that refers to it:
+* packet layout: [seq][QSPY_STR_TABLE] { [id(4)][name]\0 }...
+*/
+enum {
+    BE_DEC_HDR_SIZE = 2,    /* [seq][QSPY_DECODED] */
+    BE_STR_ID_SIZE  = 4,    /* [id(4)] host-endian, as QSpyDecoded */
+    BE_STR_MAX      = 2048, /* max number of interned strings */
+    BE_STR_HASH     = 4096  /* size of the string hash table (power of 2) */
 };
 
+static char     l_str[BE_STR_MAX][QS_DNAME_LEN_MAX]; /* [id - 1] */
+static uint16_t l_strHash[BE_STR_HASH]; /* string IDs, 0 means empty slot */
+static uint32_t l_nStr;                 /* number of interned strings */
+
+/* subscription of a Front-End to QS records and objects (QSPY_SUBSCRIBE)
+* packet layout: [seq][QSPY_SUBSCRIBE][rec-bitmap] { [obj-name]\0 }...
+*/
+enum {
+    BE_SUB_RECS_SIZE = 16,  /* bitmap of the 128 QS record-IDs [bytes] */
+    BE_SUB_OBJ_MAX   = 16   /* max number of objects in the whitelist */
+};
+
+/* reliable mode (RELIABLE_CH)
+* the packets for the Front-End are queued and at most BE_RTX_WIN of them
+* are in flight (sent, but not acknowledged yet). The Front-End acknowledges
+* them cumulatively with [seq][QSPY_ACK][rx-seq] and requests the
+* retransmission of everything after its last in-order packet with
+* [seq][QSPY_NACK][rx-seq]. When the queue overflows, the packets are
+* dropped and the Front-End learns about it from [seq][QSPY_NACK].
+*
+* queue layout: { [len-lo][len-hi][packet] }... len=0xFFFF wraps to 0
+*/
+enum {
+    BE_RTX_WIN  = 128,         /* packets in flight, half of the seq space */
+    BE_RTX_SIZE = (512 * 1024) /* the queue of a Front-End [bytes] */
+};
+
+typedef struct {
+    uint32_t sent;     /* packets sent (excluding the retransmissions) */
+    uint32_t acks;     /* acknowledgements received */
+    uint32_t nacks;    /* retransmit requests received */
+    uint32_t rtx;      /* packets retransmitted */
+    uint32_t lost;     /* packets dropped because the queue was full */
+    uint32_t maxWin;   /* high-water mark of the packets in flight */
+    uint32_t maxQueue; /* high-water mark of the queue [bytes] */
+} RtxStats;
+
+/* Back-End state of an attached Front-End
+* NOTE: the index in l_fe[] is the same as the FE index in the PAL
+*/
+typedef struct {
+    uint8_t  rxSeq;       /* receive  Back-End  sequence number */
+    uint8_t  txSeq;       /* transmit Back-End sequence number */
+    uint8_t  channels;    /* channels of the output (bitmask) */
+    uint8_t  recs[BE_SUB_RECS_SIZE]; /* subscribed QS records (bitmap) */
+    bool     objFilter;   /* is the object whitelist in effect? */
+    uint8_t  nObjs;       /* number of objects in the whitelist */
+    KeyType  objs[BE_SUB_OBJ_MAX]; /* subscribed objects (whitelist) */
+    uint32_t batchLen;    /* 0 means empty batch */
+    uint8_t  batch[BE_BATCH_SIZE_MAX];
+    uint32_t decLen;      /* 0 means empty batch of pre-decoded records */
+    uint32_t nStrSent;    /* interned strings pushed to the Front-End */
+    uint8_t  dec[BE_BATCH_SIZE_MAX];
+    uint8_t  ackSeq;      /* last packet acknowledged (reliable mode) */
+    bool     rtxLost;     /* packets dropped since the last queued one? */
+    uint32_t rtxHead;     /* oldest unacknowledged packet in rtxBuf */
+    uint32_t rtxNext;     /* next packet to send in rtxBuf */
+    uint32_t rtxTail;     /* end of the last queued packet in rtxBuf */
+    uint32_t rtxUsed;     /* bytes used in rtxBuf */
+    uint32_t rtxPending;  /* packets queued, but not sent yet */
+    RtxStats stats;       /* statistics of the reliable mode */
+    uint8_t  rtxBuf[BE_RTX_SIZE]; /* queue of the packets (reliable mode) */
+} FrontEnd;
+
+static FrontEnd l_fe[PAL_FE_MAX];
+
+/*..........................................................................*/
 /* send a packet to Front-End */
-static void BE_sendShortPkt(int pktId);
+static void BE_sendShortPkt(int fe, int pktId);
+static void BE_sendPkt(int fe, uint8_t *pkt, uint32_t nBytes);
+static void BE_forwardRec(int fe, QSpyRecord const * const qrec);
+static void BE_ack(int fe, QSpyRecord const * const qrec);
+static void BE_rtxReset(int fe);
+static bool BE_rtxPut(int fe, uint8_t const *pkt, uint32_t nBytes);
+static void BE_rtxSend(int fe);
+static uint32_t BE_rtxWrap(FrontEnd const * const me, uint32_t pos);
+static void BE_printStats(int fe);
+static void BE_flushFE(int fe);
+static void BE_subscribe(int fe, QSpyRecord const * const qrec);
+static void BE_subscribeAll(int fe);
+static bool BE_isSubscribed(int fe, uint8_t rec, KeyType obj);
+static void BE_resolve(QSpyDecoded * const dec);
+static uint32_t BE_intern(char const *name);
+static void BE_pushStrings(int fe);
+
+/* the object of the QS record from the Target being processed */
+static uint8_t l_objRec;
+static KeyType l_obj;
+static int     l_statFE = -1; /* Front-End that requested the statistics */
 
 #define BIN_FORMAT "%c%c%c%c%c%c%c%c"
 #define BYTE_TO_BIN(byte_)  \
@@ -73,9 +183,15 @@ static FILE *l_testFile;
 #endif
 
 void BE_onStartup(void) {
-    l_rxBeSeq  = 0U;
-    l_txBeSeq  = 0U;
-    l_channels = 0U;
+    int fe;
+    for (fe = 0; fe < PAL_FE_MAX; ++fe) {
+        l_fe[fe].rxSeq    = 0U;
+        l_fe[fe].txSeq    = 0U;
+        l_fe[fe].channels = 0U;
+        l_fe[fe].batchLen = 0U;
+        l_fe[fe].decLen   = 0U;
+        BE_subscribeAll(fe);
+    }
 
 #ifndef NDEBUG
     FOPEN_S(l_testFile, "fromFE.bin", "wb");
@@ -83,32 +199,46 @@ void BE_onStartup(void) {
 }
 /*..........................................................................*/
 void BE_onCleanup(void) {
-    BE_sendShortPkt(QSPY_DETACH);
+    int fe;
+    for (fe = 0; fe < PAL_FE_MAX; ++fe) {
+        if (l_fe[fe].channels != 0U) { /* attached? */
+            BE_sendShortPkt(fe, QSPY_DETACH);
+            BE_printStats(fe);
+        }
+    }
 #ifndef NDEBUG
     fclose(l_testFile);
 #endif
 }
 
+/*..........................................................................*/
+void BE_onDetach(int fe) {
+    l_fe[fe].channels = 0U; /* detached from a Front-End */
+    l_fe[fe].batchLen = 0U;
+    l_fe[fe].decLen   = 0U;
+    BE_rtxReset(fe);
+}
+
 /*..........................................................................*/
 void BE_parse(unsigned char *buf, uint32_t nBytes) {
     /* By nature of UDP, each transmission from the Front-End contains
     * one complete UDP packet, which contains one complete QS record.
     * This is a greatly simplifying assumption in this routine.
     *
-    * NOTE: if the communication mechanism would change from UDP to
-    * to something else (e.g. TCP), the following code would need to
-    * change, as the packet-boundaries might not be preserved.
+    * NOTE: the stream-oriented TCP Back-End restores the packet boundaries
+    * in the PAL (see PAL_openBETcp()), so this code applies to it as well.
     */
+    FrontEnd * const me = &l_fe[PAL_currFE()]; /* FE that sent the packet */
 
     /* check the continuity of the data from the Front-End... */
-    if (l_channels != 0U) { /* is a Front-End attached? */
-        ++l_rxBeSeq;
-        if (buf[0] != l_rxBeSeq) {
+    if (me->channels != 0U) { /* is the Front-End attached? */
+        ++me->rxSeq;
+        if (buf[0] != me->rxSeq) {
             SNPRINTF_LINE("   <F-END> ERROR    Data Discontinuity "
-                          "Seq=%u->%u",
-                          (unsigned)l_rxBeSeq, (unsigned)buf[0]);
+                          "FE=%d Seq=%u->%u", PAL_currFE(),
+                          (unsigned)me->rxSeq, (unsigned)buf[0]);
             QSPY_printError();
-            l_rxBeSeq = buf[0];
+            me->rxSeq = buf[0];
         }
     }
 
@@ -146,32 +276,48 @@ void BE_parse(unsigned char *buf, uint32_t nBytes) {
 
 /*..........................................................................*/
 void BE_parseRecFromFE(QSpyRecord * const qrec) {
+    int const fe = PAL_currFE(); /* the Front-End that sent the record */
+    FrontEnd * const me = &l_fe[fe];
+
     switch (qrec->rec) {
         case QSPY_ATTACH: {   /* attach to the Front-End */
-            if (l_channels == 0U) { /* no Front-End attached yet? */
-                SNPRINTF_LINE("   <F-END> Attached Chan="BIN_FORMAT,
-                              BYTE_TO_BIN(qrec->start[2]));
+            if (me->channels == 0U) { /* this Front-End not attached yet? */
+                SNPRINTF_LINE("   <F-END> Attached FE=%d Chan="BIN_FORMAT,
+                              fe, BYTE_TO_BIN(qrec->start[2]));
                 QSPY_printInfo();
             }
 
             if (qrec->tot_len > 2U) { /* payload contains channels? */
-                l_channels = qrec->start[2];
+                me->channels = qrec->start[2];
             }
             else { /* old payload without channels */
-                l_channels = BINARY_CH; /* default to binary channel  */
+                me->channels = BINARY_CH; /* default to binary channel  */
+            }
+            me->rxSeq    = qrec->start[0]; /* re-start the receive  sequence */
+            me->txSeq    = 0U;             /* re-start the transmit sequence */
+            me->batchLen = 0U;             /* discard any stale text lines */
+            me->decLen   = 0U;             /* ...and the decoded records */
+            me->nStrSent = 0U;             /* push all interned strings */
+            BE_rtxReset(fe);               /* empty retransmit queue */
+            BE_subscribeAll(fe);           /* all records and objects */
+
+            /* the ring (if any) is passed with the attach confirmation */
+            if (PAL_configShmFE(fe, (me->channels & SHM_CH) != 0U)
+                != QSPY_SUCCESS)
+            {
+                me->channels &= (uint8_t)~SHM_CH; /* use the socket */
             }
-            l_rxBeSeq  = qrec->start[0]; /* re-start the receive  sequence */
-            l_txBeSeq  = 0U;             /* re-start the transmit sequence */
 
             /* send the attach confirmation packet back to the Front-End */
-            BE_sendShortPkt(QSPY_ATTACH);
+            BE_sendShortPkt(fe, QSPY_ATTACH);
 
             break;
         }
         case QSPY_DETACH: {   /* detach from the Front-End */
-            PAL_detachFE();
-            l_channels = 0U; /* detached from a Front-End */
-            SNPRINTF_LINE("   <F-END> Detached %s",
+            BE_printStats(fe);
+            PAL_detachFE(fe);
+            BE_onDetach(fe);
+            SNPRINTF_LINE("   <F-END> Detached FE=%d %s", fe,
                           "######################################");
             QSPY_printInfo();
             break;
@@ -214,6 +360,25 @@ void BE_parseRecFromFE(QSpyRecord * const qrec) {
             QSPY_sendTP(qrec);
             break;
         }
+        case QSPY_SUBSCRIBE: {
+            BE_subscribe(fe, qrec);
+            break;
+        }
+        case QSPY_ACK:
+        case QSPY_NACK: {
+            BE_ack(fe, qrec);
+            break;
+        }
+        case QSPY_STATS: {
+            l_statFE = fe; /* the report goes only to this Front-End */
+            QSPY_command('a');
+            l_statFE = -1;
+            break;
+        }
+        case QSPY_TRIGGER: { /* trigger the flight-recorder dump */
+            QSPY_command('f');
+            break;
+        }
 
         default: {
             SNPRINTF_LINE("   <F-END> ERROR    Unrecognized command Rec=%d",
@@ -225,63 +390,543 @@ void BE_parseRecFromFE(QSpyRecord * const qrec) {
 }
 /*..........................................................................*/
 int BE_parseRecFromTarget(QSpyRecord * const qrec) {
-    if ((l_channels & BINARY_CH) != 0) {
-        if (qrec->rec != QS_EMPTY) {
-            /* forward the Target binary record to the Front-End... */
-            PAL_send2FE(qrec->start, qrec->tot_len - 1U);
+    /* remember the object for filtering of the text lines of this record */
+    l_objRec = qrec->rec;
+    l_obj    = QSpyRecord_getObj(qrec);
+
+    int fe;
+    for (fe = 0; fe < PAL_FE_MAX; ++fe) { /* fan-out to all Front-Ends */
+        uint8_t const channels = l_fe[fe].channels;
+        if ((channels & BINARY_CH) != 0) {
+            if ((qrec->rec != QS_EMPTY)
+                && BE_isSubscribed(fe, qrec->rec, l_obj))
+            {
+                /* forward the Target binary record to the Front-End... */
+                BE_forwardRec(fe, qrec);
+            }
         }
-    }
-    else if (l_channels != 0U) {
-        if (qrec->rec == QS_TARGET_INFO) {
-            /* forward the Target Info record to the Front-End... */
-            PAL_send2FE(qrec->start, qrec->tot_len - 1U);
+        else if (channels != 0U) {
+            if (qrec->rec == QS_TARGET_INFO) {
+                /* forward the Target Info record to the Front-End... */
+                BE_forwardRec(fe, qrec);
+            }
         }
     }
     return 1; /* continue with the standard QSPY processing */
 }
 
 /*--------------------------------------------------------------------------*/
-void BE_sendShortPkt(int pktId) {
-    if ((pktId >= 128) || ((l_channels & BINARY_CH) != 0)) {
+static void BE_sendShortPkt(int fe, int pktId) {
+    FrontEnd * const me = &l_fe[fe];
+    if ((pktId >= 128) || ((me->channels & BINARY_CH) != 0)) {
+        BE_flushFE(fe); /* preserve the order of the batched text lines */
+
         uint8_t buf[4];
-        uint8_t *pos = &buf[0];
-        ++l_txBeSeq;
-        *pos++ = l_txBeSeq;
-        *pos++ = (uint8_t)pktId;
-        PAL_send2FE(buf, (pos - &buf[0]));
+        buf[1] = (uint8_t)pktId;
+        BE_sendPkt(fe, buf, 2U); /* [seq][pktId] */
+    }
+}
+/*..........................................................................*/
+/* send the next packet in the Back-End sequence, pkt[0] gets the seq. */
+static void BE_sendPkt(int fe, uint8_t *pkt, uint32_t nBytes) {
+    FrontEnd * const me = &l_fe[fe];
+    if ((me->channels & RELIABLE_CH) != 0U) {
+        /* report the packets dropped before this one in-band */
+        if (me->rtxLost) {
+            static uint8_t const lost[2] = { 0U, (uint8_t)QSPY_NACK };
+            me->rtxLost = !BE_rtxPut(fe, lost, sizeof(lost));
+        }
+        if (me->rtxLost || !BE_rtxPut(fe, pkt, nBytes)) {
+            me->rtxLost = true;
+            ++me->stats.lost;
+        }
+        BE_rtxSend(fe); /* as much as the window allows */
+    }
+    else {
+        ++me->txSeq;
+        pkt[0] = me->txSeq;
+        PAL_send2FE(fe, pkt, nBytes);
+    }
+}
+/*..........................................................................*/
+static void BE_forwardRec(int fe, QSpyRecord const * const qrec) {
+    uint32_t const nBytes = qrec->tot_len - 1U; /* without the checksum */
+    if ((l_fe[fe].channels & RELIABLE_CH) != 0U) {
+        /* the Back-End sequence replaces the Target sequence */
+        static uint8_t pkt[QS_RECORD_SIZE_MAX];
+        Q_ASSERT(nBytes <= sizeof(pkt));
+        memcpy(pkt, qrec->start, nBytes);
+        BE_sendPkt(fe, pkt, nBytes);
+    }
+    else { /* the Target record goes out as-is */
+        PAL_send2FE(fe, qrec->start, nBytes);
+    }
+}
+/*..........................................................................*/
+static void BE_ack(int fe, QSpyRecord const * const qrec) {
+    FrontEnd * const me = &l_fe[fe];
+    if (((me->channels & RELIABLE_CH) == 0U) || (qrec->tot_len < 3U)) {
+        return; /* not in reliable mode or the rx-seq missing */
+    }
+
+    /* remove the packets up to rxSeq (received by the FE) from the queue */
+    uint8_t const rxSeq = qrec->start[2]; /* last in-order packet at FE */
+    uint8_t const inFlight = (uint8_t)(me->txSeq - me->ackSeq);
+    bool const inWindow = ((uint8_t)(me->txSeq - rxSeq) <= inFlight);
+    if (inWindow) {
+        for (; me->ackSeq != rxSeq; ++me->ackSeq) {
+            uint32_t const pos = BE_rtxWrap(me, me->rtxHead);
+            uint32_t const len = (uint32_t)me->rtxBuf[pos]
+                                 | ((uint32_t)me->rtxBuf[pos + 1U] << 8);
+            if (pos != me->rtxHead) { /* skipped the unused end? */
+                me->rtxUsed -= (uint32_t)sizeof(me->rtxBuf) - me->rtxHead;
+            }
+            me->rtxUsed -= 2U + len;
+            me->rtxHead = pos + 2U + len;
+        }
+    }
+
+    if (qrec->rec == QSPY_ACK) {
+        ++me->stats.acks;
+    }
+    else {
+        ++me->stats.nacks;
+
+        if (!inWindow) { /* stale rx-seq, e.g., from before the re-attach */
+            /* the FE continues after the last acknowledged packet */
+            uint8_t buf[2];
+            buf[0] = me->ackSeq;
+            buf[1] = (uint8_t)QSPY_NACK;
+            PAL_send2FE(fe, buf, sizeof(buf));
+            if ((me->channels & RELIABLE_CH) == 0U) {
+                return; /* detached on the send error */
+            }
+        }
+
+        /* go back N: retransmit all the packets in flight */
+        uint32_t pos = me->rtxHead;
+        uint8_t seq;
+        for (seq = me->ackSeq; seq != me->txSeq; ++seq) {
+            pos = BE_rtxWrap(me, pos);
+            uint32_t const len = (uint32_t)me->rtxBuf[pos]
+                                 | ((uint32_t)me->rtxBuf[pos + 1U] << 8);
+            PAL_send2FE(fe, &me->rtxBuf[pos + 2U], len);
+            if ((me->channels & RELIABLE_CH) == 0U) {
+                return; /* detached on the send error (rtxBuf reset) */
+            }
+            pos += 2U + len;
+            ++me->stats.rtx;
+        }
+    }
+    BE_rtxSend(fe); /* the window might have opened */
+}
+/*..........................................................................*/
+static void BE_rtxReset(int fe) {
+    FrontEnd * const me = &l_fe[fe];
+    me->ackSeq     = me->txSeq; /* nothing in flight */
+    me->rtxLost    = false;
+    me->rtxHead    = 0U;
+    me->rtxNext    = 0U;
+    me->rtxTail    = 0U;
+    me->rtxUsed    = 0U;
+    me->rtxPending = 0U;
+    memset(&me->stats, 0, sizeof(me->stats));
+}
+/*..........................................................................*/
+static bool BE_rtxPut(int fe, uint8_t const *pkt, uint32_t nBytes) {
+    FrontEnd * const me = &l_fe[fe];
+    uint32_t const need = 2U + nBytes;
+    uint32_t waste = 0U; /* unused end of rtxBuf when the packet wraps */
+    if (sizeof(me->rtxBuf) - me->rtxTail < need) {
+        waste = sizeof(me->rtxBuf) - me->rtxTail;
+    }
+    if (me->rtxUsed + waste + need > sizeof(me->rtxBuf)) {
+        return false; /* queue full */
+    }
+
+    if (waste != 0U) {
+        if (waste >= 2U) { /* room for the wrap marker? */
+            me->rtxBuf[me->rtxTail]      = 0xFFU;
+            me->rtxBuf[me->rtxTail + 1U] = 0xFFU;
+        }
+        me->rtxUsed += waste;
+        me->rtxTail  = 0U;
+    }
+    uint8_t *pos = &me->rtxBuf[me->rtxTail];
+    *pos++ = (uint8_t)nBytes;
+    *pos++ = (uint8_t)(nBytes >> 8);
+    memcpy(pos, pkt, nBytes);
+    me->rtxTail += need;
+    me->rtxUsed += need;
+    ++me->rtxPending;
+
+    if (me->stats.maxQueue < me->rtxUsed) {
+        me->stats.maxQueue = me->rtxUsed;
+    }
+    return true;
+}
+/*..........................................................................*/
+static void BE_rtxSend(int fe) {
+    FrontEnd * const me = &l_fe[fe];
+    while ((me->rtxPending > 0U)
+           && ((uint8_t)(me->txSeq - me->ackSeq) < BE_RTX_WIN))
+    {
+        uint32_t const pos = BE_rtxWrap(me, me->rtxNext);
+        uint32_t const len = (uint32_t)me->rtxBuf[pos]
+                             | ((uint32_t)me->rtxBuf[pos + 1U] << 8);
+        uint8_t * const pkt = &me->rtxBuf[pos + 2U];
+        ++me->txSeq;
+        pkt[0] = me->txSeq; /* the seq is known only now */
+        PAL_send2FE(fe, pkt, len);
+        if ((me->channels & RELIABLE_CH) == 0U) {
+            return; /* detached on the send error (rtxBuf reset) */
+        }
+        me->rtxNext = pos + 2U + len;
+        --me->rtxPending;
+        ++me->stats.sent;
+
+        uint32_t const inFlight = (uint8_t)(me->txSeq - me->ackSeq);
+        if (me->stats.maxWin < inFlight) {
+            me->stats.maxWin = inFlight;
+        }
+    }
+}
+/*..........................................................................*/
+/* position of the packet in rtxBuf, skipping the unused end of rtxBuf */
+static uint32_t BE_rtxWrap(FrontEnd const * const me, uint32_t pos) {
+    if ((pos > sizeof(me->rtxBuf)) || (sizeof(me->rtxBuf) - pos < 2U)
+        || ((me->rtxBuf[pos] == 0xFFU) && (me->rtxBuf[pos + 1U] == 0xFFU)))
+    {
+        return 0U;
+    }
+    return pos;
+}
+/*..........................................................................*/
+static void BE_printStats(int fe) {
+    FrontEnd const * const me = &l_fe[fe];
+    if ((me->channels & RELIABLE_CH) != 0U) {
+        SNPRINTF_LINE("   <F-END> Reliable FE=%d Sent=%u,Ack=%u,Nack=%u,"
+                      "Rtx=%u,Lost=%u,Win=%u/%d,Queue=%u/%d", fe,
+                      (unsigned)me->stats.sent,  (unsigned)me->stats.acks,
+                      (unsigned)me->stats.nacks, (unsigned)me->stats.rtx,
+                      (unsigned)me->stats.lost,  (unsigned)me->stats.maxWin,
+                      (int)BE_RTX_WIN,
+                      (unsigned)me->stats.maxQueue, (int)BE_RTX_SIZE);
+        QSPY_printInfo();
     }
 }
 /*..........................................................................*/
 void BE_sendLine(void) {
-    if ((l_channels & TEXT_CH) != 0) {
-        /* filter for permanently enabled QS records
-         * that should NOT be forwarded to BE:
-         * QS_EMPTY,
-         * QS_SIG_DICT,
-         * QS_OBJ_DICT,
-         * QS_FUN_DICT,
-         * QS_USR_DICT,
-         * QS_TARGET_INFO
-         */
-        static uint8_t const dont_forward[32] = {
-            0x01U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0xF0U,
-            0x01U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U,
-            0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U,
-            0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U
-        };
-        uint8_t rec = (uint8_t)QSPY_output.rec;
-
-        /* should this QS record be forwarded? */
-        if ((dont_forward[rec >> 3] & (1U << (rec & 7U))) == 0U) {
-            ++l_txBeSeq;
+    /* filter for permanently enabled QS records
+     * that should NOT be forwarded to BE:
+     * QS_EMPTY,
+     * QS_SIG_DICT,
+     * QS_OBJ_DICT,
+     * QS_FUN_DICT,
+     * QS_USR_DICT,
+     * QS_TARGET_INFO
+     */
+    static uint8_t const dont_forward[32] = {
+        0x01U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0xF0U,
+        0x01U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U,
+        0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U,
+        0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U
+    };
+    uint8_t rec = (uint8_t)QSPY_output.rec;
+    bool const isStat = (QSPY_output.type == STAT_OUT);
+
+    /* should this QS record be forwarded? */
+    if (!isStat && ((dont_forward[rec >> 3] & (1U << (rec & 7U))) != 0U)) {
+        return;
+    }
+
+    /* QSPY info and error lines are not subject to the subscriptions */
+    bool const isRegOut = (QSPY_output.type == REG_OUT);
+    KeyType const obj = (rec == l_objRec) ? l_obj : (KeyType)0;
+
+    int fe;
+    for (fe = 0; fe < PAL_FE_MAX; ++fe) { /* fan-out to all Front-Ends */
+        FrontEnd * const me = &l_fe[fe];
+        if ((me->channels & TEXT_CH) == 0) {
+            continue;
+        }
+        if (isStat && (fe != l_statFE)) { /* not requested by this FE? */
+            continue;
+        }
+        if (isRegOut && !BE_isSubscribed(fe, rec, obj)) {
+            continue;
+        }
+        if ((me->channels & TEXT_BATCH_CH) != 0) {
+            uint32_t len = (uint32_t)QSPY_output.len;
+            Q_ASSERT(BE_BATCH_HDR_SIZE + BE_LINE_HDR_SIZE + len
+                     <= sizeof(me->batch));
 
+            /* no room for this line in the current batch? */
+            if (me->batchLen + BE_LINE_HDR_SIZE + len > sizeof(me->batch)) {
+                BE_flushFE(fe);
+            }
+            if (me->batchLen == 0U) { /* empty batch? */
+                me->batchLen = BE_BATCH_HDR_SIZE;
+            }
+            uint8_t *pos = &me->batch[me->batchLen];
+            *pos++ = rec;
+            *pos++ = (uint8_t)len;
+            *pos++ = (uint8_t)(len >> 8);
+            memcpy(pos, &QSPY_output.buf[QS_LINE_OFFSET], len);
+            me->batchLen += BE_LINE_HDR_SIZE + len;
+        }
+        else {
             /* prepend the BE UDP packet header in front of the string */
-            QSPY_output.buf[QS_LINE_OFFSET - 3] = l_txBeSeq;
             QSPY_output.buf[QS_LINE_OFFSET - 2] = QS_EMPTY;
             QSPY_output.buf[QS_LINE_OFFSET - 1] = rec;
 
-            PAL_send2FE((uint8_t const *)&QSPY_output.buf[QS_LINE_OFFSET - 3],
-                        QSPY_output.len + 3);
+            BE_sendPkt(fe, (uint8_t *)&QSPY_output.buf[QS_LINE_OFFSET - 3],
+                       QSPY_output.len + 3);
+        }
+    }
+}
+/*..........................................................................*/
+static void BE_flushFE(int fe) {
+    FrontEnd * const me = &l_fe[fe];
+    if (me->batchLen > BE_BATCH_HDR_SIZE) { /* any lines in the batch? */
+        me->batch[1] = (uint8_t)QSPY_TEXT_BATCH;
+        BE_sendPkt(fe, me->batch, me->batchLen);
+    }
+    me->batchLen = 0U;
+
+    if (me->decLen > BE_DEC_HDR_SIZE) { /* any records in the batch? */
+        BE_pushStrings(fe); /* the names used in the batch go first */
+        me->dec[1] = (uint8_t)QSPY_DECODED;
+        BE_sendPkt(fe, me->dec, me->decLen);
+    }
+    me->decLen = 0U;
+}
+/*..........................................................................*/
+void BE_flush(void) {
+    int fe;
+    for (fe = 0; fe < PAL_FE_MAX; ++fe) {
+        BE_flushFE(fe);
+    }
+    PAL_flushBE(); /* e.g., the coalesced TCP frames */
+}
+/*..........................................................................*/
+void BE_sendDecoded(QSpyDecoded const * const dec) {
+    QSpyDecoded rec;
+    bool resolved = false;
+    KeyType const obj = (dec->rec == l_objRec) ? l_obj : (KeyType)0;
+
+    int fe;
+    for (fe = 0; fe < PAL_FE_MAX; ++fe) { /* fan-out to all Front-Ends */
+        FrontEnd * const me = &l_fe[fe];
+        if ((me->channels & DECODED_CH) == 0) {
+            continue;
+        }
+        if (!BE_isSubscribed(fe, dec->rec, obj)) {
+            continue;
+        }
+        if (!resolved) { /* resolve the names only once for all FEs */
+            rec = *dec;
+            BE_resolve(&rec);
+            resolved = true;
+        }
+
+        /* no room for this record in the current batch? */
+        if (me->decLen + sizeof(rec) > sizeof(me->dec)) {
+            BE_flushFE(fe);
+        }
+        if (me->decLen == 0U) { /* empty batch? */
+            me->decLen = BE_DEC_HDR_SIZE;
+        }
+        memcpy(&me->dec[me->decLen], &rec, sizeof(rec));
+        me->decLen += sizeof(rec);
+    }
+}
+/*..........................................................................*/
+static void BE_resolve(QSpyDecoded * const dec) {
+    int i;
+    for (i = 0; i < (int)(sizeof(dec->key)/sizeof(dec->key[0])); ++i) {
+        KeyType const key = dec->key[i];
+        if (key != (KeyType)0) {
+            int idx = Dictionary_find(&QSPY_objDict, key);
+            if (idx >= 0) {
+                dec->keyName[i] = BE_intern(
+                    Dictionary_at(&QSPY_objDict, (unsigned)idx));
+            }
+            else {
+                idx = Dictionary_find(&QSPY_funDict, key);
+                if (idx >= 0) {
+                    dec->keyName[i] = BE_intern(
+                        Dictionary_at(&QSPY_funDict, (unsigned)idx));
+                }
+            }
+        }
+    }
+    if (dec->sigIdx != 0U) {
+        SigType const sig = dec->num[dec->sigIdx - 1U];
+        ObjType const sigObj = (dec->sigObjIdx != 0U)
+                               ? dec->key[dec->sigObjIdx - 1U]
+                               : (ObjType)0;
+        if (sig != 0U) {
+            int const idx = SigDictionary_find(&QSPY_sigDict, sig, sigObj);
+            if (idx >= 0) {
+                dec->sigName = BE_intern(QSPY_sigDict.sto[idx].name);
+            }
+        }
+    }
+}
+/*..........................................................................*/
+static uint32_t BE_intern(char const *name) {
+    uint32_t h = 2166136261U; /* FNV-1a hash */
+    char const *c;
+    for (c = name; *c != '\0'; ++c) {
+        h = (h ^ (uint8_t)*c) * 16777619U;
+    }
+
+    /* open addressing with linear probing */
+    uint32_t i;
+    for (i = h & (BE_STR_HASH - 1U);
+         l_strHash[i] != 0U;
+         i = (i + 1U) & (BE_STR_HASH - 1U))
+    {
+        if (strcmp(l_str[l_strHash[i] - 1U], name) == 0) {
+            return l_strHash[i]; /* already interned */
+        }
+    }
+    if (l_nStr == BE_STR_MAX) {
+        static bool isReported = false;
+        if (!isReported) { /* report only the first time */
+            SNPRINTF_LINE("   <F-END> ERROR    String table full Name=%s",
+                          name);
+            QSPY_printError();
+            isReported = true;
+        }
+        return 0U; /* the name is not available */
+    }
+    STRNCPY_S(l_str[l_nStr], sizeof(l_str[l_nStr]), name);
+    ++l_nStr;
+    l_strHash[i] = (uint16_t)l_nStr;
+    return l_nStr;
+}
+/*..........................................................................*/
+static void BE_pushStrings(int fe) {
+    FrontEnd * const me = &l_fe[fe];
+    static uint8_t pkt[BE_BATCH_SIZE_MAX];
+    uint32_t len = BE_BATCH_HDR_SIZE;
+
+    for (; me->nStrSent < l_nStr; ++me->nStrSent) {
+        char const *name = l_str[me->nStrSent];
+        uint32_t const id  = me->nStrSent + 1U;
+        uint32_t const n   = (uint32_t)strlen(name) + 1U;
+
+        /* no room for this string in the current packet? */
+        if (len + BE_STR_ID_SIZE + n > sizeof(pkt)) {
+            pkt[1] = (uint8_t)QSPY_STR_TABLE;
+            BE_sendPkt(fe, pkt, len);
+            len = BE_BATCH_HDR_SIZE;
+        }
+        memcpy(&pkt[len], &id, BE_STR_ID_SIZE);
+        memcpy(&pkt[len + BE_STR_ID_SIZE], name, n);
+        len += BE_STR_ID_SIZE + n;
+    }
+    if (len > BE_BATCH_HDR_SIZE) {
+        pkt[1] = (uint8_t)QSPY_STR_TABLE;
+        BE_sendPkt(fe, pkt, len);
+    }
+}
+/*..........................................................................*/
+static void BE_subscribe(int fe, QSpyRecord const * const qrec) {
+    FrontEnd * const me = &l_fe[fe];
+    uint8_t const *pos = &qrec->start[2]; /* after [seq][QSPY_SUBSCRIBE] */
+    uint8_t const *end = &qrec->start[qrec->tot_len];
+
+    if (end - pos < (int)sizeof(me->recs)) {
+        SNPRINTF_LINE("   <F-END> ERROR    Subscription too short Len=%d",
+                      (int)qrec->tot_len);
+        QSPY_printError();
+        return;
+    }
+    memcpy(me->recs, pos, sizeof(me->recs));
+    pos += sizeof(me->recs);
+
+    /* the object names (if any) follow the record bitmap */
+    me->objFilter = (pos < end);
+    me->nObjs     = 0U;
+    while (pos < end) {
+        char const *name = (char const *)pos;
+        uint8_t const *term = (uint8_t const *)memchr(pos, '\0',
+                                                      (size_t)(end - pos));
+        if (term == (uint8_t const *)0) {
+            SNPRINTF_LINE("   <F-END> ERROR    Subscription object name "
+                          "not terminated");
+            QSPY_printError();
+            break;
+        }
+        pos = term + 1;
+
+        KeyType const key = QSPY_findObj(name);
+        if (key == (KeyType)0) {
+            SNPRINTF_LINE("   <F-END> ERROR    Object Dictionary not found "
+                          "for Name=%s", name);
+            QSPY_printError();
+        }
+        else if (me->nObjs < BE_SUB_OBJ_MAX) {
+            me->objs[me->nObjs] = key;
+            ++me->nObjs;
+        }
+        else {
+            SNPRINTF_LINE("   <F-END> ERROR    Too many subscribed objects "
+                          "Name=%s", name);
+            QSPY_printError();
+        }
+    }
+
+    int nRecs = 0;
+    uint32_t i;
+    for (i = 0U; i < sizeof(me->recs); ++i) {
+        uint8_t bits = me->recs[i];
+        for (; bits != 0U; bits &= (uint8_t)(bits - 1U)) {
+            ++nRecs;
+        }
+    }
+    if (me->objFilter) {
+        SNPRINTF_LINE("   <F-END> Subscribed FE=%d Recs=%d,Objs=%d",
+                      fe, nRecs, (int)me->nObjs);
+    }
+    else {
+        SNPRINTF_LINE("   <F-END> Subscribed FE=%d Recs=%d,Objs=ALL",
+                      fe, nRecs);
+    }
+    QSPY_printInfo();
+}
+/*..........................................................................*/
+static void BE_subscribeAll(int fe) {
+    FrontEnd * const me = &l_fe[fe];
+    memset(me->recs, 0xFF, sizeof(me->recs));
+    me->objFilter = false;
+    me->nObjs     = 0U;
+}
+/*..........................................................................*/
+static bool BE_isSubscribed(int fe, uint8_t rec, KeyType obj) {
+    FrontEnd const * const me = &l_fe[fe];
+
+    /* the non-maskable records are always forwarded, as in the Target */
+    if ((rec == QS_EMPTY)
+        || ((QS_TEST_PAUSED <= rec) && (rec < QS_MAX))
+        || (rec >= (uint8_t)(8U * sizeof(me->recs))))
+    {
+        return true;
+    }
+    if ((me->recs[rec >> 3] & (1U << (rec & 7U))) == 0U) {
+        return false;
+    }
+    if (!me->objFilter || (obj == (KeyType)0)) {
+        return true; /* no whitelist or the record has no object */
+    }
+    uint8_t i;
+    for (i = 0U; i < me->nObjs; ++i) {
+        if (me->objs[i] == obj) {
+            return true;
         }
     }
+    return false;
 }
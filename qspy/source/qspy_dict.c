@@ -90,6 +90,16 @@ QSpyStatus QSPY_writeDict(void) {
         return QSPY_ERROR;
     }
 
+    QDIC_writeFile(dictFile);
+    fclose(dictFile);
+
+    SNPRINTF_LINE("   <QSPY-> Dictionaries saved to File=%s", buf);
+    QSPY_printInfo();
+
+    return QSPY_SUCCESS;
+}
+/*..........................................................................*/
+void QDIC_writeFile(FILE *dictFile) {
     FPRINTF_S(dictFile, "-v%03d\n", (int)QSPY_conf.version);
     FPRINTF_S(dictFile, "-T%01d\n", (int)QSPY_conf.tstampSize);
     FPRINTF_S(dictFile, "-O%01d\n", (int)QSPY_conf.objPtrSize);
@@ -119,13 +129,6 @@ QSpyStatus QSPY_writeDict(void) {
 
     FPRINTF_S(dictFile, "%s\n", "Sig-Dic:");
     SigDictionary_write(&QSPY_sigDict, dictFile);
-
-    fclose(dictFile);
-
-    SNPRINTF_LINE("   <QSPY-> Dictionaries saved to File=%s", buf);
-    QSPY_printInfo();
-
-    return QSPY_SUCCESS;
 }
 /*..........................................................................*/
 QSpyStatus QSPY_readDict(void) {
@@ -0,0 +1,372 @@
+/*============================================================================
+* QP/C Real-Time Embedded Framework (RTEF)
+* Copyright (C) 2005 Quantum Leaps, LLC. All rights reserved.
+*
+* SPDX-License-Identifier: GPL-3.0-or-later OR LicenseRef-QL-commercial
+*
+* This software is dual-licensed under the terms of the open source GNU
+* General Public License version 3 (or any later version), or alternatively,
+* under the terms of one of the closed source Quantum Leaps commercial
+* licenses.
+*
+* The terms of the open source GNU General Public License version 3
+* can be found at: <www.gnu.org/licenses/gpl-3.0>
+*
+* The terms of the closed source Quantum Leaps commercial licenses
+* can be found at: <www.state-machine.com/licensing>
+*
+* Redistributions in source code must retain this top-level comment block.
+* Plagiarizing this software to sidestep the license obligations is illegal.
+*
+* Contact information:
+* <www.state-machine.com>
+* <info@state-machine.com>
+============================================================================*/
+/*!
+* @date Last updated on: 2022-08-12
+* @version Last updated for version: 7.0.0
+*
+* @file
+* @brief QSPY host uility: flight recorder of the raw QS data
+* @ingroup qpspy
+*
+* The raw Target data are kept in a ring in memory, which is written to
+* a binary file (as with -s, for "qspy -f") only when a trigger fires:
+* QS_ASSERT_FAIL, a record-ID, a signal, a text in the output lines, a free
+* queue margin at or below a threshold, or the user (key 'f' or QSPY_TRIGGER
+* from a Front-End). The dump waits for the post-trigger part of the ring
+* and comes with the dictionaries collected so far (for "qspy -d").
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "safe_std.h" /* "safe" <stdio.h> and <string.h> facilities */
+#include "qspy.h"     /* QSPY data parser */
+#include "pal.h"      /* QSPY PAL */
+
+#define Q_SPY   1       /* this is QP implementation */
+#define QP_IMPL 1       /* this is QP implementation */
+#include "qpc_qs.h"     /* QS target-resident interface */
+#include "qpc_qs_pkg.h" /* QS package-scope interface */
+
+enum {
+    FREC_RING_MAX = 64*1024*1024, /* the largest ring */
+    FREC_TRIG_MAX = 8,   /* configured triggers */
+    FREC_WHAT_LEN = QS_DNAME_LEN_MAX + 32 /* description of a trigger */
+};
+
+typedef enum {
+    FREC_REC,    /* record-ID */
+    FREC_SIG,    /* signal (number or name) */
+    FREC_TEXT,   /* text in the output line */
+    FREC_MARGIN  /* free entries in a queue */
+} FrecTrigType;
+
+typedef struct {
+    FrecTrigType type;
+    uint32_t num;   /* record-ID, signal number, or the free margin */
+    bool     byName; /* FREC_SIG given by the name */
+    char     str[QS_DNAME_LEN_MAX]; /* signal name or the text */
+} FrecTrig;
+
+static uint8_t *l_frecRing; /* allocated by QFREC_config() */
+
+static struct {
+    uint32_t size;     /* ring size, 0 means no flight recorder */
+    uint32_t post;     /* post-trigger part of the ring [bytes] */
+    uint64_t head;     /* bytes written to the ring */
+    bool     fired;    /* a trigger waits for its post-trigger part? */
+    bool     notice;   /* the trigger not reported yet? */
+    uint64_t trig;     /* the head at the trigger */
+    uint32_t ignored;  /* triggers during the post-trigger part */
+    uint32_t dumps;
+    char     what[FREC_WHAT_LEN]; /* description of the trigger */
+    FrecTrig trigs[FREC_TRIG_MAX];
+    uint8_t  nTrigs;
+    bool     text;     /* any FREC_TEXT triggers? */
+} l_frec;
+
+static void QFREC_fire(char const *what);
+static void QFREC_poll(void);
+static void QFREC_dump(void);
+
+/*..........................................................................*/
+QSpyStatus QFREC_config(uint32_t ringMB, uint32_t postPct) {
+    if ((ringMB == 0U) || (ringMB > FREC_RING_MAX / (1024U*1024U))
+        || (postPct >= 100U))
+    {
+        return QSPY_ERROR;
+    }
+    free(l_frecRing);
+    l_frecRing  = (uint8_t *)malloc(ringMB * 1024U * 1024U);
+    l_frec.size = (l_frecRing != (uint8_t *)0) ? ringMB * 1024U * 1024U : 0U;
+    if (l_frec.size == 0U) {
+        return QSPY_ERROR;
+    }
+    l_frec.post = (uint32_t)((uint64_t)l_frec.size * postPct / 100U);
+    return QSPY_SUCCESS;
+}
+/*..........................................................................*/
+QSpyStatus QFREC_configTrigger(char const *spec) {
+    if (l_frec.nTrigs >= FREC_TRIG_MAX) {
+        return QSPY_ERROR;
+    }
+    FrecTrig * const trig = &l_frec.trigs[l_frec.nTrigs];
+    char const *arg = strchr(spec, ':');
+    if ((arg == (char const *)0) || (arg[1] == '\0')) {
+        return QSPY_ERROR;
+    }
+    ++arg;
+    char *end;
+    uint32_t const num = (uint32_t)strtoul(arg, &end, 10);
+    bool const isNum = (*end == '\0');
+    if (strncmp(spec, "rec:", 4) == 0) {
+        if (!isNum) {
+            return QSPY_ERROR;
+        }
+        trig->type = FREC_REC;
+        trig->num  = num;
+    }
+    else if (strncmp(spec, "sig:", 4) == 0) {
+        trig->type   = FREC_SIG;
+        trig->byName = !isNum;
+        trig->num    = num;
+    }
+    else if (strncmp(spec, "text:", 5) == 0) {
+        trig->type = FREC_TEXT;
+        l_frec.text = true;
+    }
+    else if (strncmp(spec, "margin:", 7) == 0) {
+        if (!isNum) {
+            return QSPY_ERROR;
+        }
+        trig->type = FREC_MARGIN;
+        trig->num  = num;
+    }
+    else {
+        return QSPY_ERROR;
+    }
+    STRNCPY_S(trig->str, sizeof(trig->str), arg);
+    ++l_frec.nTrigs;
+    return QSPY_SUCCESS;
+}
+/*..........................................................................*/
+void QFREC_onRxChunk(uint8_t const *buf, uint32_t nBytes) {
+    if (l_frec.size == 0U) {
+        return;
+    }
+
+    /* only the last ring size of a larger chunk is kept */
+    if (nBytes > l_frec.size) {
+        l_frec.head += nBytes - l_frec.size;
+        buf    += nBytes - l_frec.size;
+        nBytes  = l_frec.size;
+    }
+    uint32_t const off = (uint32_t)(l_frec.head % l_frec.size);
+    uint32_t n = l_frec.size - off; /* up to the end of the ring */
+    if (n > nBytes) {
+        n = nBytes;
+    }
+    memcpy(&l_frecRing[off], buf, n);
+    memcpy(&l_frecRing[0], buf + n, nBytes - n);
+    l_frec.head += nBytes;
+    QFREC_poll();
+}
+/*..........................................................................*/
+void QFREC_onRecord(QSpyRecord const * const qrec) {
+    if (l_frec.size == 0U) {
+        return;
+    }
+    if (qrec->rec == QS_ASSERT_FAIL) {
+        QFREC_fire("ASSERT_FAIL");
+        return;
+    }
+    uint8_t i;
+    for (i = 0U; i < l_frec.nTrigs; ++i) {
+        FrecTrig const * const trig = &l_frec.trigs[i];
+        if ((trig->type == FREC_REC) && (trig->num == qrec->rec)) {
+            char what[FREC_WHAT_LEN];
+            SNPRINTF_S(what, sizeof(what), "Rec=%u", (unsigned)qrec->rec);
+            QFREC_fire(what);
+            return;
+        }
+    }
+}
+/*..........................................................................*/
+void QFREC_onDecoded(QSpyDecoded const * const dec) {
+    if (l_frec.size == 0U) {
+        return;
+    }
+    uint8_t i;
+    for (i = 0U; i < l_frec.nTrigs; ++i) {
+        FrecTrig const * const trig = &l_frec.trigs[i];
+        if ((trig->type == FREC_SIG) && (dec->sigIdx != 0U)) {
+            SigType const sig = dec->num[dec->sigIdx - 1U];
+            KeyType const obj = (dec->sigObjIdx != 0U)
+                                ? dec->key[dec->sigObjIdx - 1U] : 0U;
+            if (trig->byName
+                ? (strcmp(SigDictionary_get(&QSPY_sigDict, sig, obj,
+                                            (char *)0), trig->str) == 0)
+                : (sig == trig->num))
+            {
+                char what[FREC_WHAT_LEN];
+                SNPRINTF_S(what, sizeof(what), "Sig=%s", trig->str);
+                QFREC_fire(what);
+                return;
+            }
+        }
+        else if (trig->type == FREC_MARGIN) {
+            switch (dec->rec) {
+                case QS_QF_ACTIVE_POST:
+                case QS_QF_ACTIVE_POST_ATTEMPT:
+                case QS_QF_ACTIVE_POST_LIFO:
+                case QS_QF_EQUEUE_POST:
+                case QS_QF_EQUEUE_POST_ATTEMPT:
+                case QS_QF_EQUEUE_POST_LIFO:
+                    if (dec->num[3] <= trig->num) { /* d: free entries */
+                        char buf[QS_DNAME_LEN_MAX];
+                        char what[FREC_WHAT_LEN];
+                        SNPRINTF_S(what, sizeof(what),
+                                   "Margin(Obj=%s,Free=%u)",
+                                   Dictionary_get(&QSPY_objDict,
+                                                  dec->key[0], buf),
+                                   (unsigned)dec->num[3]);
+                        QFREC_fire(what);
+                        return;
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+}
+/*..........................................................................*/
+void QFREC_onPrintLn(char const *line) {
+    if ((!l_frec.text) || (QSPY_output.type != REG_OUT)) {
+        return; /* the text triggers look only at the Target records */
+    }
+    uint8_t i;
+    for (i = 0U; i < l_frec.nTrigs; ++i) {
+        FrecTrig const * const trig = &l_frec.trigs[i];
+        if ((trig->type == FREC_TEXT)
+            && (strstr(line, trig->str) != (char *)0))
+        {
+            char what[FREC_WHAT_LEN];
+            SNPRINTF_S(what, sizeof(what), "Text=%s", trig->str);
+            QFREC_fire(what);
+            return;
+        }
+    }
+}
+/*..........................................................................*/
+void QFREC_trigger(char const *what) {
+    if (l_frec.size == 0U) {
+        SNPRINTF_LINE("   <QSPY-> %s",
+                      "Flight Recorder NOT configured (no -z option)");
+        QSPY_printError();
+        return;
+    }
+    QFREC_fire(what);
+    QFREC_poll();
+}
+/*..........................................................................*/
+void QFREC_cleanup(void) {
+    if (l_frec.fired) { /* the post-trigger part cut short */
+        QFREC_poll();
+        QFREC_dump();
+    }
+    free(l_frecRing);
+    l_frecRing  = (uint8_t *)0;
+    l_frec.size = 0U;
+}
+/*..........................................................................*/
+/* NOTE: called while parsing, so the output line must not be touched */
+static void QFREC_fire(char const *what) {
+    if (l_frec.fired) {
+        ++l_frec.ignored; /* the dump of the previous one is pending */
+        return;
+    }
+    STRNCPY_S(l_frec.what, sizeof(l_frec.what), what);
+    l_frec.fired  = true;
+    l_frec.notice = true;
+    l_frec.trig   = l_frec.head;
+}
+/*..........................................................................*/
+/* report the trigger and dump the ring when the post-trigger part is in */
+static void QFREC_poll(void) {
+    if (l_frec.notice) {
+        l_frec.notice = false;
+        SNPRINTF_LINE("   <QSPY-> Flight Recorder Trigger=%s", l_frec.what);
+        QSPY_printInfo();
+    }
+    if (l_frec.fired && (l_frec.head >= l_frec.trig + l_frec.post)) {
+        QFREC_dump();
+    }
+}
+/*..........................................................................*/
+static void QFREC_dump(void) {
+    FILE *binFile = (FILE *)0;
+    FILE *dicFile = (FILE *)0;
+    char name[QS_FNAME_LEN_MAX];
+
+    l_frec.fired = false;
+
+    /* the pre-trigger part, but at most the data still in the ring
+    * (the last chunk might have overwritten even the trigger)
+    */
+    uint32_t const pre = l_frec.size - l_frec.post;
+    uint64_t start = (l_frec.trig > pre) ? (l_frec.trig - pre) : 0U;
+    if (l_frec.head - start > l_frec.size) {
+        start = l_frec.head - l_frec.size;
+    }
+    if (start != 0U) { /* start at the first complete frame */
+        while ((start < l_frec.head)
+               && (l_frecRing[start % l_frec.size] != QS_FRAME))
+        {
+            ++start;
+        }
+        if (start < l_frec.head) {
+            ++start; /* past the frame */
+        }
+    }
+    uint64_t const trig = (l_frec.trig > start) ? l_frec.trig : start;
+
+    ++l_frec.dumps;
+    SNPRINTF_S(name, sizeof(name), "qspy%s_fr%u.dic",
+               QSPY_tstampStr(), (unsigned)l_frec.dumps);
+    FOPEN_S(dicFile, name, "w");
+    if (dicFile != (FILE *)0) {
+        QDIC_writeFile(dicFile);
+        fclose(dicFile);
+    }
+    SNPRINTF_S(name, sizeof(name), "qspy%s_fr%u.bin",
+               QSPY_tstampStr(), (unsigned)l_frec.dumps);
+    FOPEN_S(binFile, name, "wb");
+    if (binFile == (FILE *)0) {
+        SNPRINTF_LINE("   <QSPY-> Cannot open File=%s for writing", name);
+        QSPY_printError();
+        return;
+    }
+    uint32_t const off = (uint32_t)(start % l_frec.size);
+    uint64_t const n = l_frec.head - start;
+    if (off + n > l_frec.size) { /* wraps around the end of the ring? */
+        fwrite(&l_frecRing[off], 1, l_frec.size - off, binFile);
+        fwrite(&l_frecRing[0], 1, (size_t)(off + n - l_frec.size),
+               binFile);
+    }
+    else {
+        fwrite(&l_frecRing[off], 1, (size_t)n, binFile);
+    }
+    fclose(binFile);
+
+    SNPRINTF_LINE("   <QSPY-> Flight Recorder Trigger=%s saved to File=%s "
+                  "(Pre=%uKB,Post=%uKB,Ignored=%u)",
+                  l_frec.what, name,
+                  (unsigned)((trig - start) / 1024U),
+                  (unsigned)((l_frec.head - trig) / 1024U),
+                  (unsigned)l_frec.ignored);
+    QSPY_printInfo();
+    l_frec.ignored = 0U;
+}
@@ -64,6 +64,7 @@ static FILE *l_outFile = (FILE *)0;
 static FILE *l_savFile = (FILE *)0;
 static FILE *l_matFile = (FILE *)0;
 static FILE *l_seqFile = (FILE *)0;
+static FILE *l_cpuFile = (FILE *)0;
 
 static char  l_comPort    [QS_FNAME_LEN_MAX];
 static char  l_device[QS_FNAME_LEN_MAX];
@@ -72,12 +73,15 @@ static char  l_outFileName[QS_FNAME_LEN_MAX];
 static char  l_savFileName[QS_FNAME_LEN_MAX];
 static char  l_matFileName[QS_FNAME_LEN_MAX];
 static char  l_seqFileName[QS_FNAME_LEN_MAX];
+static char  l_cpuFileName[QS_FNAME_LEN_MAX];
 static char  l_dicFileName[QS_FNAME_LEN_MAX];
 
 static char  l_tstampStr  [16];
 static char  l_seqList[QS_SEQ_LIST_LEN_MAX];
 
 static int   l_bePort   = 7701;   /* default UDP port  */
+static char  l_bePath[QS_FNAME_LEN_MAX]; /* Unix-domain BE instead of UDP */
+static bool  l_beTcp    = false;  /* TCP BE instead of UDP */
 static int   l_tcpPort  = 6601;   /* default TCP port */
 static int   l_baudRate = 115200; /* default serial baudrate */
 static uint32_t l_jlinkSerNo = 0; /* default: will be selected from the list */
@@ -101,6 +105,8 @@ static char const l_helpStr[] =
     "-h                        help (show this message)\n"
     "-q [num]          (key-q) quiet mode (no QS data output)\n"
     "-u [UDP_port|0]   7701    UDP socket with optional port, 0-no UDP\n"
+    "-u unix:<path>            Unix-domain socket instead of UDP\n"
+    "-u tcp:<port>             TCP socket instead of UDP\n"
     "-v <QS_version>   6.6     compatibility with QS version\n"
     "-r <c0|c1|c2>     c1      rendering (c0=no-color, c1-color1, )\n"
     "-k                        suppress keyboard input\n"
@@ -108,13 +114,15 @@ static char const l_helpStr[] =
     "-s                (key-s) save binary QS data to a file\n"
     "-m                        produce Matlab output to a file\n"
     "-g <obj_list>             produce Sequence diagram to a file\n"
+    "-G <seq|puml|mmd> seq     Sequence diagram format\n"
     "-t [TCP_port]     6601    TCP/IP input with optional port\n"
 #ifdef _WIN32
     "-c <COM_port>     COM1    com port input (default)\n"
 #elif (defined __linux) || (defined __linux__) || (defined __posix)
     "-c <serial_port>  /dev/ttyS0 serial port input (default)\n"
 #endif
-    "-b <baud_rate>    115200  baud rate for the com port\n"
+    "-b <baud_rate>[:<vmin>:<vtime>] 115200 baud rate for the com port\n"
+    "-R [ring_KB]      4096    receive thread with the given ring size\n"
     "-f <file_name>            file input (postprocessing)\n"
 	"-j <processor>[:<ser-num>] processor[:JLink serial number]\n"
     "-d [file_name]            dictionary files\n"
@@ -126,7 +134,14 @@ static char const l_helpStr[] =
     "-Q <counter_size> 1       queue counter size    (bytes)\n"
     "-P <counter_size> 2       pool counter size     (bytes)\n"
     "-B <block_size>   2       pool block-size size  (bytes)\n"
-    "-C <counter_size> 2       QTimeEvt counter size (bytes)\n";
+    "-C <counter_size> 2       QTimeEvt counter size (bytes)\n"
+    "-w <tstamp_Hz>            nominal QS timestamp rate (clock drift)\n"
+    "-l <outlier_us>           crit.section/ISR outliers to report\n"
+    "-L <leak_ms>      1000    events live longer are suspected leaks\n"
+    "-W <window_ms>    1000    window of the CPU utilization\n"
+    "-z [MB[:post_%]]  16:25   flight recorder ring (key-f to trigger)\n"
+    "-Z <kind>:<arg>           flight recorder trigger (rec:<id>,\n"
+    "                          sig:<name|num>,text:<str>,margin:<free>)\n";
 
 static char const l_kbdHelpStr[] =
     "Keyboard shortcuts (valid when -k option is absent):\n"
@@ -144,12 +159,22 @@ static char const l_kbdHelpStr[] =
     "  o               toggle screen file output (close/re-open)\n"
     "  s/b             toggle binary file output (close/re-open)\n"
     "  m               toggle Matlab file output (close/re-open)\n"
-    "  g               toggle Message sequence output (close/re-open)\n";
+    "  g               toggle Message sequence output (close/re-open)\n"
+    "  a               report the statistics of the QS data\n"
+    "  p               toggle CPU utilization file output (close/re-open)\n"
+    "  e               save the state graph to a file (Graphviz DOT)\n"
+    "  f               trigger the flight recorder dump (-z option)\n";
 
 /*..........................................................................*/
 static QSpyStatus configure(int argc, char *argv[]);
 static void colorPrintLn(void);
-static uint8_t l_buf[8*1024]; /* process input in 8K chunks */
+static uint8_t l_buf[64*1024]; /* process input in 64K chunks */
+
+/* the batched output is flushed when the PAL runs out of events, and
+* periodically under a sustained load (when the PAL supports timers)
+*/
+enum { QSPY_FLUSH_MS = 20 };
+static bool l_flushIdle;
 
 /*..........................................................................*/
 int main(int argc, char *argv[]) {
@@ -164,6 +189,7 @@ int main(int argc, char *argv[]) {
         bool isRunning = true;
 
         status = 0; /* assume success */
+        l_flushIdle = (PAL_setTimer(QSPY_FLUSH_MS) == QSPY_SUCCESS);
         while (isRunning) {   /* QSPY event loop... */
 
             /* get the event from the PAL... */
@@ -174,9 +200,14 @@ int main(int argc, char *argv[]) {
                 case QSPY_NO_EVT: /* all intputs timed-out this time around */
                     break;
 
+                case QSPY_TIMER_EVT: /* periodic flush (see below) */
+                    break;
+
                 case QSPY_TARGET_INPUT_EVT: /* the Target sent some data... */
                     if (nBytes > 0) {
+                        QSTAT_onRxChunk(PAL_rxTimeUs());
                         QSPY_parse(l_buf, (uint32_t)nBytes);
+                        QFREC_onRxChunk(l_buf, (uint32_t)nBytes);
                         if (l_savFile != (FILE *)0) {
                             fwrite(l_buf, 1, nBytes, l_savFile);
                         }
@@ -203,6 +234,16 @@ int main(int argc, char *argv[]) {
                     status = -1;        /* error return */
                     break;
             }
+
+            /* send out the text lines batched while processing the event
+            * (or after the PAL time-out). With the timer, the Target input
+            * keeps filling the batches until the PAL runs out of events.
+            */
+            if ((l_bePort != 0)
+                && (!l_flushIdle || (evt != QSPY_TARGET_INPUT_EVT)))
+            {
+                BE_flush();
+            }
         }
     }
 
@@ -225,7 +266,12 @@ void QSPY_cleanup(void) {
     QSPY_configMatFile((void*)0);
     QSEQ_configFile((void*)0);
 
+    QSTAT_report(); /* the final statistics */
+    QSTAT_configCpuFile((void*)0);
+    QFREC_cleanup(); /* the pending flight-recorder dump */
+
     if (l_bePort != 0) {
+        BE_flush();             /* the output still batched for the FEs */
         PAL_closeBE();          /* close the Back-End connection */
     }
 
@@ -246,6 +292,8 @@ void Q_onAssert(char const * const module, int loc) {
 
 /*..........................................................................*/
 void QSPY_onPrintLn(void) {
+    QFREC_onPrintLn(&QSPY_output.buf[QS_LINE_OFFSET]);
+
     if (l_outFile != (FILE *)0) {
         /* output file receives all trace records, regardles of -q mode */
         fputs(&QSPY_output.buf[QS_LINE_OFFSET], l_outFile);
@@ -256,7 +304,9 @@ void QSPY_onPrintLn(void) {
         BE_sendLine(); /* forward to the back-end */
     }
 
-    if (l_quiet < 0) {
+    if ((l_quiet < 0)
+        || (QSPY_output.type == STAT_OUT)) /* statistics requested? */
+    {
         if (l_colorPalette) {
             colorPrintLn();
         }
@@ -289,11 +339,22 @@ void QSPY_onPrintLn(void) {
 
     QSPY_output.type = REG_OUT; /* reset for the next time */
 }
+/*..........................................................................*/
+void QSPY_onRecord(QSpyRecord const * const qrec) {
+    QSTAT_onRecord(qrec);
+    QFREC_onRecord(qrec);
+}
+/*..........................................................................*/
+void QSPY_onDecoded(QSpyDecoded const * const dec) {
+    BE_sendDecoded(dec); /* forward to the back-end */
+    QSTAT_onDecoded(dec); /* collect the analytics */
+    QFREC_onDecoded(dec); /* check the flight-recorder triggers */
+}
 
 /*..........................................................................*/
 static QSpyStatus configure(int argc, char *argv[]) {
     static char const getoptStr[] =
-        "hq::u::v:r:kosmg:c:b:t::p:f:j:d::T:O:F:S:E:Q:P:B:C:";
+        "hq::u::v:r:kosmg:G:c:b:t::p:f:j:d::T:O:F:S:E:Q:P:B:C:R::w:l:L:W:z::Z:";
 
     /* default configuration options... */
     QSpyConfig config = {
@@ -315,6 +376,7 @@ static QSpyStatus configure(int argc, char *argv[]) {
     STRNCPY_S(l_savFileName, sizeof(l_savFileName), "OFF");
     STRNCPY_S(l_matFileName, sizeof(l_matFileName), "OFF");
     STRNCPY_S(l_seqFileName, sizeof(l_seqFileName), "OFF");
+    STRNCPY_S(l_cpuFileName, sizeof(l_cpuFileName), "OFF");
     STRNCPY_S(l_dicFileName, sizeof(l_dicFileName), "OFF");
 
     STRNCPY_S(l_tstampStr, sizeof(l_tstampStr), QSPY_tstampStr());
@@ -341,7 +403,17 @@ static QSpyStatus configure(int argc, char *argv[]) {
                 break;
             }
             case 'u': { /* UDP control port */
-                if (optarg != NULL) { /* is optional argument provided? */
+                if ((optarg != NULL) && (strncmp(optarg, "unix:", 5) == 0)) {
+                    STRNCPY_S(l_bePath, sizeof(l_bePath), &optarg[5]);
+                    l_bePort = 7701; /* Back-End enabled */
+                }
+                else if ((optarg != NULL)
+                         && (strncmp(optarg, "tcp:", 4) == 0))
+                {
+                    l_bePort = (int)strtoul(&optarg[4], NULL, 10);
+                    l_beTcp  = (l_bePort != 0);
+                }
+                else if (optarg != NULL) { /* optional argument provided? */
                     l_bePort = (int)strtoul(optarg, NULL, 10);
                 }
                 else { /* apply the default */
@@ -381,6 +453,19 @@ static QSpyStatus configure(int argc, char *argv[]) {
                 }
                 break;
             }
+            case 'R': { /* receive thread */
+                uint32_t ringKB = 4096U;
+                if (optarg != NULL) { /* is optional argument provided? */
+                    ringKB = (uint32_t)strtoul(optarg, NULL, 10);
+                }
+                if (PAL_configRxThread(&ringKB) != QSPY_SUCCESS) {
+                    FPRINTF_S(stderr, "%s\n",
+                        "The -R option is not supported or incorrect");
+                    return QSPY_ERROR;
+                }
+                PRINTF_S("-R %u\n", (unsigned)ringKB);
+                break;
+            }
             case 'k': { /* suppress keyboard input */
                 l_kbd_inp = false;
                 break;
@@ -413,10 +498,23 @@ static QSpyStatus configure(int argc, char *argv[]) {
                     return QSPY_ERROR;
                 }
                 SNPRINTF_S(l_seqFileName, sizeof(l_seqFileName) - 1U,
-                           "qspy%s.seq", l_tstampStr);
+                           "qspy%s.%s", l_tstampStr, QSEQ_fileExt());
                 PRINTF_S("-g %s (%s)\n", l_seqList, l_seqFileName);
                 break;
             }
+            case 'G': { /* Sequence file format */
+                if (!QSEQ_configFormat(optarg)) {
+                    FPRINTF_S(stderr, "unknown sequence diagram format %s\n",
+                              optarg);
+                    return QSPY_ERROR;
+                }
+                if (l_seqFileName[0] != 'O') { /* -g already provided? */
+                    SNPRINTF_S(l_seqFileName, sizeof(l_seqFileName) - 1U,
+                               "qspy%s.%s", l_tstampStr, QSEQ_fileExt());
+                }
+                PRINTF_S("-G %s\n", optarg);
+                break;
+            }
             case 'c': { /* COM port */
                 if ((l_link != NO_LINK) && (l_link != SERIAL_LINK)) {
                     FPRINTF_S(stderr, "%s\n",
@@ -434,12 +532,27 @@ static QSpyStatus configure(int argc, char *argv[]) {
                         "The -b option is incompatible with -t/-f/-j");
                     return QSPY_ERROR;
                 }
-                l_baudRate = (int)strtol(optarg, NULL, 10);
-                if (l_baudRate == 0) {
+                char *pEnd;
+                l_baudRate = (int)strtol(optarg, &pEnd, 10);
+                if (l_baudRate <= 0) {
                     FPRINTF_S(stderr, "incorrect baud rate: %s\n", optarg);
                     return QSPY_ERROR;
                 }
-                PRINTF_S("-b %d\n", l_baudRate);
+                if (*pEnd == ':') { /* VMIN:VTIME of the serial reads? */
+                    int vmin  = (int)strtol(pEnd + 1, &pEnd, 10);
+                    int vtime = (*pEnd == ':')
+                                ? (int)strtol(pEnd + 1, &pEnd, 10) : -1;
+                    if ((*pEnd != '\0')
+                        || (vmin < 0) || (vmin > 255)
+                        || (vtime < 0) || (vtime > 255))
+                    {
+                        FPRINTF_S(stderr, "incorrect vmin:vtime: %s\n",
+                                  optarg);
+                        return QSPY_ERROR;
+                    }
+                    PAL_configSer(vmin, vtime);
+                }
+                PRINTF_S("-b %s\n", optarg);
                 l_link = SERIAL_LINK;
                 break;
             }
@@ -547,6 +660,53 @@ static QSpyStatus configure(int argc, char *argv[]) {
                 config.tevtCtrSize = (uint8_t)strtoul(optarg, 0, 10);
                 break;
             }
+            case 'w': { /* nominal timestamp rate for the clock model */
+                QSTAT_config((uint32_t)strtoul(optarg, 0, 10));
+                PRINTF_S("-w %s\n", optarg);
+                break;
+            }
+            case 'l': { /* outlier threshold of the crit.sections and ISRs */
+                QSTAT_configOutlier((uint32_t)strtoul(optarg, 0, 10));
+                PRINTF_S("-l %s\n", optarg);
+                break;
+            }
+            case 'L': { /* leak window of the dynamic events */
+                QSTAT_configLeak((uint32_t)strtoul(optarg, 0, 10));
+                PRINTF_S("-L %s\n", optarg);
+                break;
+            }
+            case 'W': { /* window of the CPU utilization */
+                QSTAT_configCpu((uint32_t)strtoul(optarg, 0, 10));
+                PRINTF_S("-W %s\n", optarg);
+                break;
+            }
+            case 'z': { /* flight recorder */
+                uint32_t ringMB  = 16U;
+                uint32_t postPct = 25U;
+                if (optarg != NULL) { /* is optional argument provided? */
+                    char *end;
+                    ringMB = (uint32_t)strtoul(optarg, &end, 10);
+                    if (*end == ':') {
+                        postPct = (uint32_t)strtoul(end + 1, NULL, 10);
+                    }
+                }
+                if (QFREC_config(ringMB, postPct) != QSPY_SUCCESS) {
+                    FPRINTF_S(stderr, "%s\n",
+                        "The -z option is incorrect");
+                    return QSPY_ERROR;
+                }
+                PRINTF_S("-z %u:%u\n", (unsigned)ringMB, (unsigned)postPct);
+                break;
+            }
+            case 'Z': { /* flight recorder trigger */
+                if (QFREC_configTrigger(optarg) != QSPY_SUCCESS) {
+                    FPRINTF_S(stderr, "The -Z %s option is incorrect\n",
+                              optarg);
+                    return QSPY_ERROR;
+                }
+                PRINTF_S("-Z %s\n", optarg);
+                break;
+            }
             case 'h': { /* help */
                 PRINTF_S("\n%s\n%s", l_helpStr, l_kbdHelpStr);
                 return QSPY_ERROR;
@@ -578,7 +738,19 @@ static QSpyStatus configure(int argc, char *argv[]) {
 
     /* configure QSPY ......................................................*/
     /* open Back-End link. NOTE: must happen *before* opening Target link */
-    if (l_bePort != 0) {
+    if (l_bePath[0] != '\0') {
+        PRINTF_S("-u unix:%s\n", l_bePath);
+        if (PAL_openBEUnix(l_bePath) == QSPY_ERROR) {
+            return QSPY_ERROR;
+        }
+    }
+    else if (l_beTcp) {
+        PRINTF_S("-u tcp:%d\n", l_bePort);
+        if (PAL_openBETcp(l_bePort) == QSPY_ERROR) {
+            return QSPY_ERROR;
+        }
+    }
+    else if (l_bePort != 0) {
         PRINTF_S("-u %d\n", l_bePort);
         if (PAL_openBE(l_bePort) == QSPY_ERROR) {
             return QSPY_ERROR;
@@ -688,6 +860,7 @@ bool QSPY_command(uint8_t cmdId) {
             PRINTF_S("Binary   Output [s]: %s\n", l_savFileName);
             PRINTF_S("Matlab   Output [m]: %s\n", l_matFileName);
             PRINTF_S("Sequence Output [g]: %s\n", l_seqFileName);
+            PRINTF_S("CPU Util Output [p]: %s\n", l_cpuFileName);
             break;
 
         case 'r':  /* send RESET command to the Target */
@@ -722,6 +895,33 @@ bool QSPY_command(uint8_t cmdId) {
             QSPY_writeDict();
             break;
 
+        case 'a':  /* report the statistics */
+            QSTAT_report();
+            break;
+
+        case 'f':  /* trigger the flight recorder dump */
+            QFREC_trigger("USER");
+            break;
+
+        case 'e': { /* save the state graph to a file */
+            FILE *dotFile = (FILE *)0;
+            char dotFileName[QS_FNAME_LEN_MAX];
+            SNPRINTF_S(dotFileName, sizeof(dotFileName),
+                       "qspy%s.dot", QSPY_tstampStr());
+            FOPEN_S(dotFile, dotFileName, "w");
+            if (dotFile != (FILE *)0) {
+                QSTAT_writeGraph(dotFile);
+                fclose(dotFile);
+                PRINTF_S("   <USER-> State Graph [e] File=%s\n",
+                         dotFileName);
+            }
+            else {
+                PRINTF_S("   <QSPY-> Cannot open File=%s for writing\n",
+                         dotFileName);
+            }
+            break;
+        }
+
         case 'c':  /* clear the screen */
             PAL_clearScreen();
             break;
@@ -819,7 +1019,7 @@ bool QSPY_command(uint8_t cmdId) {
             }
             else {
                 SNPRINTF_S(l_seqFileName, sizeof(l_seqFileName),
-                           "qspy%s.seq", QSPY_tstampStr());
+                           "qspy%s.%s", QSPY_tstampStr(), QSEQ_fileExt());
                 FOPEN_S(l_seqFile, l_seqFileName, "w");
                 if (l_seqFile != (FILE *)0) {
                     QSEQ_configFile(l_seqFile);
@@ -834,6 +1034,29 @@ bool QSPY_command(uint8_t cmdId) {
                    l_seqFileName);
             break;
 
+        case 'p':  /* save CPU utilization file open/close toggle */
+            if (l_cpuFile != (FILE *)0) {
+                QSTAT_configCpuFile((void *)0); /* close the CPU file */
+                l_cpuFile = (FILE *)0;
+                STRNCPY_S(l_cpuFileName, sizeof(l_cpuFileName), "OFF");
+            }
+            else {
+                SNPRINTF_S(l_cpuFileName, sizeof(l_cpuFileName),
+                           "qspy%s.cpu.csv", QSPY_tstampStr());
+                FOPEN_S(l_cpuFile, l_cpuFileName, "w");
+                if (l_cpuFile != (FILE *)0) {
+                    QSTAT_configCpuFile(l_cpuFile);
+                }
+                else {
+                    PRINTF_S("   <QSPY-> Cannot open File=%s for writing\n",
+                             l_cpuFileName);
+                    STRNCPY_S(l_cpuFileName, sizeof(l_cpuFileName), "OFF");
+                }
+            }
+            PRINTF_S("   <USER-> CPU Util Output [p] File=%s\n",
+                   l_cpuFileName);
+            break;
+
         case 'x':
         case 'X':
         case '\x1b': /* Esc */
@@ -1046,7 +1269,9 @@ static void colorPrintLn(void) {
         }
         fputs(B_DFLT "\n", stdout);
     }
-    else if (QSPY_output.type == INF_OUT) {
+    else if ((QSPY_output.type == INF_OUT)
+             || (QSPY_output.type == STAT_OUT))
+    {
         fputs(l_colorPalette[PALETTE_INF_OUT], stdout);
         fputs(&QSPY_output.buf[QS_LINE_OFFSET], stdout);
         fputs(B_DFLT_EOL "\n", stdout);
@@ -23,7 +23,7 @@
 * <info@state-machine.com>
 ============================================================================*/
 /*!
-* @date Last updated on: 2021-12-23
+* @date Last updated on: 2022-08-12
 * @version Last updated for version: 7.0.0
 *
 * @file
@@ -38,17 +38,80 @@
 #include "pal.h"      /* QSPY PAL */
 
 enum {
-    SEQ_ITEMS_MAX = 10,  /* max number of items in the Sequence list */
+    /* NOTE: every lane name takes at least 2 chars in the list ("a,b,c") */
+    SEQ_HASH_BITS    = 12,
+    SEQ_HASH_SIZE    = (1 << SEQ_HASH_BITS), /* key-to-lane hash size */
+    SEQ_HASH_LOAD    = (SEQ_HASH_SIZE * 3) / 4, /* max # keys in the hash */
+    SEQ_ITEMS_MAX    = QS_SEQ_LIST_LEN_MAX / 2, /* max # items (lanes) */
 };
 
+enum {
+    SEQ_LANE_WIDTH   = 20,
+    SEQ_LEFT_OFFSET  = 19,  /* offset to the middle of the first lane */
+    SEQ_BOX_WIDTH    = SEQ_LANE_WIDTH - 3,
+    SEQ_LABEL_MAX    = SEQ_LANE_WIDTH - 5,
+    SEQ_HEADER_EVERY = 100, /* # lines between repeated headers */
+    SEQ_LINE_MAX     = SEQ_LEFT_OFFSET + SEQ_LABEL_MAX
+                       + SEQ_LANE_WIDTH*SEQ_ITEMS_MAX,
+    SEQ_BUF_SIZE     = 4 * SEQ_LINE_MAX, /* output batch buffer [chars] */
+};
+
+/* kinds of the sequence items (PlantUML/Mermaid output) */
+enum {
+    SEQ_POST,
+    SEQ_POST_ATTEMPT,
+    SEQ_POST_LIFO,
+    SEQ_PUBLISH,
+    SEQ_TRAN,
+    SEQ_ANNOTATION,
+    SEQ_TICK,
+};
+
+/* key-to-lane hash entry (open addressing, linear probing) */
+typedef struct {
+    KeyType key;
+    int     lane; /* lane index or -1 for an empty entry */
+} SeqKey;
+
+/* pending sequence item, which can be repeated many times */
+typedef struct {
+    uint32_t count;  /* # repetitions of the item (0 for no item) */
+    uint32_t tFirst; /* timestamp of the first repetition */
+    uint32_t tLast;  /* timestamp of the last repetition */
+    int      kind;
+    int      src;
+    int      dst;
+    char     label[QS_DNAME_LEN_MAX];
+} SeqItem;
+
 static FILE*       l_seqFile;
+static QSeqFormat  l_seqFormat = QSEQ_ASCII;
 static char        l_seqList[QS_SEQ_LIST_LEN_MAX];
-static char        l_seqNames[SEQ_ITEMS_MAX][QS_DNAME_LEN_MAX];
+static char        l_seqTokens[QS_SEQ_LIST_LEN_MAX]; /* l_seqNames[] sto */
+static char const *l_seqNames[SEQ_ITEMS_MAX];
 static int         l_seqNum;
 static int         l_seqLines;
 static int         l_seqSystem;
-static DictEntry   l_seqSto[SEQ_ITEMS_MAX];
-static Dictionary  l_seqDict;
+static SeqKey      l_seqHash[SEQ_HASH_SIZE];
+static int         l_seqKeys;
+static SeqItem     l_seqItem;
+static char        l_seqBuf[SEQ_BUF_SIZE];
+static uint32_t    l_seqBufLen;
+
+static char const * const l_seqExt[] = {
+    "seq",  /* QSEQ_ASCII */
+    "puml", /* QSEQ_PLANTUML */
+    "mmd"   /* QSEQ_MERMAID */
+};
+
+static uint32_t QSEQ_hash(KeyType key);
+static void     QSEQ_flush(void);
+static char    *QSEQ_lineBegin(void);
+static void     QSEQ_lineEnd(uint32_t len);
+static void     QSEQ_genTrailer(void);
+static void     QSEQ_putItem(int kind, uint32_t tstamp, int src, int dst,
+                             char const *label);
+static void     QSEQ_genItem(void);
 
 /*..........................................................................*/
 char const *my_strtok(char *str, char delim) {
@@ -82,22 +145,24 @@ void QSEQ_config(void* seqFile, const char* seqList) {
     l_seqFile   = (FILE *)seqFile;
     l_seqNum    = 0;
     l_seqSystem = -1;
+    l_seqItem.count = 0U;
+    l_seqBufLen = 0U;
     if ((seqList != (void*)0) && (*seqList != '\0')) {
         STRNCPY_S(l_seqList, sizeof(l_seqList), seqList);
 
-        /* split the comma-separated 'seqList' into string array l_seqNames[] */
-        char seqTokens[QS_SEQ_LIST_LEN_MAX]; /* local mutable copy */
-        STRNCPY_S(seqTokens, sizeof(seqTokens), l_seqList);
+        /* split the comma-separated 'seqList' into string array l_seqNames[]
+        * NOTE: the names point into the mutable copy l_seqTokens[]
+        */
+        STRNCPY_S(l_seqTokens, sizeof(l_seqTokens), l_seqList);
         char const *token;
-        for (token = my_strtok(seqTokens, ',');
+        for (token = my_strtok(l_seqTokens, ',');
              (token != (char*)0) && (l_seqNum < SEQ_ITEMS_MAX);
              token = my_strtok((char *)0, ','), ++l_seqNum)
         {
             if (strncmp(token, "?", 2) == 0) { /* system border? */
                 l_seqSystem = l_seqNum;
             }
-            STRNCPY_S(l_seqNames[l_seqNum], sizeof(l_seqNames[l_seqNum]),
-                     token);
+            l_seqNames[l_seqNum] = token;
         }
         if (token != (char*)0) {
             SNPRINTF_LINE("   <QSPY-> Too many names in the Sequence list\n"
@@ -110,22 +175,13 @@ void QSEQ_config(void* seqFile, const char* seqList) {
         }
     }
 
-    Dictionary_ctor(&l_seqDict, l_seqSto,
-        sizeof(l_seqSto) / sizeof(l_seqSto[0]));
-    Dictionary_config(&l_seqDict, QSPY_conf.objPtrSize);
+    QSEQ_dictionaryReset();
 }
-
-enum {
-    SEQ_LANE_WIDTH   = 20,
-    SEQ_LEFT_OFFSET  = 19,  /* offset to the middle of the first lane */
-    SEQ_BOX_WIDTH    = SEQ_LANE_WIDTH - 3,
-    SEQ_LABEL_MAX    = SEQ_LANE_WIDTH - 5,
-    SEQ_HEADER_EVERY = 100, /* # lines between repeated headers */
-};
-
 /*..........................................................................*/
 void QSEQ_configFile(void* seqFile) {
     if (l_seqFile != (FILE*)0) {
+        QSEQ_genTrailer();
+        QSEQ_flush();
         fclose(l_seqFile);
     }
     l_seqFile = (FILE*)seqFile;
@@ -133,114 +189,336 @@ void QSEQ_configFile(void* seqFile) {
     QSEQ_genHeader();
 }
 /*..........................................................................*/
+bool QSEQ_configFormat(char const *ext) {
+    int n;
+    for (n = 0; n < (int)(sizeof(l_seqExt)/sizeof(l_seqExt[0])); ++n) {
+        if (strncmp(ext, l_seqExt[n], 8) == 0) {
+            l_seqFormat = (QSeqFormat)n;
+            return true;
+        }
+    }
+    return false;
+}
+/*..........................................................................*/
+char const *QSEQ_fileExt(void) {
+    return l_seqExt[l_seqFormat];
+}
+/*..........................................................................*/
 bool QSEQ_isActive(void) {
     return l_seqFile != (FILE*)0;
 }
 /*..........................................................................*/
 void QSEQ_dictionaryReset(void) {
-    Dictionary_reset(&l_seqDict);
+    int n;
+    for (n = 0; n < SEQ_HASH_SIZE; ++n) {
+        l_seqHash[n].lane = -1;
+    }
+    l_seqKeys = 0;
+}
+/*..........................................................................*/
+static uint32_t QSEQ_hash(KeyType key) {
+    /* Fibonacci hashing of the (pointer) key */
+    return (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> (64 - SEQ_HASH_BITS));
 }
 /*..........................................................................*/
 void QSEQ_updateDictionary(char const* name, KeyType key) {
     int n;
     for (n = 0; n < l_seqNum; ++n) { /* brute-force search */
         if (strncmp(l_seqNames[n], name, QS_DNAME_LEN_MAX) == 0) {
-            char str[2];
-            str[0] = (char)n;
-            str[1] = '\0';
-            Dictionary_put(&l_seqDict, key, str);
+            uint32_t h = QSEQ_hash(key);
+            while ((l_seqHash[h].lane >= 0) && (l_seqHash[h].key != key)) {
+                h = (h + 1U) & (SEQ_HASH_SIZE - 1U);
+            }
+            if (l_seqHash[h].lane < 0) { /* new key? */
+                if (l_seqKeys >= SEQ_HASH_LOAD) {
+                    SNPRINTF_LINE("   <QSPY-> Too many objects "
+                                  "in the Sequence diagram %s", name);
+                    QSPY_printError();
+                    break;
+                }
+                ++l_seqKeys;
+                l_seqHash[h].key = key;
+            }
+            l_seqHash[h].lane = n;
             break;
         }
     }
 }
 /*..........................................................................*/
 int QSEQ_find(KeyType key) {
-    int idx = Dictionary_find(&l_seqDict, key);
-    if (idx >= 0) {
-        char const *str = Dictionary_at(&l_seqDict, idx);
-        return (int)str[0];
+    uint32_t h = QSEQ_hash(key);
+    while (l_seqHash[h].lane >= 0) {
+        if (l_seqHash[h].key == key) {
+            return l_seqHash[h].lane;
+        }
+        h = (h + 1U) & (SEQ_HASH_SIZE - 1U);
     }
     return -1;
 }
+
+/*==========================================================================*/
+/* batched output... */
+static void QSEQ_flush(void) {
+    if ((l_seqBufLen > 0U) && (l_seqFile != (FILE*)0)) {
+        fwrite(l_seqBuf, 1, l_seqBufLen, l_seqFile);
+    }
+    l_seqBufLen = 0U;
+}
+/*..........................................................................*/
+/* returns room for one line of up to SEQ_LINE_MAX chars in the batch */
+static char *QSEQ_lineBegin(void) {
+    if (l_seqBufLen + SEQ_LINE_MAX > sizeof(l_seqBuf)) {
+        QSEQ_flush();
+    }
+    return &l_seqBuf[l_seqBufLen];
+}
 /*..........................................................................*/
+static void QSEQ_lineEnd(uint32_t len) {
+    Q_ASSERT(len <= SEQ_LINE_MAX);
+    l_seqBufLen += len;
+}
+
+/*==========================================================================*/
 void QSEQ_genHeader(void) {
     if ((l_seqNum == 0) || (l_seqFile == (FILE*)0)) {
         return;
     }
-    static char seq_header[(SEQ_LEFT_OFFSET
-                            + SEQ_LANE_WIDTH*SEQ_ITEMS_MAX + 4) * 3];
-    static uint32_t seq_header_len = 0;
-    if (seq_header_len == 0) { /* not initialized yet? */
-        int n;
-        int i = 0;
-        int left_box_edge;
-        char *seq_line = &seq_header[0];
-
-        /* clear the whole header */
-        for (i = 0; (unsigned)i < sizeof(seq_header); ++i) {
-            seq_header[i] = ' ';
-        }
-
-        /* top box edges... */
-        left_box_edge = SEQ_LEFT_OFFSET - SEQ_BOX_WIDTH/2;
-        for (n = 0; n < l_seqNum; ++n, left_box_edge += SEQ_LANE_WIDTH) {
-            i = left_box_edge;
-            seq_line[i] = '+';
-            for (i += 1; i < left_box_edge - 1 + SEQ_BOX_WIDTH; ++i) {
-                seq_line[i] = '-';
+    if (l_seqFormat != QSEQ_ASCII) { /* PlantUML/Mermaid? */
+        if (l_seqLines == 0) { /* header only once at the top */
+            char *seq_line = QSEQ_lineBegin();
+            int n;
+            if (l_seqFormat == QSEQ_PLANTUML) {
+                QSEQ_lineEnd(SNPRINTF_S(seq_line, SEQ_LINE_MAX,
+                    "@startuml\n' -g %s\nhide footbox\n", l_seqList));
             }
-            seq_line[i - SEQ_BOX_WIDTH / 2] = '+';
-            seq_line[i] = '+'; i += 1;
-        }
-        seq_line[i] = '\n';
-        seq_line = &seq_line[i + 1];
-
-        /* box content... */
-        left_box_edge = SEQ_LEFT_OFFSET - SEQ_BOX_WIDTH/2;
-        for (n = 0; n < l_seqNum; ++n, left_box_edge += SEQ_LANE_WIDTH) {
-            seq_line[left_box_edge] = '|';
-
-            /* write the name */
-            char const *name = l_seqNames[n];
-            int len = strlen(name);
-            i = left_box_edge + 1;
-            if (len < SEQ_BOX_WIDTH - 2) {
-                i += (SEQ_BOX_WIDTH - 2 - len)/2; /* center the name */
+            else {
+                QSEQ_lineEnd(SNPRINTF_S(seq_line, SEQ_LINE_MAX,
+                    "sequenceDiagram\n%%%% -g %s\n", l_seqList));
             }
-            for (; (*name != '\0')
-                    && (i < left_box_edge + SEQ_BOX_WIDTH - 1);
-                    ++name, ++i)
-            {
-                seq_line[i] = *name;
+            for (n = 0; n < l_seqNum; ++n) {
+                seq_line = QSEQ_lineBegin();
+                if (l_seqFormat == QSEQ_PLANTUML) {
+                    QSEQ_lineEnd(SNPRINTF_S(seq_line, SEQ_LINE_MAX,
+                        "%s \"%s\" as L%d\n",
+                        (n == l_seqSystem) ? "boundary" : "participant",
+                        l_seqNames[n], n));
+                }
+                else {
+                    QSEQ_lineEnd(SNPRINTF_S(seq_line, SEQ_LINE_MAX,
+                        "participant L%d as %s\n", n, l_seqNames[n]));
+                }
             }
+            l_seqLines += 1;
+        }
+        return;
+    }
 
-            i = left_box_edge - 1 + SEQ_BOX_WIDTH;
-            seq_line[i] = '|'; i += 1;
+    int n;
+    int i = 0;
+    int left_box_edge;
+    char *seq_line;
+
+    if (l_seqLines == 0) {
+        seq_line = QSEQ_lineBegin();
+        QSEQ_lineEnd(SNPRINTF_S(seq_line, SEQ_LINE_MAX,
+                                "-g %s\n\n", l_seqList));
+    }
+
+    /* top box edges... */
+    seq_line = QSEQ_lineBegin();
+    memset(seq_line, ' ', SEQ_LINE_MAX);
+    left_box_edge = SEQ_LEFT_OFFSET - SEQ_BOX_WIDTH/2;
+    for (n = 0; n < l_seqNum; ++n, left_box_edge += SEQ_LANE_WIDTH) {
+        i = left_box_edge;
+        seq_line[i] = '+';
+        for (i += 1; i < left_box_edge - 1 + SEQ_BOX_WIDTH; ++i) {
+            seq_line[i] = '-';
         }
-        seq_line[i] = '\n';
-        seq_line = &seq_line[i + 1];
-
-        /* bottom box edges... */
-        left_box_edge = SEQ_LEFT_OFFSET - SEQ_BOX_WIDTH/2;
-        for (n = 0; n < l_seqNum; ++n, left_box_edge += SEQ_LANE_WIDTH) {
-            i = left_box_edge;
-            seq_line[i] = '+';
-            for (i += 1; i < left_box_edge - 1 + SEQ_BOX_WIDTH; ++i) {
-                seq_line[i] = '-';
-            }
-            seq_line[i - SEQ_BOX_WIDTH/2] = '+';
-            seq_line[i] = '+'; i += 1;
+        seq_line[i - SEQ_BOX_WIDTH / 2] = '+';
+        seq_line[i] = '+'; i += 1;
+    }
+    seq_line[i] = '\n';
+    QSEQ_lineEnd(i + 1);
+
+    /* box content... */
+    seq_line = QSEQ_lineBegin();
+    memset(seq_line, ' ', SEQ_LINE_MAX);
+    left_box_edge = SEQ_LEFT_OFFSET - SEQ_BOX_WIDTH/2;
+    for (n = 0; n < l_seqNum; ++n, left_box_edge += SEQ_LANE_WIDTH) {
+        seq_line[left_box_edge] = '|';
+
+        /* write the name */
+        char const *name = l_seqNames[n];
+        int len = strlen(name);
+        i = left_box_edge + 1;
+        if (len < SEQ_BOX_WIDTH - 2) {
+            i += (SEQ_BOX_WIDTH - 2 - len)/2; /* center the name */
         }
-        seq_line[i] = '\n';
-        seq_header_len = &seq_line[i + 1] - &seq_header[0];
+        for (; (*name != '\0')
+                && (i < left_box_edge + SEQ_BOX_WIDTH - 1);
+                ++name, ++i)
+        {
+            seq_line[i] = *name;
+        }
+
+        i = left_box_edge - 1 + SEQ_BOX_WIDTH;
+        seq_line[i] = '|'; i += 1;
     }
-    if (l_seqLines == 0) {
-        FPRINTF_S(l_seqFile, "-g %s\n\n", l_seqList);
+    seq_line[i] = '\n';
+    QSEQ_lineEnd(i + 1);
+
+    /* bottom box edges... */
+    seq_line = QSEQ_lineBegin();
+    memset(seq_line, ' ', SEQ_LINE_MAX);
+    left_box_edge = SEQ_LEFT_OFFSET - SEQ_BOX_WIDTH/2;
+    for (n = 0; n < l_seqNum; ++n, left_box_edge += SEQ_LANE_WIDTH) {
+        i = left_box_edge;
+        seq_line[i] = '+';
+        for (i += 1; i < left_box_edge - 1 + SEQ_BOX_WIDTH; ++i) {
+            seq_line[i] = '-';
+        }
+        seq_line[i - SEQ_BOX_WIDTH/2] = '+';
+        seq_line[i] = '+'; i += 1;
     }
-    fwrite(seq_header, 1, seq_header_len, l_seqFile);
+    seq_line[i] = '\n';
+    QSEQ_lineEnd(i + 1);
     l_seqLines += 3;
 }
 /*..........................................................................*/
+static void QSEQ_genTrailer(void) {
+    if ((l_seqNum == 0) || (l_seqFile == (FILE*)0)) {
+        return;
+    }
+    if (l_seqFormat != QSEQ_ASCII) {
+        QSEQ_genItem(); /* the last pending item */
+        l_seqItem.count = 0U;
+        if (l_seqFormat == QSEQ_PLANTUML) {
+            char *seq_line = QSEQ_lineBegin();
+            QSEQ_lineEnd(SNPRINTF_S(seq_line, SEQ_LINE_MAX, "@enduml\n"));
+        }
+    }
+}
+
+/*==========================================================================*/
+/* PlantUML/Mermaid output...
+* NOTE: identical consecutive items are not written out immediately,
+* but are counted in l_seqItem and then collapsed into a single loop.
+*/
+static void QSEQ_putItem(int kind, uint32_t tstamp, int src, int dst,
+                         char const *label)
+{
+    SeqItem * const me = &l_seqItem;
+    if ((me->count > 0U)
+        && (me->kind == kind)
+        && (me->src == src)
+        && (me->dst == dst)
+        && (strncmp(me->label, label, sizeof(me->label)) == 0))
+    {
+        ++me->count;
+        me->tLast = tstamp;
+        return;
+    }
+    QSEQ_genItem(); /* the previous pending item (if any) */
+    me->count  = 1U;
+    me->tFirst = tstamp;
+    me->tLast  = tstamp;
+    me->kind   = kind;
+    me->src    = src;
+    me->dst    = dst;
+    STRNCPY_S(me->label, sizeof(me->label), label);
+}
+/*..........................................................................*/
+static void QSEQ_genItem(void) {
+    SeqItem const * const me = &l_seqItem;
+    bool const isPUML = (l_seqFormat == QSEQ_PLANTUML);
+    char *seq_line;
+    char const *indent = "";
+
+    if (me->count == 0U) { /* no pending item? */
+        return;
+    }
+
+    if (me->kind == SEQ_TICK) { /* consecutive ticks collapse to one line */
+        seq_line = QSEQ_lineBegin();
+        if (me->count == 1U) {
+            QSEQ_lineEnd(isPUML
+                ? SNPRINTF_S(seq_line, SEQ_LINE_MAX,
+                      "== Tick[%d] Ctr=%010u ==\n",
+                      me->src, (unsigned)me->tFirst)
+                : SNPRINTF_S(seq_line, SEQ_LINE_MAX,
+                      "Note over L0,L%d: Tick[%d] Ctr=%010u\n",
+                      l_seqNum - 1, me->src, (unsigned)me->tFirst));
+        }
+        else {
+            QSEQ_lineEnd(isPUML
+                ? SNPRINTF_S(seq_line, SEQ_LINE_MAX,
+                      "== Tick[%d] Ctr=%010u..%010u ==\n",
+                      me->src, (unsigned)me->tFirst, (unsigned)me->tLast)
+                : SNPRINTF_S(seq_line, SEQ_LINE_MAX,
+                      "Note over L0,L%d: Tick[%d] Ctr=%010u..%010u\n",
+                      l_seqNum - 1, me->src,
+                      (unsigned)me->tFirst, (unsigned)me->tLast));
+        }
+        return;
+    }
+
+    if (me->count > 1U) {
+        seq_line = QSEQ_lineBegin();
+        QSEQ_lineEnd(SNPRINTF_S(seq_line, SEQ_LINE_MAX,
+                     "loop %u times (t=%010u..%010u)\n",
+                     (unsigned)me->count,
+                     (unsigned)me->tFirst, (unsigned)me->tLast));
+        indent = "    ";
+    }
+
+    seq_line = QSEQ_lineBegin();
+    switch (me->kind) {
+        case SEQ_POST:
+        case SEQ_POST_ATTEMPT:
+            QSEQ_lineEnd(SNPRINTF_S(seq_line, SEQ_LINE_MAX,
+                isPUML ? "%sL%d %s L%d : %s\n" : "%sL%d%sL%d: %s\n",
+                indent, me->src,
+                (me->kind == SEQ_POST)
+                    ? (isPUML ? "->" : "->>")
+                    : (isPUML ? "-->" : "-->>"),
+                me->dst, me->label));
+            break;
+        case SEQ_POST_LIFO:
+            QSEQ_lineEnd(SNPRINTF_S(seq_line, SEQ_LINE_MAX,
+                isPUML ? "%sL%d -> L%d : %s [LIFO]\n"
+                       : "%sL%d->>L%d: %s [LIFO]\n",
+                indent, me->src, me->src, me->label));
+            break;
+        case SEQ_PUBLISH:
+            QSEQ_lineEnd(SNPRINTF_S(seq_line, SEQ_LINE_MAX,
+                isPUML ? "%shnote over L%d : publish %s\n"
+                       : "%sNote over L%d: publish %s\n",
+                indent, me->src, me->label));
+            break;
+        case SEQ_TRAN:
+            QSEQ_lineEnd(SNPRINTF_S(seq_line, SEQ_LINE_MAX,
+                isPUML ? "%srnote over L%d : %s\n"
+                       : "%sNote over L%d: %s\n",
+                indent, me->src, me->label));
+            break;
+        case SEQ_ANNOTATION:
+            QSEQ_lineEnd(SNPRINTF_S(seq_line, SEQ_LINE_MAX,
+                isPUML ? "%snote right of L%d : %s\n"
+                       : "%sNote right of L%d: %s\n",
+                indent, me->src, me->label));
+            break;
+        default:
+            Q_ASSERT(0);
+            break;
+    }
+
+    if (me->count > 1U) {
+        seq_line = QSEQ_lineBegin();
+        QSEQ_lineEnd(SNPRINTF_S(seq_line, SEQ_LINE_MAX, "end\n"));
+    }
+}
+
+/*==========================================================================*/
 void QSEQ_genPost(uint32_t tstamp, int src, int dst, char const* sig,
                        bool isAttempt)
 {
@@ -259,16 +537,20 @@ void QSEQ_genPost(uint32_t tstamp, int src, int dst, char const* sig,
     if ((src == l_seqSystem) && (dst == l_seqSystem)) {
         return;
     }
+    if (l_seqFormat != QSEQ_ASCII) {
+        QSEQ_putItem(isAttempt ? SEQ_POST_ATTEMPT : SEQ_POST,
+                     tstamp, src, dst, sig);
+        return;
+    }
     if ((l_seqLines % SEQ_HEADER_EVERY) == 0) {
         QSEQ_genHeader();
     }
-    char seq_line[SEQ_LEFT_OFFSET+ SEQ_LABEL_MAX
-                    + SEQ_LANE_WIDTH*SEQ_ITEMS_MAX];
+    char *seq_line = QSEQ_lineBegin();
     uint32_t seq_line_len;
     int i = 0;
     int j;
 
-    SNPRINTF_S(&seq_line[i], sizeof(seq_line), "%010u", (unsigned)tstamp);
+    SNPRINTF_S(&seq_line[i], SEQ_LINE_MAX, "%010u", (unsigned)tstamp);
     i += 10;
     for (; i < SEQ_LEFT_OFFSET + (l_seqNum - 1)*SEQ_LANE_WIDTH; ++i) {
         seq_line[i] = ((i - SEQ_LEFT_OFFSET)%SEQ_LANE_WIDTH) == 0
@@ -341,8 +623,7 @@ void QSEQ_genPost(uint32_t tstamp, int src, int dst, char const* sig,
         seq_line[SEQ_LEFT_OFFSET + l_seqSystem*SEQ_LANE_WIDTH] = '/';
     }
     seq_line[SEQ_LEFT_OFFSET + src*SEQ_LANE_WIDTH] = isAttempt ? 'A' : '*';
-    Q_ASSERT(seq_line_len <= sizeof(seq_line));
-    fwrite(seq_line, 1, seq_line_len, l_seqFile);
+    QSEQ_lineEnd(seq_line_len);
     l_seqLines += 1;
 }
 /*..........................................................................*/
@@ -350,16 +631,19 @@ void QSEQ_genPostLIFO(uint32_t tstamp, int src, char const* sig) {
     if ((l_seqNum == 0) || (l_seqFile == (FILE*)0)) {
         return;
     }
+    if (l_seqFormat != QSEQ_ASCII) {
+        QSEQ_putItem(SEQ_POST_LIFO, tstamp, src, src, sig);
+        return;
+    }
     if ((l_seqLines % SEQ_HEADER_EVERY) == 0) {
         QSEQ_genHeader();
     }
-    char seq_line[SEQ_LEFT_OFFSET + SEQ_LABEL_MAX
-                  + SEQ_LANE_WIDTH*SEQ_ITEMS_MAX];
+    char *seq_line = QSEQ_lineBegin();
     uint32_t seq_line_len;
     int i = 0;
     int j;
 
-    SNPRINTF_S(&seq_line[i], sizeof(seq_line), "%010u", (unsigned)tstamp);
+    SNPRINTF_S(&seq_line[i], SEQ_LINE_MAX, "%010u", (unsigned)tstamp);
     i += 10;
     for (; i < SEQ_LEFT_OFFSET + (l_seqNum - 1)*SEQ_LANE_WIDTH; ++i) {
         seq_line[i] = ((i - SEQ_LEFT_OFFSET) % SEQ_LANE_WIDTH) == 0
@@ -389,8 +673,7 @@ void QSEQ_genPostLIFO(uint32_t tstamp, int src, char const* sig) {
         seq_line[SEQ_LEFT_OFFSET + l_seqSystem*SEQ_LANE_WIDTH] = '/';
     }
     seq_line[SEQ_LEFT_OFFSET + src * SEQ_LANE_WIDTH] = '*';
-    Q_ASSERT(seq_line_len <= sizeof(seq_line));
-    fwrite(seq_line, 1, seq_line_len, l_seqFile);
+    QSEQ_lineEnd(seq_line_len);
     l_seqLines += 1;
 }
 /*..........................................................................*/
@@ -404,16 +687,19 @@ void QSEQ_genPublish(uint32_t tstamp, int obj, char const* sig) {
     if (obj < 0) {
         return;
     }
+    if (l_seqFormat != QSEQ_ASCII) {
+        QSEQ_putItem(SEQ_PUBLISH, tstamp, obj, obj, sig);
+        return;
+    }
     if ((l_seqLines % SEQ_HEADER_EVERY) == 0) {
         QSEQ_genHeader();
     }
-    char seq_line[SEQ_LEFT_OFFSET + SEQ_LABEL_MAX
-        + SEQ_LANE_WIDTH * SEQ_ITEMS_MAX];
+    char *seq_line = QSEQ_lineBegin();
     uint32_t seq_line_len;
     int i = 0;
     int j;
 
-    SNPRINTF_S(&seq_line[i], sizeof(seq_line), "%010u", (unsigned)tstamp);
+    SNPRINTF_S(&seq_line[i], SEQ_LINE_MAX, "%010u", (unsigned)tstamp);
     i += 10;
     for (;
          i < SEQ_LEFT_OFFSET - SEQ_LANE_WIDTH + SEQ_BOX_WIDTH/2
@@ -450,8 +736,7 @@ void QSEQ_genPublish(uint32_t tstamp, int obj, char const* sig) {
         seq_line[SEQ_LEFT_OFFSET + l_seqSystem*SEQ_LANE_WIDTH] = '/';
     }
     seq_line[SEQ_LEFT_OFFSET + obj * SEQ_LANE_WIDTH] = '*';
-    Q_ASSERT(seq_line_len <= sizeof(seq_line));
-    fwrite(seq_line, 1, seq_line_len, l_seqFile);
+    QSEQ_lineEnd(seq_line_len);
     l_seqLines += 1;
 }
 /*..........................................................................*/
@@ -459,16 +744,19 @@ void QSEQ_genTran(uint32_t tstamp, int obj, char const* state) {
     if ((l_seqNum == 0) || (l_seqFile == (FILE*)0)) {
         return;
     }
+    if (l_seqFormat != QSEQ_ASCII) {
+        QSEQ_putItem(SEQ_TRAN, tstamp, obj, obj, state);
+        return;
+    }
     if ((l_seqLines % SEQ_HEADER_EVERY) == 0) {
         QSEQ_genHeader();
     }
-    char seq_line[SEQ_LEFT_OFFSET + SEQ_LABEL_MAX
-                  + SEQ_LANE_WIDTH*SEQ_ITEMS_MAX];
+    char *seq_line = QSEQ_lineBegin();
     uint32_t seq_line_len;
     int i = 0;
     int j;
 
-    SNPRINTF_S(&seq_line[i], sizeof(seq_line), "%010u", (unsigned)tstamp);
+    SNPRINTF_S(&seq_line[i], SEQ_LINE_MAX, "%010u", (unsigned)tstamp);
     i += 10;
     for (; i < SEQ_LEFT_OFFSET + (l_seqNum - 1)*SEQ_LANE_WIDTH; ++i) {
         seq_line[i] = ((i - SEQ_LEFT_OFFSET)% SEQ_LANE_WIDTH) == 0
@@ -498,8 +786,7 @@ void QSEQ_genTran(uint32_t tstamp, int obj, char const* state) {
     if (l_seqSystem >= 0) {
         seq_line[SEQ_LEFT_OFFSET + l_seqSystem*SEQ_LANE_WIDTH] = '/';
     }
-    Q_ASSERT(seq_line_len <= sizeof(seq_line));
-    fwrite(seq_line, 1, seq_line_len, l_seqFile);
+    QSEQ_lineEnd(seq_line_len);
     l_seqLines += 1;
 }
 /*..........................................................................*/
@@ -507,16 +794,19 @@ void QSEQ_genAnnotation(uint32_t tstamp, int obj, char const* ann) {
     if ((l_seqNum == 0) || (l_seqFile == (FILE*)0)) {
         return;
     }
+    if (l_seqFormat != QSEQ_ASCII) {
+        QSEQ_putItem(SEQ_ANNOTATION, tstamp, obj, obj, ann);
+        return;
+    }
     if ((l_seqLines % SEQ_HEADER_EVERY) == 0) {
         QSEQ_genHeader();
     }
-    char seq_line[SEQ_LEFT_OFFSET + SEQ_LABEL_MAX
-        + SEQ_LANE_WIDTH*SEQ_ITEMS_MAX];
+    char *seq_line = QSEQ_lineBegin();
     uint32_t seq_line_len;
     int i = 0;
     int j;
 
-    SNPRINTF_S(&seq_line[i], sizeof(seq_line), "%010u", (unsigned)tstamp);
+    SNPRINTF_S(&seq_line[i], SEQ_LINE_MAX, "%010u", (unsigned)tstamp);
     i += 10;
     for (; i < SEQ_LEFT_OFFSET + (l_seqNum - 1)*SEQ_LANE_WIDTH; ++i) {
         seq_line[i] = ((i - SEQ_LEFT_OFFSET)%SEQ_LANE_WIDTH) == 0
@@ -546,8 +836,7 @@ void QSEQ_genAnnotation(uint32_t tstamp, int obj, char const* ann) {
     if (l_seqSystem >= 0) {
         seq_line[SEQ_LEFT_OFFSET + l_seqSystem*SEQ_LANE_WIDTH] = '/';
     }
-    Q_ASSERT(seq_line_len <= sizeof(seq_line));
-    fwrite(seq_line, 1, seq_line_len, l_seqFile);
+    QSEQ_lineEnd(seq_line_len);
     l_seqLines += 1;
 }
 /*..........................................................................*/
@@ -555,15 +844,18 @@ void QSEQ_genTick(uint32_t rate, uint32_t nTick) {
     if ((l_seqNum == 0) || (l_seqFile == (FILE*)0)) {
         return;
     }
+    if (l_seqFormat != QSEQ_ASCII) {
+        QSEQ_putItem(SEQ_TICK, nTick, (int)rate, -1, "");
+        return;
+    }
     if ((l_seqLines % SEQ_HEADER_EVERY) == 0) {
         QSEQ_genHeader();
     }
-    char seq_line[SEQ_LEFT_OFFSET + SEQ_LABEL_MAX
-                  + SEQ_LANE_WIDTH*SEQ_ITEMS_MAX];
+    char *seq_line = QSEQ_lineBegin();
     uint32_t seq_line_len;
     int i = 0;
 
-    SNPRINTF_S(&seq_line[i], sizeof(seq_line),
+    SNPRINTF_S(&seq_line[i], SEQ_LINE_MAX,
                "##########  Tick<%1u> Ctr=%010u",
                (unsigned)rate, (unsigned)nTick);
     i += 34;
@@ -580,8 +872,6 @@ void QSEQ_genTick(uint32_t rate, uint32_t nTick) {
     }
     seq_line[i] = '\n';
     seq_line_len = i + 1;
-    Q_ASSERT(seq_line_len <= sizeof(seq_line));
-    fwrite(seq_line, 1, seq_line_len, l_seqFile);
+    QSEQ_lineEnd(seq_line_len);
     l_seqLines += 1;
 }
-
@@ -0,0 +1,2373 @@
+/*============================================================================
+* QP/C Real-Time Embedded Framework (RTEF)
+* Copyright (C) 2005 Quantum Leaps, LLC. All rights reserved.
+*
+* SPDX-License-Identifier: GPL-3.0-or-later OR LicenseRef-QL-commercial
+*
+* This software is dual-licensed under the terms of the open source GNU
+* General Public License version 3 (or any later version), or alternatively,
+* under the terms of one of the closed source Quantum Leaps commercial
+* licenses.
+*
+* The terms of the open source GNU General Public License version 3
+* can be found at: <www.gnu.org/licenses/gpl-3.0>
+*
+* The terms of the closed source Quantum Leaps commercial licenses
+* can be found at: <www.state-machine.com/licensing>
+*
+* Redistributions in source code must retain this top-level comment block.
+* Plagiarizing this software to sidestep the license obligations is illegal.
+*
+* Contact information:
+* <www.state-machine.com>
+* <info@state-machine.com>
+============================================================================*/
+/*!
+* @date Last updated on: 2022-08-12
+* @version Last updated for version: 7.0.0
+*
+* @file
+* @brief QSPY host uility: statistics and analytics of the QS data
+* @ingroup qpspy
+*
+* The statistics are collected from the QS records as they are parsed and
+* are reported on request (key 'a' or QSPY_STATS from a Front-End) and
+* when QSPY exits.
+*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "safe_std.h" /* "safe" <stdio.h> and <string.h> facilities */
+#include "qspy.h"     /* QSPY data parser */
+#include "pal.h"      /* QSPY PAL */
+
+#define Q_SPY   1       /* this is QP implementation */
+#define QP_IMPL 1       /* this is QP implementation */
+#include "qpc_qs.h"     /* QS target-resident interface */
+#include "qpc_qs_pkg.h" /* QS package-scope interface */
+
+/*==========================================================================*/
+/* index of the tracked objects
+*
+* Maps the keys (object pointers, or compositions of an object pointer and
+* a signal) to the dense indexes of the entries, which thus stay in the
+* order of the first appearance. The hash uses the open addressing with the
+* Fibonacci hashing of the key (as in QSEQ).
+*/
+typedef struct {
+    KeyType  key;
+    uint16_t idx;  /* 1 + index of the entry, 0 for an empty slot */
+} StatSlot;
+
+typedef struct {
+    StatSlot *slot; /* hash table of (1 << bits) slots */
+    uint8_t   bits;
+    uint16_t  n;    /* entries in use */
+    uint16_t  max;  /* capacity of the entries (at most 3/4 of the slots) */
+    uint32_t  over; /* records of the keys that did not fit */
+    bool      added; /* the last key looked up was added? */
+} StatIndex;
+
+static int QSTAT_index(StatIndex * const me, KeyType key);
+
+/*==========================================================================*/
+/* histograms of the durations
+*
+* The bins are logarithmic with 4 sub-bins per octave (the values below 4
+* have their own bins), so the percentiles are within 25% of the value.
+* The few worst values are kept with the numbers of their records (counted
+* from the start of QSPY) to find them in the trace.
+*/
+enum {
+    HIST_SUB_BITS = 2,
+    HIST_BINS     = (32 - HIST_SUB_BITS + 1) << HIST_SUB_BITS,
+    HIST_WORST    = 3,
+};
+
+typedef struct {
+    uint32_t bin[HIST_BINS];
+    uint32_t n;
+    uint64_t sum;
+    uint32_t worst[HIST_WORST];    /* the worst values (descending)... */
+    uint64_t worstRec[HIST_WORST]; /* ...and the numbers of their records */
+} StatHist;
+
+static void     QSTAT_histAdd(StatHist * const me, uint32_t val,
+                              uint64_t rec);
+static uint32_t QSTAT_histPct(StatHist const * const me, uint32_t pct);
+static void     QSTAT_histAppend(StatHist const * const me);
+static uint32_t QSTAT_tDiff(uint32_t t1, uint32_t t0);
+
+/*==========================================================================*/
+/* target-to-host clock model
+*
+* Every chunk of the Target data is stamped with the host monotonic time of
+* its receipt (see PAL_rxTimeUs()). The last timestamped record in the chunk
+* pairs the (unwrapped) Target time with that host time, and the pairs are
+* fitted with a line by the least squares with exponential forgetting.
+* The slope is the length of the Target time unit and the residuals above
+* the lowest one are the delays of buffering in the link.
+*/
+enum {
+    CLK_WINDOW   = 1024, /* chunks weighted in the fit (forgetting) */
+    CLK_FIT_MIN  = 8,    /* chunks in the fit before it is trusted */
+    CLK_AVG_SIZE = 64,   /* chunks in the average delay */
+};
+
+typedef struct {
+    uint64_t rxUs;     /* receive time of the current chunk [us] */
+    uint64_t tRxUs;    /* receive time of the chunk with the last tstamp */
+    uint64_t t;        /* unwrapped Target time of the last record */
+    uint32_t tRaw;     /* the last raw timestamp */
+    bool     haveT;    /* any timestamp since the reset? */
+    bool     pending;  /* timestamp in the current chunk not fitted yet? */
+    bool     chunkNew; /* no timestamp in the current chunk so far? */
+    uint64_t x0;       /* origin of the Target time in the fit */
+    uint64_t y0;       /* origin of the host time in the fit */
+    double   w;        /* sum of the weights */
+    double   mx;       /* weighted mean of the Target time [tstamp] */
+    double   my;       /* weighted mean of the host time [us] */
+    double   sxx;      /* weighted co-moments */
+    double   sxy;
+    uint32_t nFit;     /* chunks fitted */
+    double   rMin;     /* the lowest residual (the fastest delivery) [us] */
+    double   delayAvg; /* average delay above the fastest delivery [us] */
+    double   delayMax; /* maximum delay above the fastest delivery [us] */
+    double   r2;       /* mean squared residual [us^2] */
+    uint32_t resets;   /* Target resets seen */
+} ClkModel;
+
+static ClkModel l_clk;
+static uint32_t l_clkHz;  /* nominal timestamp rate [Hz], 0 unknown */
+static uint64_t l_nRec;   /* healthy records received */
+static bool     l_recT;   /* the current record has a timestamp? */
+
+static void   QSTAT_clkReset(void);
+static void   QSTAT_clkTstamp(uint32_t tstamp);
+static void   QSTAT_clkFit(void);
+static double QSTAT_clkSlope(void);
+static bool   QSTAT_clkHostUs(uint64_t t, uint64_t *pHostUs);
+static void   QSTAT_clkReport(void);
+static uint64_t QSTAT_clkSince(uint64_t * const pT0);
+
+/*==========================================================================*/
+/* event-queue depth analytics
+*
+* The queue records carry the number of free entries after the operation
+* and the low-water mark of the queue. The capacity is not reported, so it
+* is estimated as the most free entries ever seen (exact once the queue was
+* seen empty). The interval counters restart at every report, so polling
+* the reports (e.g., QSPY_STATS from a Front-End) produces a time series.
+*/
+enum {
+    QUE_HASH_BITS = 9,
+    QUE_MAX       = (1 << QUE_HASH_BITS) * 3 / 4, /* tracked queues */
+    QUE_NEAR_PCT  = 10, /* "nearly full" below this % of free entries */
+};
+
+typedef struct {
+    KeyType  obj;      /* the AO or the raw event queue */
+    uint32_t cap;      /* estimated capacity (the most free seen) */
+    uint32_t free;     /* free entries after the last operation */
+    uint32_t minFree;  /* low-water mark of the free entries */
+    uint32_t ivMin;    /* low-water mark in the current interval */
+    uint32_t posts;    /* successful posts */
+    uint32_t ivPosts;  /* successful posts in the current interval */
+    uint32_t nearFull; /* posts leaving the queue nearly full */
+    uint32_t lost;     /* failed post attempts */
+} StatQueue;
+
+static StatSlot  l_queSlot[1 << QUE_HASH_BITS];
+static StatIndex l_queIdx = { l_queSlot, QUE_HASH_BITS, 0U, QUE_MAX, 0U,
+                               false };
+static StatQueue l_que[QUE_MAX];
+static uint64_t  l_queT0; /* Target time of the interval start */
+
+static void QSTAT_queOnDecoded(QSpyDecoded const * const dec);
+static void QSTAT_queReport(void);
+
+/*==========================================================================*/
+/* memory pool utilization
+*
+* The pool records carry the free blocks after the operation and the
+* low-water mark of the pool, the capacity is estimated as for the queues.
+* The block size is not reported either, but the event sizes requested from
+* the event pools (QS_QF_NEW follows the QS_QF_MPOOL_GET of its block) give
+* its lower bound and the internal waste of the blocks.
+*/
+enum {
+    POOL_HASH_BITS = 6,
+    POOL_MAX       = (1 << POOL_HASH_BITS) * 3 / 4, /* tracked pools */
+    POOL_SIZES     = 8, /* distinct event sizes per pool in the histogram */
+};
+
+typedef struct {
+    KeyType  obj;      /* the memory pool */
+    uint32_t cap;      /* estimated capacity (the most free seen) */
+    uint32_t free;     /* free blocks after the last operation */
+    uint32_t minFree;  /* low-water mark of the free blocks */
+    uint32_t ivMin;    /* low-water mark in the current interval */
+    uint32_t ivMax;    /* the most free blocks in the current interval */
+    uint32_t gets;     /* blocks allocated */
+    uint32_t puts;     /* blocks returned */
+    uint32_t ivGets;   /* blocks allocated in the current interval */
+    uint32_t ivPuts;   /* blocks returned in the current interval */
+    uint32_t failed;   /* failed allocation attempts */
+    uint32_t size[POOL_SIZES];  /* requested event sizes... */
+    uint32_t sizeN[POOL_SIZES]; /* ...and their counts */
+    uint32_t sizeOther; /* requests of the sizes that did not fit above */
+} StatPool;
+
+static StatSlot  l_poolSlot[1 << POOL_HASH_BITS];
+static StatIndex l_poolIdx = { l_poolSlot, POOL_HASH_BITS, 0U, POOL_MAX, 0U,
+                               false };
+static StatPool  l_pool[POOL_MAX];
+static int       l_poolLast = -1; /* pool of the last get not claimed by new */
+static uint32_t  l_evtNew;        /* dynamic events allocated */
+static uint32_t  l_evtNewFailed;  /* failed dynamic event allocations */
+static uint32_t  l_evtGc;         /* dynamic events recycled */
+
+static void QSTAT_poolOnDecoded(QSpyDecoded const * const dec);
+static void QSTAT_poolReport(void);
+
+/*==========================================================================*/
+/* run-to-completion step profiler
+*
+* An RTC step starts with QS_QEP_DISPATCH and ends with the QS_QEP_TRAN,
+* QS_QEP_INTERN_TRAN or QS_QEP_IGNORED of the same object. The steps not
+* ending so are bounded by the next dispatch of the object, QS_SCHED_IDLE,
+* or the QS_SCHED_NEXT to another step. The steps preempted by the higher
+* priorities (QS_SCHED_NEXT to a higher priority) stay open and the nested
+* steps are closed by QS_SCHED_RESUME at the latest, so the durations
+* include the preemptions, as the response times do.
+*/
+enum {
+    RTC_HASH_BITS  = 10,
+    RTC_MAX        = (1 << RTC_HASH_BITS) * 3 / 4, /* tracked (AO, sig) */
+    RTC_NEST_MAX   = 64, /* nesting of the preempted steps */
+    RTC_REPORT_MAX = 32, /* the worst (AO, sig) in the report */
+};
+
+typedef struct {
+    KeyType  obj;  /* the state machine */
+    SigType  sig;  /* the dispatched signal */
+    StatHist hist; /* durations [tstamp] */
+} StatRtc;
+
+typedef struct {
+    KeyType  obj;   /* the state machine */
+    int      idx;   /* index of the (AO, sig) entry */
+    uint32_t t0;    /* timestamp of the dispatch */
+    uint64_t rec;   /* number of the dispatch record */
+    uint32_t prio;  /* priority of the step (0 for unknown) */
+} RtcStep;
+
+static StatSlot  l_rtcSlot[1 << RTC_HASH_BITS];
+static StatIndex l_rtcIdx = { l_rtcSlot, RTC_HASH_BITS, 0U, RTC_MAX, 0U,
+                              false };
+static StatRtc   l_rtc[RTC_MAX];
+static RtcStep   l_rtcStep[RTC_NEST_MAX]; /* stack of the open steps */
+static int       l_rtcTop;       /* open steps */
+static uint32_t  l_rtcPrio;      /* priority of the next step (0 unknown) */
+static bool      l_rtcPreempt;   /* the next step preempts the open one? */
+
+static void QSTAT_rtcOnDecoded(QSpyDecoded const * const dec);
+static void QSTAT_rtcClose(int top, uint32_t t1);
+static void QSTAT_rtcReport(void);
+
+/*==========================================================================*/
+/* critical-section and ISR durations
+*
+* The entries and exits are paired by their nesting levels (the entry
+* reports the level after entering, the exit before leaving, and the ISRs
+* also their priorities). The ISR durations are per priority and include
+* the nested ISRs. The durations above the outlier threshold are reported
+* right away with the records leading to them.
+*/
+enum {
+    IRQ_NEST_MAX  = 16, /* tracked nesting levels */
+    ISR_HASH_BITS = 6,
+    ISR_MAX       = (1 << ISR_HASH_BITS) * 3 / 4, /* tracked ISR priorities */
+    CTX_SIZE      = 8,  /* records in the context of the outliers */
+};
+
+typedef struct {
+    uint32_t t0;   /* timestamp of the entry */
+    uint64_t rec;  /* number of the entry record */
+    uint32_t pri;  /* priority of the ISR */
+    bool     open; /* entered and not exited yet? */
+} IrqOpen;
+
+typedef struct {
+    uint32_t pri;  /* priority of the ISR */
+    StatHist hist; /* durations [tstamp] */
+} StatIsr;
+
+typedef struct {
+    uint64_t rec;    /* number of the record */
+    uint32_t tstamp; /* timestamp of the record */
+    uint8_t  id;     /* record-ID */
+} CtxRec;
+
+static StatHist  l_crit[IRQ_NEST_MAX]; /* per nesting level (from 1) */
+static IrqOpen   l_critOpen[IRQ_NEST_MAX];
+static uint32_t  l_critUnpaired;
+static StatSlot  l_isrSlot[1 << ISR_HASH_BITS];
+static StatIndex l_isrIdx = { l_isrSlot, ISR_HASH_BITS, 0U, ISR_MAX, 0U,
+                              false };
+static StatIsr   l_isr[ISR_MAX];
+static IrqOpen   l_isrOpen[IRQ_NEST_MAX];
+static uint32_t  l_isrUnpaired;
+static uint32_t  l_outlierUs;  /* outlier threshold [us], 0 for none */
+static uint32_t  l_outliers;   /* outliers reported */
+static CtxRec    l_ctx[CTX_SIZE]; /* the last records (circular buffer) */
+static uint32_t  l_ctxHead;
+
+static void QSTAT_irqOnDecoded(QSpyDecoded const * const dec);
+static bool QSTAT_irqPair(IrqOpen * const open, QSpyDecoded const * const dec,
+                          uint32_t pri, uint32_t *pDur, uint64_t *pRec);
+static void QSTAT_irqOutlier(char const *tag, uint32_t nest, uint32_t pri,
+                             uint32_t dur, uint64_t rec);
+static void QSTAT_irqReport(void);
+
+/*==========================================================================*/
+/* event lifecycle tracker
+*
+* The QS records do not identify the event instances, only their signals,
+* pools and reference counters. Each dynamic event is therefore tracked
+* from QS_QF_NEW as an instance of its signal, and the later records are
+* attributed to the oldest live instance of the signal with the reference
+* counter reported by the record (or to the oldest one if none matches).
+* The gets from the queues prefer the instances still queued, and the
+* garbage collection, which follows the processing of the event, prefers
+* the instance taken last from a queue.
+* An instance ends with QS_QF_GC, which gives the new-to-gc latency and,
+* for the published events, the fan-out (posts of the event). The instances
+* are kept in a fixed table, where the oldest ones are dropped when full.
+*/
+enum {
+    EVT_MAX        = 4096, /* tracked live event instances */
+    EVT_HASH_BITS  = 8,
+    EVT_SIG_MAX    = (1 << EVT_HASH_BITS) * 3 / 4, /* tracked signals */
+    EVT_LEAK_MS    = 1000, /* default leak window [ms] */
+};
+
+typedef struct {
+    uint64_t tNew;    /* unwrapped Target time of the QS_QF_NEW */
+    uint64_t rec;     /* number of the QS_QF_NEW record */
+    int16_t  prev;    /* the older/newer live instance of the signal */
+    int16_t  next;
+    int16_t  older;   /* the older/newer live instance of all */
+    int16_t  newer;
+    uint16_t sig;     /* index of the signal entry */
+    uint8_t  ref;     /* the reference counter */
+    bool     pub;     /* published? */
+    uint64_t got;     /* number of the last record taking it from a queue */
+    uint8_t  queued;  /* posts not taken from the queues yet */
+    uint16_t fanout;  /* posts of the event */
+} EvtInst;
+
+typedef struct {
+    SigType  sig;
+    int16_t  oldest;  /* the oldest/newest live instance */
+    int16_t  newest;
+    uint32_t news;    /* instances allocated */
+    uint32_t gcs;     /* instances recycled */
+    uint32_t live;    /* live instances */
+    uint32_t pubs;    /* published instances recycled */
+    uint64_t fanSum;  /* fan-out of the published instances */
+    uint32_t fanMax;
+    StatHist hist;    /* new-to-gc latencies [tstamp] */
+} EvtSig;
+
+static EvtInst   l_evt[EVT_MAX];
+static int16_t   l_evtFree = -1;   /* free instances (linked by next) */
+static int16_t   l_evtOldest = -1; /* the oldest/newest live instance */
+static int16_t   l_evtNewest = -1;
+static uint32_t  l_evtUsed;        /* instances ever taken from l_evt[] */
+static uint32_t  l_evtDropped;     /* live instances dropped when full */
+static uint32_t  l_evtUnknown;     /* records of the untracked events */
+static uint32_t  l_evtMismatch;    /* records with unexpected ref counter */
+static uint32_t  l_evtLeakMs = EVT_LEAK_MS;
+static StatSlot  l_evtSlot[1 << EVT_HASH_BITS];
+static StatIndex l_evtIdx = { l_evtSlot, EVT_HASH_BITS, 0U, EVT_SIG_MAX, 0U,
+                              false };
+static EvtSig    l_evtSig[EVT_SIG_MAX];
+
+static void QSTAT_evtOnDecoded(QSpyDecoded const * const dec);
+static int  QSTAT_evtFind(QSpyDecoded const * const dec);
+static void QSTAT_evtFree(int i);
+static void QSTAT_evtReset(void);
+static void QSTAT_evtReport(void);
+
+/*==========================================================================*/
+/* per-priority CPU utilization
+*
+* The scheduler records (QS_SCHED_NEXT, QS_SCHED_IDLE, QS_SCHED_RESUME)
+* tell the running priority (0 for idle), whose Target time is integrated
+* into the windows of the given length. The report shows the shares over
+* the last 1, 10 and all the kept windows and over the whole run, and the
+* closed windows can be saved as a time series (CSV, one row per window and
+* priority). A QS_SCHED_NEXT to a higher priority than the running one
+* counts as its preemption (as in QK/QXK). The names of the priorities
+* come from the dispatches following QS_SCHED_NEXT.
+*/
+enum {
+    CPU_PRIO_MAX = 64,   /* the highest tracked priority */
+    CPU_WIN_N    = 60,   /* windows kept for the sliding shares */
+    CPU_WIN_MS   = 1000, /* default window length [ms] */
+    CPU_GAP_MAX  = 100000, /* windows filled in a gap before skipping */
+};
+
+typedef struct {
+    uint64_t busy[CPU_PRIO_MAX + 1]; /* Target time per priority [tstamp] */
+} CpuWin;
+
+static CpuWin   l_cpuWin[CPU_WIN_N]; /* the last closed windows (circular) */
+static uint32_t l_cpuWinHead;   /* the next window to close into */
+static uint32_t l_cpuWinCnt;    /* closed windows kept */
+static uint64_t l_cpuWinNo;     /* windows closed in total */
+static CpuWin   l_cpuCur;       /* the current window */
+static uint32_t l_cpuCurAct[CPU_PRIO_MAX + 1]; /* activations in it */
+static uint32_t l_cpuCurPre[CPU_PRIO_MAX + 1]; /* preemptions in it */
+static uint64_t l_cpuTot[CPU_PRIO_MAX + 1];    /* whole run [tstamp] */
+static uint32_t l_cpuAct[CPU_PRIO_MAX + 1];    /* activations */
+static uint32_t l_cpuPre[CPU_PRIO_MAX + 1];    /* times preempted */
+static KeyType  l_cpuObj[CPU_PRIO_MAX + 1];    /* AO at the priority */
+static uint32_t l_cpuPrio;      /* the running priority */
+static bool     l_cpuOn;        /* any scheduler record seen? */
+static uint64_t l_cpuT;         /* Target time accounted up to */
+static uint64_t l_cpuWinEnd;    /* end of the current window, 0 unknown */
+static uint64_t l_cpuWinTicks;  /* length of the current window [tstamp] */
+static uint32_t l_cpuWinMs = CPU_WIN_MS;
+static FILE    *l_cpuFile;      /* time series output */
+
+static void QSTAT_cpuOnDecoded(QSpyDecoded const * const dec);
+static void QSTAT_cpuAdvance(void);
+static void QSTAT_cpuAccount(uint64_t dt);
+static void QSTAT_cpuCloseWin(void);
+static void QSTAT_cpuReport(void);
+
+/*==========================================================================*/
+/* tick accuracy and time-event jitter
+*
+* QS_QF_TICK has no timestamp, so a tick is timed by the next record from
+* the tick processing (QS_QF_TIMEEVT_POST, the posts of the time events,
+* the critical sections, or the exit from the ISR). The periods between the
+* consecutively timed ticks give the tick period and its variance; a period
+* longer by more than TICK_LATE_PCT is a late tick, and half a period more
+* means missed ticks. The gaps in the tick counter are lost QS_QF_TICKs.
+*
+* A time event is expected to expire the timeout ticks after the tick of
+* arming and then every interval. Its posts give the expiry lateness in
+* ticks, and the periodic ones the jitter of the post-to-post time with
+* respect to the interval times the mean tick period.
+*/
+enum {
+    TICK_RATE_MAX  = 16, /* tracked tick rates */
+    TICK_LATE_PCT  = 10, /* tick period longer by this % is late */
+    TICK_FIT_MIN   = 8,  /* periods measured before the classification */
+    TE_HASH_BITS   = 8,
+    TE_MAX         = (1 << TE_HASH_BITS) * 3 / 4, /* tracked time events */
+    TE_REPORT_MAX  = 16, /* the worst time events in the report */
+};
+
+typedef struct {
+    uint32_t ctr;      /* the last tick counter */
+    bool     haveCtr;
+    bool     timed;    /* the last tick timed? */
+    uint64_t t;        /* unwrapped Target time of the last timed tick */
+    uint32_t tCtr;     /* its tick counter */
+    uint32_t ticks;    /* QS_QF_TICK records */
+    uint32_t lost;     /* QS_QF_TICK records missing in the counter */
+    uint32_t late;     /* late ticks */
+    uint32_t missed;   /* missed ticks */
+    uint64_t sumT;     /* Target time between the timed ticks... */
+    uint64_t sumTicks; /* ...and the ticks in it */
+    uint32_t n;        /* single-tick periods */
+    double   mean;     /* their running mean and the sum of squares */
+    double   m2;
+    StatHist hist;     /* single-tick periods [tstamp] */
+} StatTick;
+
+typedef struct {
+    KeyType  obj;      /* the time event */
+    KeyType  ao;       /* the recipient AO */
+    uint8_t  rate;     /* tick rate */
+    bool     armed;    /* the expected expiry known? */
+    uint32_t due;      /* tick counter of the expected expiry */
+    uint32_t interval; /* interval [ticks], 0 for one-shot */
+    bool     havePost; /* previous post of the periodic time event known? */
+    uint64_t tPost;    /* unwrapped Target time of the previous post */
+    uint32_t posts;
+    uint32_t lateTicks; /* expiries later than expected [ticks] */
+    int64_t  early;    /* the most negative jitter [tstamp] */
+    int64_t  lateMax;  /* the most positive jitter [tstamp] */
+    StatHist hist;     /* |jitter| of the post-to-post time [tstamp] */
+} StatTimeEvt;
+
+static StatTick    l_tick[TICK_RATE_MAX];
+static int         l_tickPend = -1; /* tick rate waiting for its timing */
+static StatSlot    l_teSlot[1 << TE_HASH_BITS];
+static StatIndex   l_teIdx = { l_teSlot, TE_HASH_BITS, 0U, TE_MAX, 0U,
+                               false };
+static StatTimeEvt l_te[TE_MAX];
+
+static int32_t QSTAT_ctrDiff(uint32_t c1, uint32_t c0);
+static void QSTAT_tickOnDecoded(QSpyDecoded const * const dec);
+static void QSTAT_tickTimed(StatTick * const tick);
+static void QSTAT_teOnDecoded(QSpyDecoded const * const dec);
+static void QSTAT_tickReport(void);
+
+/*==========================================================================*/
+/* state residency and transition frequency
+*
+* The state machines are followed in their leaf states: the last state
+* entered (QS_QEP_STATE_ENTRY) before the end of a transition (QS_QEP_TRAN
+* or the top-most QS_QEP_INIT_TRAN), or the target of the transition when
+* no entry was seen. The Target time between the ends of the transitions is
+* the residency of the left state. The transitions are counted between the
+* pairs of the leaf states (the initial ones from the initial pseudostate),
+* and the whole graph can be saved for Graphviz (DOT).
+*/
+enum {
+    SM_HASH_BITS     = 7,
+    SM_MAX           = (1 << SM_HASH_BITS) * 3 / 4, /* tracked SMs */
+    SMST_HASH_BITS   = 10,
+    SMST_MAX         = (1 << SMST_HASH_BITS) * 3 / 4, /* tracked states */
+    SMTR_HASH_BITS   = 11,
+    SMTR_MAX         = (1 << SMTR_HASH_BITS) * 3 / 4, /* tracked pairs */
+    SMST_REPORT_MAX  = 8,  /* states of every SM in the report */
+    SMTR_REPORT_MAX  = 16, /* the most frequent transitions in the report */
+    SMST_INIT        = 0xFFFF, /* the initial pseudostate */
+};
+
+typedef struct {
+    KeyType  obj;      /* the state machine */
+    int      cur;      /* index of the current leaf state, -1 unknown */
+    KeyType  next;     /* the last state entered in the transition, 0 none */
+    uint64_t t0;       /* unwrapped Target time of entering the current */
+    uint64_t time;     /* Target time in the left states */
+    uint32_t trans;    /* transitions between the leaf states */
+} StatSm;
+
+typedef struct {
+    uint16_t sm;       /* index of the state machine */
+    KeyType  state;    /* the state-handler */
+    uint64_t time;     /* Target time in the state (left visits) */
+    uint32_t visits;
+} StatSmState;
+
+typedef struct {
+    uint16_t sm;       /* index of the state machine */
+    uint16_t from;     /* index of the source state, SMST_INIT initial */
+    uint16_t to;       /* index of the target state */
+    uint32_t n;
+} StatSmTran;
+
+static StatSlot    l_smSlot[1 << SM_HASH_BITS];
+static StatIndex   l_smIdx = { l_smSlot, SM_HASH_BITS, 0U, SM_MAX, 0U,
+                               false };
+static StatSm      l_sm[SM_MAX];
+static StatSlot    l_smStSlot[1 << SMST_HASH_BITS];
+static StatIndex   l_smStIdx = { l_smStSlot, SMST_HASH_BITS, 0U, SMST_MAX,
+                                 0U, false };
+static StatSmState l_smSt[SMST_MAX];
+static StatSlot    l_smTrSlot[1 << SMTR_HASH_BITS];
+static StatIndex   l_smTrIdx = { l_smTrSlot, SMTR_HASH_BITS, 0U, SMTR_MAX,
+                                 0U, false };
+static StatSmTran  l_smTr[SMTR_MAX];
+
+static void QSTAT_smOnDecoded(QSpyDecoded const * const dec);
+static void QSTAT_smReset(void);
+static void QSTAT_smReport(void);
+
+/*..........................................................................*/
+void QSTAT_config(uint32_t tstampHz) {
+    l_clkHz = tstampHz;
+}
+/*..........................................................................*/
+void QSTAT_onRxChunk(uint64_t rxUs) {
+    if (l_clk.pending) {
+        QSTAT_clkFit(); /* the previous chunk is complete */
+    }
+    l_clk.rxUs     = rxUs;
+    l_clk.chunkNew = true;
+}
+/*..........................................................................*/
+void QSTAT_onRecord(QSpyRecord const * const qrec) {
+    uint32_t tstamp;
+
+    ++l_nRec;
+    l_recT = false;
+    if ((qrec->rec == QS_TARGET_INFO)
+        && (qrec->len > 0) && (qrec->pos[0] != 0U)) /* Target reset? */
+    {
+        QSTAT_clkReset();
+        ++l_clk.resets;
+        QSTAT_evtReset(); /* all events are gone */
+        QSTAT_smReset();  /* and the states are unknown */
+    }
+    else if (QSpyRecord_getTstamp(qrec, &tstamp)) {
+        QSTAT_clkTstamp(tstamp);
+        l_recT = true;
+    }
+}
+/*..........................................................................*/
+void QSTAT_configOutlier(uint32_t outlierUs) {
+    l_outlierUs = outlierUs;
+}
+/*..........................................................................*/
+void QSTAT_configLeak(uint32_t leakMs) {
+    l_evtLeakMs = leakMs;
+}
+/*..........................................................................*/
+void QSTAT_configCpu(uint32_t windowMs) {
+    if (windowMs != 0U) {
+        l_cpuWinMs = windowMs;
+    }
+}
+/*..........................................................................*/
+void QSTAT_configCpuFile(void *cpuFile) {
+    if (l_cpuFile != (FILE *)0) {
+        fclose(l_cpuFile);
+    }
+    l_cpuFile = (FILE *)cpuFile;
+    if (l_cpuFile != (FILE *)0) {
+        FPRINTF_S(l_cpuFile, "%s\n",
+                  "window,end_s,host_us,pri,obj,cpu_pct,activations,"
+                  "preemptions");
+    }
+}
+/*..........................................................................*/
+void QSTAT_onDecoded(QSpyDecoded const * const dec) {
+    CtxRec * const ctx = &l_ctx[l_ctxHead];
+    l_ctxHead = (l_ctxHead + 1U) % CTX_SIZE;
+    ctx->rec    = l_nRec;
+    ctx->tstamp = dec->tstamp;
+    ctx->id     = dec->rec;
+
+    if (l_tickPend >= 0) { /* tick waiting for its timing? */
+        switch (dec->rec) {
+            case QS_QF_TIMEEVT_POST:
+            case QS_QF_ACTIVE_POST:
+            case QS_QF_ACTIVE_POST_LIFO:
+            case QS_QF_ACTIVE_POST_ATTEMPT:
+            case QS_QF_CRIT_ENTRY:
+            case QS_QF_CRIT_EXIT:
+            case QS_QF_ISR_EXIT:
+                if (l_recT) {
+                    QSTAT_tickTimed(&l_tick[l_tickPend]);
+                    l_tickPend = -1;
+                }
+                break;
+            case QS_QF_TIMEEVT_AUTO_DISARM:
+                break; /* still in the tick processing */
+            default: /* the tick processing is over */
+                l_tickPend = -1;
+                break;
+        }
+    }
+
+    switch (dec->rec) {
+        case QS_QF_ACTIVE_POST:
+        case QS_QF_ACTIVE_POST_ATTEMPT:
+        case QS_QF_ACTIVE_POST_LIFO:
+        case QS_QF_ACTIVE_GET:
+        case QS_QF_ACTIVE_GET_LAST:
+        case QS_QF_EQUEUE_POST:
+        case QS_QF_EQUEUE_POST_ATTEMPT:
+        case QS_QF_EQUEUE_POST_LIFO:
+        case QS_QF_EQUEUE_GET:
+        case QS_QF_EQUEUE_GET_LAST:
+            QSTAT_queOnDecoded(dec);
+            if ((dec->num[1] != 0U) /* dynamic event posted or taken? */
+                && ((dec->rec == QS_QF_ACTIVE_POST)
+                    || (dec->rec == QS_QF_ACTIVE_POST_LIFO)
+                    || (dec->rec == QS_QF_EQUEUE_POST)
+                    || (dec->rec == QS_QF_EQUEUE_POST_LIFO)
+                    || (dec->rec == QS_QF_ACTIVE_GET)
+                    || (dec->rec == QS_QF_EQUEUE_GET)))
+            {
+                QSTAT_evtOnDecoded(dec);
+            }
+            break;
+        case QS_QF_MPOOL_GET:
+        case QS_QF_MPOOL_GET_ATTEMPT:
+        case QS_QF_MPOOL_PUT:
+        case QS_QF_NEW:
+        case QS_QF_NEW_ATTEMPT:
+        case QS_QF_GC:
+            QSTAT_poolOnDecoded(dec);
+            if ((dec->rec == QS_QF_NEW) || (dec->rec == QS_QF_GC)) {
+                QSTAT_evtOnDecoded(dec);
+            }
+            break;
+        case QS_QF_PUBLISH:
+        case QS_QF_NEW_REF:
+        case QS_QF_GC_ATTEMPT:
+            if (dec->num[1] != 0U) { /* dynamic event? */
+                QSTAT_evtOnDecoded(dec);
+            }
+            break;
+        case QS_QF_DELETE_REF: /* former QS_QF_TIMEEVT_CTR */
+            if ((QSPY_conf.version >= 620U) && (dec->num[1] != 0U)) {
+                QSTAT_evtOnDecoded(dec);
+            }
+            break;
+        case QS_QEP_TRAN:
+            QSTAT_smOnDecoded(dec);
+            QSTAT_rtcOnDecoded(dec);
+            break;
+        case QS_QEP_DISPATCH:
+        case QS_QEP_INTERN_TRAN:
+        case QS_QEP_IGNORED:
+            QSTAT_rtcOnDecoded(dec);
+            break;
+        case QS_QEP_STATE_ENTRY:
+        case QS_QEP_INIT_TRAN:
+            QSTAT_smOnDecoded(dec);
+            break;
+        case QS_SCHED_NEXT:
+        case QS_SCHED_IDLE:
+        case QS_SCHED_RESUME:
+            QSTAT_cpuOnDecoded(dec);
+            QSTAT_rtcOnDecoded(dec);
+            break;
+        case QS_QF_CRIT_ENTRY:
+        case QS_QF_CRIT_EXIT:
+        case QS_QF_ISR_ENTRY:
+        case QS_QF_ISR_EXIT:
+            QSTAT_irqOnDecoded(dec);
+            break;
+        case QS_QF_TICK:
+            QSTAT_tickOnDecoded(dec);
+            break;
+        case QS_QF_TIMEEVT_ARM:
+        case QS_QF_TIMEEVT_REARM:
+        case QS_QF_TIMEEVT_DISARM:
+        case QS_QF_TIMEEVT_AUTO_DISARM:
+        case QS_QF_TIMEEVT_POST:
+            QSTAT_teOnDecoded(dec);
+            break;
+        default:
+            break;
+    }
+}
+/*..........................................................................*/
+void QSTAT_report(void) {
+    if (l_clk.pending) {
+        QSTAT_clkFit();
+    }
+    SNPRINTF_LINE("   <STATS> Records=%" PRIu64, l_nRec);
+    QSPY_printStat();
+    QSTAT_clkReport();
+    QSTAT_queReport();
+    QSTAT_poolReport();
+    QSTAT_rtcReport();
+    QSTAT_irqReport();
+    QSTAT_evtReport();
+    QSTAT_cpuReport();
+    QSTAT_tickReport();
+    QSTAT_smReport();
+}
+/*..........................................................................*/
+double QSTAT_usPerTick(void) {
+    if (l_clkHz != 0U) {
+        return 1e6 / (double)l_clkHz;
+    }
+    return QSTAT_clkSlope();
+}
+/*..........................................................................*/
+static bool QSTAT_clkHostUs(uint64_t t, uint64_t *pHostUs) {
+    double const b = QSTAT_clkSlope();
+    if (b <= 0.0) {
+        return false; /* no model yet */
+    }
+    double const x = (double)(int64_t)(t - l_clk.x0);
+
+    /* the model line shifted to the fastest delivery */
+    double const y = l_clk.my + b*(x - l_clk.mx) + l_clk.rMin;
+    *pHostUs = l_clk.y0 + (uint64_t)((y > 0.0) ? y : 0.0);
+    return true;
+}
+
+/*..........................................................................*/
+static void QSTAT_clkReset(void) {
+    uint32_t const resets = l_clk.resets;
+    uint64_t const rxUs = l_clk.rxUs;
+    memset(&l_clk, 0, sizeof(l_clk));
+    l_clk.resets = resets;
+    l_clk.rxUs   = rxUs;
+}
+/*..........................................................................*/
+static void QSTAT_clkTstamp(uint32_t tstamp) {
+    if (!l_clk.haveT) {
+        l_clk.haveT = true;
+        l_clk.t     = tstamp;
+    }
+    else {
+        uint32_t const bits = 8U * QSPY_conf.tstampSize;
+        uint64_t diff;
+        if (bits >= 32U) {
+            diff = (uint32_t)(tstamp - l_clk.tRaw);
+        }
+        else {
+            diff = (tstamp - l_clk.tRaw) & (((uint32_t)1U << bits) - 1U);
+        }
+
+        /* the first timestamp in a chunk might be several wrap-arounds
+        * after the previous one, which only the host time can tell
+        */
+        double const b = QSTAT_clkSlope();
+        if (l_clk.chunkNew && (b > 0.0) && (l_clk.rxUs > l_clk.tRxUs))
+        {
+            double const span  = ldexp(1.0, (int)bits);
+            double const ticks = (double)(l_clk.rxUs - l_clk.tRxUs) / b;
+            if (ticks > (double)diff + span / 2.0) {
+                diff += (uint64_t)floor(((ticks - (double)diff) / span) + 0.5)
+                        << bits;
+            }
+        }
+        l_clk.t += diff;
+    }
+    l_clk.tRaw     = tstamp;
+    l_clk.tRxUs    = l_clk.rxUs;
+    l_clk.chunkNew = false;
+    l_clk.pending  = (l_clk.rxUs != 0U); /* no receive times for files */
+}
+/*..........................................................................*/
+static void QSTAT_clkFit(void) {
+    l_clk.pending = false;
+    if (l_clk.nFit == 0U) {
+        l_clk.x0 = l_clk.t;
+        l_clk.y0 = l_clk.tRxUs;
+    }
+    double const x = (double)(l_clk.t - l_clk.x0);
+    double const y = (double)(int64_t)(l_clk.tRxUs - l_clk.y0);
+
+    /* residual of the sample with respect to the current model */
+    if (l_clk.nFit >= CLK_FIT_MIN) {
+        double const r = y - (l_clk.my + QSTAT_clkSlope()*(x - l_clk.mx));
+        if (l_clk.nFit == CLK_FIT_MIN) {
+            l_clk.rMin = r;
+        }
+        else if (r < l_clk.rMin) {
+            l_clk.rMin = r;
+        }
+        else { /* let the lowest residual follow the re-fitted line */
+            l_clk.rMin += (r - l_clk.rMin) / CLK_WINDOW;
+        }
+        double const delay = r - l_clk.rMin;
+        l_clk.delayAvg += (delay - l_clk.delayAvg) / CLK_AVG_SIZE;
+        if (delay > l_clk.delayMax) {
+            l_clk.delayMax = delay;
+        }
+        l_clk.r2 += (r*r - l_clk.r2) / CLK_AVG_SIZE;
+    }
+
+    /* exponentially weighted update of the means and co-moments */
+    double const lambda = 1.0 - (1.0 / CLK_WINDOW);
+    double const dx = x - l_clk.mx;
+    double const dy = y - l_clk.my;
+    l_clk.w   = lambda*l_clk.w + 1.0;
+    l_clk.mx += dx / l_clk.w;
+    l_clk.my += dy / l_clk.w;
+    l_clk.sxx = lambda*l_clk.sxx + dx*(x - l_clk.mx);
+    l_clk.sxy = lambda*l_clk.sxy + dx*(y - l_clk.my);
+    ++l_clk.nFit;
+}
+/*..........................................................................*/
+static double QSTAT_clkSlope(void) { /* [us] per timestamp unit */
+    if ((l_clk.nFit < CLK_FIT_MIN) || (l_clk.sxx <= 0.0)) {
+        return 0.0;
+    }
+    return l_clk.sxy / l_clk.sxx;
+}
+/*..........................................................................*/
+static void QSTAT_clkReport(void) {
+    double const b = QSTAT_clkSlope();
+    if (b <= 0.0) {
+        if (l_clk.haveT) {
+            SNPRINTF_LINE("   <CLOCK> Model=%s", (l_clk.nFit == 0U)
+                          ? "NONE (no host receive times)"
+                          : "NONE (too few Target data chunks)");
+            QSPY_printStat();
+        }
+        return;
+    }
+    uint32_t const bits = 8U * QSPY_conf.tstampSize;
+    SNPRINTF_LINE("   <CLOCK> Tstamp=%.1fHz", 1e6 / b);
+    if (l_clkHz != 0U) {
+        SNPRINTF_APPEND("(Drift=%+.1fppm)",
+                        ((1e6 / b) / (double)l_clkHz - 1.0) * 1e6);
+    }
+    SNPRINTF_APPEND(",Span=%.3fs,Wraps=%" PRIu64 ",Resets=%u,Chunks=%u",
+                    b * (double)(l_clk.t - l_clk.x0) / 1e6,
+                    l_clk.t >> bits,
+                    (unsigned)l_clk.resets, (unsigned)l_clk.nFit);
+    QSPY_printStat();
+    SNPRINTF_LINE("   <CLOCK> Delay Avg=%.0fus,Max=%.0fus,Jitter=%.0fus",
+                  l_clk.delayAvg, l_clk.delayMax, sqrt(l_clk.r2));
+    QSPY_printStat();
+}
+/*..........................................................................*/
+static uint64_t QSTAT_clkSince(uint64_t * const pT0) {
+    /* Target time [tstamp] since *pT0, which then restarts at now */
+    uint64_t const t0 = (l_clk.t >= *pT0) ? *pT0 : 0U; /* reset since? */
+    *pT0 = l_clk.t;
+    return l_clk.t - t0;
+}
+
+/*..........................................................................*/
+static int QSTAT_index(StatIndex * const me, KeyType key) {
+    uint32_t const mask = ((uint32_t)1U << me->bits) - 1U;
+    uint32_t h = (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> (64 - me->bits));
+    while ((me->slot[h].idx != 0U) && (me->slot[h].key != key)) {
+        h = (h + 1U) & mask;
+    }
+    me->added = (me->slot[h].idx == 0U);
+    if (me->slot[h].idx == 0U) { /* new key? */
+        if (me->n >= me->max) {
+            ++me->over;
+            return -1;
+        }
+        me->slot[h].key = key;
+        me->slot[h].idx = ++me->n;
+    }
+    return (int)me->slot[h].idx - 1;
+}
+
+/*..........................................................................*/
+static uint32_t QSTAT_tDiff(uint32_t t1, uint32_t t0) {
+    /* Target time [tstamp] from t0 to t1 (modulo the timestamp size) */
+    uint32_t const bits = 8U * QSPY_conf.tstampSize;
+    return (bits >= 32U) ? (t1 - t0)
+                         : ((t1 - t0) & (((uint32_t)1U << bits) - 1U));
+}
+/*..........................................................................*/
+static void QSTAT_histAdd(StatHist * const me, uint32_t val, uint64_t rec) {
+    uint32_t b = val;
+    if (val >= (1U << HIST_SUB_BITS)) {
+        uint32_t e = 31U;
+        while ((val & ((uint32_t)1U << e)) == 0U) {
+            --e;
+        }
+        b = ((e - HIST_SUB_BITS + 1U) << HIST_SUB_BITS)
+            | ((val >> (e - HIST_SUB_BITS)) & ((1U << HIST_SUB_BITS) - 1U));
+    }
+    ++me->bin[b];
+    ++me->n;
+    me->sum += val;
+
+    int i;
+    for (i = HIST_WORST; (i > 0) && (me->worst[i - 1] < val); --i) {
+        if (i < HIST_WORST) {
+            me->worst[i]    = me->worst[i - 1];
+            me->worstRec[i] = me->worstRec[i - 1];
+        }
+    }
+    if (i < HIST_WORST) {
+        me->worst[i]    = val;
+        me->worstRec[i] = rec;
+    }
+}
+/*..........................................................................*/
+static uint32_t QSTAT_histPct(StatHist const * const me, uint32_t pct) {
+    /* the upper bound of the bin with the given percentile */
+    uint64_t const rank = ((uint64_t)me->n * pct + 99U) / 100U;
+    uint64_t n = 0U;
+    uint32_t b;
+    for (b = 0U; b < HIST_BINS - 1U; ++b) {
+        n += me->bin[b];
+        if ((n >= rank) && (n != 0U)) {
+            break;
+        }
+    }
+    uint32_t val = b;
+    if (b >= (1U << HIST_SUB_BITS)) {
+        uint32_t const e = (b >> HIST_SUB_BITS) + HIST_SUB_BITS - 1U;
+        uint32_t const m = b & ((1U << HIST_SUB_BITS) - 1U);
+        val = (((1U << HIST_SUB_BITS) | m) << (e - HIST_SUB_BITS))
+              + ((1U << (e - HIST_SUB_BITS)) - 1U);
+    }
+    return (val < me->worst[0]) ? val : me->worst[0];
+}
+/*..........................................................................*/
+static void QSTAT_histAppend(StatHist const * const me) {
+    /* appends the summary of the histogram to the current line */
+    double const us = QSTAT_usPerTick();
+    char const * const fmt = (us > 0.0) ? "%s=%.1fus" : "%s=%.0ft";
+    double const k = (us > 0.0) ? us : 1.0;
+
+    SNPRINTF_APPEND(",N=%u", (unsigned)me->n);
+    if (me->n == 0U) {
+        return;
+    }
+    SNPRINTF_APPEND(fmt, ",Avg", k * (double)me->sum / (double)me->n);
+    SNPRINTF_APPEND(fmt, ",P50", k * (double)QSTAT_histPct(me, 50U));
+    SNPRINTF_APPEND(fmt, ",P99", k * (double)QSTAT_histPct(me, 99U));
+    SNPRINTF_APPEND(fmt, ",Max", k * (double)me->worst[0]);
+    SNPRINTF_APPEND(",Worst@Rec=%" PRIu64, me->worstRec[0]);
+    int i;
+    for (i = 1; (i < HIST_WORST) && (i < (int)me->n); ++i) {
+        SNPRINTF_APPEND("/%" PRIu64, me->worstRec[i]);
+    }
+}
+
+/*..........................................................................*/
+static void QSTAT_queOnDecoded(QSpyDecoded const * const dec) {
+    int const i = QSTAT_index(&l_queIdx, dec->key[0]);
+    if (i < 0) {
+        return;
+    }
+    StatQueue * const que = &l_que[i];
+    if (l_queIdx.added) {
+        que->obj     = dec->key[0];
+        que->minFree = UINT32_MAX;
+        que->ivMin   = UINT32_MAX;
+    }
+
+    switch (dec->rec) {
+        case QS_QF_ACTIVE_POST_ATTEMPT:
+        case QS_QF_EQUEUE_POST_ATTEMPT:
+            ++que->lost; /* the margin could not be kept */
+            que->free = dec->num[3];
+            if (que->cap < que->free) { /* the event was not queued */
+                que->cap = que->free;
+            }
+            break;
+        case QS_QF_ACTIVE_POST:
+        case QS_QF_ACTIVE_POST_LIFO:
+        case QS_QF_EQUEUE_POST:
+        case QS_QF_EQUEUE_POST_LIFO:
+            ++que->posts;
+            ++que->ivPosts;
+            que->free = dec->num[3];
+            if (que->cap <= que->free) {
+                que->cap = que->free + 1U; /* at least the posted event */
+            }
+            if (dec->num[4] < que->minFree) { /* the Target's low-water */
+                que->minFree = dec->num[4];
+            }
+            if ((que->free <= 1U)
+                || (que->free*100U <= que->cap*(uint32_t)QUE_NEAR_PCT))
+            {
+                ++que->nearFull;
+            }
+            break;
+        case QS_QF_ACTIVE_GET_LAST:
+        case QS_QF_EQUEUE_GET_LAST:
+            que->free = que->cap; /* the queue is empty now */
+            break;
+        default: /* QS_QF_ACTIVE_GET, QS_QF_EQUEUE_GET */
+            que->free = dec->num[3];
+            if (que->cap < que->free) {
+                que->cap = que->free;
+            }
+            break;
+    }
+    if (que->free < que->minFree) {
+        que->minFree = que->free;
+    }
+    if (que->free < que->ivMin) {
+        que->ivMin = que->free;
+    }
+}
+/*..........................................................................*/
+static void QSTAT_queReport(void) {
+    double const sec = (double)QSTAT_clkSince(&l_queT0)
+                       * QSTAT_usPerTick() / 1e6;
+    uint16_t i;
+    for (i = 0U; i < l_queIdx.n; ++i) {
+        StatQueue * const que = &l_que[i];
+        uint32_t const minFree = (que->minFree < que->cap)
+                                 ? que->minFree : que->cap;
+        uint32_t const ivMin = (que->ivMin < que->cap) ? que->ivMin : que->cap;
+        SNPRINTF_LINE("   <QUEUE> Obj=%s,Depth=%u,MaxDepth=%u,Cap~%u,"
+                      "Posts=%u,NearFull=%u,Lost=%u",
+                      Dictionary_get(&QSPY_objDict, que->obj, (char *)0),
+                      (unsigned)(que->cap - que->free),
+                      (unsigned)(que->cap - minFree),
+                      (unsigned)que->cap,
+                      (unsigned)que->posts,
+                      (unsigned)que->nearFull,
+                      (unsigned)que->lost);
+        SNPRINTF_APPEND(",Last<Posts=%u", (unsigned)que->ivPosts);
+        if (sec > 0.0) {
+            SNPRINTF_APPEND("(%.1f/s)", (double)que->ivPosts / sec);
+        }
+        SNPRINTF_APPEND(",MaxDepth=%u>", (unsigned)(que->cap - ivMin));
+        QSPY_printStat();
+        que->ivPosts = 0U;
+        que->ivMin   = que->free;
+    }
+    if (l_queIdx.over != 0U) {
+        SNPRINTF_LINE("   <QUEUE> Untracked=%u (more than %u queues)",
+                      (unsigned)l_queIdx.over, (unsigned)QUE_MAX);
+        QSPY_printStat();
+    }
+}
+
+/*..........................................................................*/
+static void QSTAT_poolOnDecoded(QSpyDecoded const * const dec) {
+    switch (dec->rec) {
+        case QS_QF_NEW:
+        case QS_QF_NEW_ATTEMPT: {
+            if (dec->rec == QS_QF_NEW) {
+                ++l_evtNew;
+            }
+            else {
+                ++l_evtNewFailed;
+            }
+            if (l_poolLast < 0) {
+                return; /* the pool of the event is not known */
+            }
+            StatPool * const pool = &l_pool[l_poolLast];
+            l_poolLast = -1;
+            uint32_t const size = dec->num[0];
+            uint32_t i;
+            for (i = 0U; (i < POOL_SIZES) && (pool->sizeN[i] != 0U)
+                         && (pool->size[i] < size); ++i) {
+            }
+            if ((i < POOL_SIZES) && (pool->sizeN[i] != 0U)
+                && (pool->size[i] == size))
+            {
+                ++pool->sizeN[i];
+            }
+            else if ((i < POOL_SIZES) && (pool->sizeN[POOL_SIZES - 1U] == 0U))
+            {   /* insert the new size keeping the sizes sorted */
+                memmove(&pool->size[i + 1U], &pool->size[i],
+                        (POOL_SIZES - 1U - i) * sizeof(pool->size[0]));
+                memmove(&pool->sizeN[i + 1U], &pool->sizeN[i],
+                        (POOL_SIZES - 1U - i) * sizeof(pool->sizeN[0]));
+                pool->size[i]  = size;
+                pool->sizeN[i] = 1U;
+            }
+            else {
+                ++pool->sizeOther;
+            }
+            return;
+        }
+        case QS_QF_GC:
+            ++l_evtGc;
+            return;
+        default:
+            break;
+    }
+
+    /* QS_QF_MPOOL_GET, QS_QF_MPOOL_GET_ATTEMPT, QS_QF_MPOOL_PUT */
+    int const i = QSTAT_index(&l_poolIdx, dec->key[0]);
+    if (i < 0) {
+        return;
+    }
+    StatPool * const pool = &l_pool[i];
+    if (l_poolIdx.added) {
+        pool->obj     = dec->key[0];
+        pool->minFree = UINT32_MAX;
+        pool->ivMin   = UINT32_MAX;
+    }
+    pool->free = dec->num[1];
+    switch (dec->rec) {
+        case QS_QF_MPOOL_GET:
+            ++pool->gets;
+            ++pool->ivGets;
+            if (pool->cap <= pool->free) {
+                pool->cap = pool->free + 1U; /* at least the allocated one */
+            }
+            if (dec->num[2] < pool->minFree) { /* the Target's low-water */
+                pool->minFree = dec->num[2];
+            }
+            l_poolLast = i;
+            break;
+        case QS_QF_MPOOL_GET_ATTEMPT:
+            ++pool->failed; /* the margin could not be kept */
+            if (pool->cap < pool->free) { /* nothing was allocated */
+                pool->cap = pool->free;
+            }
+            l_poolLast = i;
+            break;
+        default: /* QS_QF_MPOOL_PUT */
+            ++pool->puts;
+            ++pool->ivPuts;
+            if (pool->cap < pool->free) {
+                pool->cap = pool->free;
+            }
+            break;
+    }
+    if (pool->free < pool->minFree) {
+        pool->minFree = pool->free;
+    }
+    if (pool->free < pool->ivMin) {
+        pool->ivMin = pool->free;
+    }
+    if (pool->free > pool->ivMax) {
+        pool->ivMax = pool->free;
+    }
+}
+/*..........................................................................*/
+static void QSTAT_poolReport(void) {
+    uint16_t i;
+    for (i = 0U; i < l_poolIdx.n; ++i) {
+        StatPool * const pool = &l_pool[i];
+        uint32_t const minFree = (pool->minFree < pool->cap)
+                                 ? pool->minFree : pool->cap;
+        uint32_t const ivMin = (pool->ivMin < pool->cap)
+                               ? pool->ivMin : pool->cap;
+        SNPRINTF_LINE("   <MPOOL> Obj=%s,InUse=%u,MaxInUse=%u,Cap~%u,"
+                      "Gets=%u,Puts=%u,Failed=%u,"
+                      "Last<Gets=%u,Puts=%u,InUse=%u..%u>",
+                      Dictionary_get(&QSPY_objDict, pool->obj, (char *)0),
+                      (unsigned)(pool->cap - pool->free),
+                      (unsigned)(pool->cap - minFree),
+                      (unsigned)pool->cap,
+                      (unsigned)pool->gets,
+                      (unsigned)pool->puts,
+                      (unsigned)pool->failed,
+                      (unsigned)pool->ivGets,
+                      (unsigned)pool->ivPuts,
+                      (unsigned)(pool->cap - pool->ivMax),
+                      (unsigned)(pool->cap - ivMin));
+        QSPY_printStat();
+        pool->ivGets = 0U;
+        pool->ivPuts = 0U;
+        pool->ivMin  = pool->free;
+        pool->ivMax  = pool->free;
+
+        if (pool->sizeN[0] != 0U) { /* event pool? */
+            uint32_t maxSize = 0U;
+            uint64_t n = 0U;
+            uint64_t sum = 0U;
+            uint32_t k;
+            SNPRINTF_LINE("   <MPOOL> Obj=%s,Sizes<",
+                      Dictionary_get(&QSPY_objDict, pool->obj, (char *)0));
+            for (k = 0U; (k < POOL_SIZES) && (pool->sizeN[k] != 0U); ++k) {
+                SNPRINTF_APPEND("%s%u:%u", (k == 0U) ? "" : ",",
+                                (unsigned)pool->size[k],
+                                (unsigned)pool->sizeN[k]);
+                if (pool->size[k] > maxSize) {
+                    maxSize = pool->size[k];
+                }
+                n   += pool->sizeN[k];
+                sum += (uint64_t)pool->size[k] * pool->sizeN[k];
+            }
+            if (pool->sizeOther != 0U) {
+                SNPRINTF_APPEND(",?:%u", (unsigned)pool->sizeOther);
+            }
+            SNPRINTF_APPEND(">,Block>=%u", (unsigned)maxSize);
+            if (maxSize != 0U) {
+                SNPRINTF_APPEND(",Waste>=%.0f%%", 100.0
+                    * (1.0 - (double)sum / ((double)n * (double)maxSize)));
+            }
+            QSPY_printStat();
+        }
+    }
+    if (l_poolIdx.over != 0U) {
+        SNPRINTF_LINE("   <MPOOL> Untracked=%u (more than %u pools)",
+                      (unsigned)l_poolIdx.over, (unsigned)POOL_MAX);
+        QSPY_printStat();
+    }
+    if ((l_evtNew != 0U) || (l_evtNewFailed != 0U)) {
+        SNPRINTF_LINE("   <MPOOL> Events New=%u,Failed=%u,Gc=%u,Live~%d",
+                      (unsigned)l_evtNew, (unsigned)l_evtNewFailed,
+                      (unsigned)l_evtGc, (int)(l_evtNew - l_evtGc));
+        QSPY_printStat();
+    }
+}
+
+/*..........................................................................*/
+static void QSTAT_rtcOnDecoded(QSpyDecoded const * const dec) {
+    int top;
+    switch (dec->rec) {
+        case QS_QEP_DISPATCH: {
+            for (top = l_rtcTop - 1; top >= 0; --top) {
+                if (l_rtcStep[top].obj == dec->key[0]) {
+                    QSTAT_rtcClose(top, dec->tstamp); /* not ended before */
+                    break;
+                }
+            }
+            if (!l_rtcPreempt) { /* run to completion of the open steps? */
+                QSTAT_rtcClose(0, dec->tstamp);
+            }
+            l_rtcPreempt = false;
+            if (l_rtcTop < RTC_NEST_MAX) {
+                int const i = QSTAT_index(&l_rtcIdx,
+                    (dec->key[0] << 16) ^ (KeyType)dec->num[0]);
+                if (i >= 0) {
+                    RtcStep * const step = &l_rtcStep[l_rtcTop++];
+                    if (l_rtcIdx.added) {
+                        l_rtc[i].obj = dec->key[0];
+                        l_rtc[i].sig = dec->num[0];
+                    }
+                    step->obj  = dec->key[0];
+                    step->idx  = i;
+                    step->t0   = dec->tstamp;
+                    step->rec  = l_nRec;
+                    step->prio = l_rtcPrio;
+                    if ((l_rtcPrio != 0U) && (l_rtcPrio <= CPU_PRIO_MAX)) {
+                        l_cpuObj[l_rtcPrio] = dec->key[0];
+                    }
+                    l_rtcPrio  = 0U;
+                }
+            }
+            break;
+        }
+        case QS_QEP_TRAN:
+        case QS_QEP_INTERN_TRAN:
+        case QS_QEP_IGNORED: {
+            for (top = l_rtcTop - 1; top >= 0; --top) {
+                if (l_rtcStep[top].obj == dec->key[0]) {
+                    QSTAT_rtcClose(top, dec->tstamp);
+                    break;
+                }
+            }
+            break;
+        }
+        case QS_SCHED_NEXT: { /* a: next priority, b: previous priority */
+            l_rtcPreempt = (l_rtcTop > 0)
+                && (l_rtcStep[l_rtcTop - 1].prio != 0U)
+                && (dec->num[0] > l_rtcStep[l_rtcTop - 1].prio);
+            if (!l_rtcPreempt) {
+                QSTAT_rtcClose(0, dec->tstamp);
+            }
+            l_rtcPrio = dec->num[0];
+            break;
+        }
+        case QS_SCHED_RESUME: { /* a: resumed priority */
+            for (top = 0; top < l_rtcTop; ++top) {
+                if (l_rtcStep[top].prio > dec->num[0]) {
+                    QSTAT_rtcClose(top, dec->tstamp);
+                    break;
+                }
+            }
+            break;
+        }
+        default: { /* QS_SCHED_IDLE */
+            QSTAT_rtcClose(0, dec->tstamp);
+            break;
+        }
+    }
+}
+/*..........................................................................*/
+static void QSTAT_rtcClose(int top, uint32_t t1) {
+    /* ends the open step at the top and all the steps nested in it */
+    while (l_rtcTop > top) {
+        RtcStep const * const step = &l_rtcStep[--l_rtcTop];
+        QSTAT_histAdd(&l_rtc[step->idx].hist, QSTAT_tDiff(t1, step->t0),
+                      step->rec);
+    }
+}
+/*..........................................................................*/
+static int QSTAT_rtcCmp(void const *p1, void const *p2) {
+    uint32_t const w1 = l_rtc[*(uint16_t const *)p1].hist.worst[0];
+    uint32_t const w2 = l_rtc[*(uint16_t const *)p2].hist.worst[0];
+    return (w1 < w2) ? 1 : ((w1 > w2) ? -1 : 0); /* descending */
+}
+/*..........................................................................*/
+static void QSTAT_rtcReport(void) {
+    static uint16_t order[RTC_MAX];
+    uint16_t i;
+    for (i = 0U; i < l_rtcIdx.n; ++i) {
+        order[i] = i;
+    }
+    qsort(order, l_rtcIdx.n, sizeof(order[0]), &QSTAT_rtcCmp);
+    for (i = 0U; (i < l_rtcIdx.n) && (i < RTC_REPORT_MAX); ++i) {
+        StatRtc const * const rtc = &l_rtc[order[i]];
+        if (rtc->hist.n == 0U) {
+            break; /* the steps of the rest have not ended yet */
+        }
+        SNPRINTF_LINE("   <RTC>   Obj=%s,Sig=%s",
+                      Dictionary_get(&QSPY_objDict, rtc->obj, (char *)0),
+                      SigDictionary_get(&QSPY_sigDict, rtc->sig, rtc->obj,
+                                        (char *)0));
+        QSTAT_histAppend(&rtc->hist);
+        QSPY_printStat();
+    }
+    if (l_rtcIdx.n > RTC_REPORT_MAX) {
+        SNPRINTF_LINE("   <RTC>   ... %u more (AO,Sig) not shown",
+                      (unsigned)(l_rtcIdx.n - RTC_REPORT_MAX));
+        QSPY_printStat();
+    }
+    if (l_rtcIdx.over != 0U) {
+        SNPRINTF_LINE("   <RTC>   Untracked=%u (more than %u (AO,Sig))",
+                      (unsigned)l_rtcIdx.over, (unsigned)RTC_MAX);
+        QSPY_printStat();
+    }
+}
+
+/*..........................................................................*/
+static void QSTAT_irqOnDecoded(QSpyDecoded const * const dec) {
+    uint32_t dur;
+    uint64_t rec;
+    switch (dec->rec) {
+        case QS_QF_CRIT_ENTRY:
+        case QS_QF_CRIT_EXIT: { /* a: nesting level */
+            if (!QSTAT_irqPair(l_critOpen, dec, 0U, &dur, &rec)) {
+                break;
+            }
+            QSTAT_histAdd(&l_crit[dec->num[0] - 1U], dur, rec);
+            QSTAT_irqOutlier("<CRIT> ", dec->num[0], 0U, dur, rec);
+            break;
+        }
+        default: { /* QS_QF_ISR_ENTRY/EXIT, a: nesting level, b: priority */
+            if (!QSTAT_irqPair(l_isrOpen, dec, dec->num[1], &dur, &rec)) {
+                break;
+            }
+            int const i = QSTAT_index(&l_isrIdx, (KeyType)dec->num[1]);
+            if (i >= 0) {
+                l_isr[i].pri = dec->num[1];
+                QSTAT_histAdd(&l_isr[i].hist, dur, rec);
+            }
+            QSTAT_irqOutlier("<ISR>  ", dec->num[0], dec->num[1], dur, rec);
+            break;
+        }
+    }
+}
+/*..........................................................................*/
+static bool QSTAT_irqPair(IrqOpen * const open, QSpyDecoded const * const dec,
+                          uint32_t pri, uint32_t *pDur, uint64_t *pRec)
+{
+    bool const isEntry = (dec->rec == QS_QF_CRIT_ENTRY)
+                         || (dec->rec == QS_QF_ISR_ENTRY);
+    uint32_t const nest = dec->num[0];
+    uint32_t * const unpaired = (open == l_critOpen)
+                                ? &l_critUnpaired : &l_isrUnpaired;
+    if ((nest == 0U) || (nest > IRQ_NEST_MAX)) {
+        ++*unpaired;
+        return false;
+    }
+    IrqOpen * const lev = &open[nest - 1U];
+    if (isEntry) {
+        uint32_t k;
+        for (k = nest; k < IRQ_NEST_MAX; ++k) { /* the exits were lost */
+            open[k].open = false;
+        }
+        if (lev->open) {
+            ++*unpaired;
+        }
+        lev->t0   = dec->tstamp;
+        lev->rec  = l_nRec;
+        lev->pri  = pri;
+        lev->open = true;
+        return false;
+    }
+    if (!lev->open || (lev->pri != pri)) {
+        ++*unpaired;
+        lev->open = false;
+        return false;
+    }
+    lev->open = false;
+    *pDur = QSTAT_tDiff(dec->tstamp, lev->t0);
+    *pRec = lev->rec;
+    return true;
+}
+/*..........................................................................*/
+static void QSTAT_irqOutlier(char const *tag, uint32_t nest, uint32_t pri,
+                             uint32_t dur, uint64_t rec)
+{
+    double const us = QSTAT_usPerTick();
+    double const val = (us > 0.0) ? (us * (double)dur) : (double)dur;
+    if ((l_outlierUs == 0U) || (val <= (double)l_outlierUs)) {
+        return;
+    }
+    ++l_outliers;
+    SNPRINTF_LINE("   %s Outlier Nest=%u", tag, (unsigned)nest);
+    if (tag[1] == 'I') {
+        SNPRINTF_APPEND(",Pri=%u", (unsigned)pri);
+    }
+    SNPRINTF_APPEND((us > 0.0) ? ",Dur=%.1fus" : ",Dur=%.0ft", val);
+    SNPRINTF_APPEND(",Rec=%" PRIu64 "..%" PRIu64, rec, l_nRec);
+    QSPY_printStat();
+
+    SNPRINTF_LINE("   %s Context", tag);
+    uint32_t i;
+    for (i = 0U; i < CTX_SIZE; ++i) {
+        CtxRec const * const ctx = &l_ctx[(l_ctxHead + i) % CTX_SIZE];
+        if (ctx->rec != 0U) {
+            SNPRINTF_APPEND(" %" PRIu64 ":%s@%010u", ctx->rec,
+                            &QSPY_rec[ctx->id].name[3], /* skip "QS_" */
+                            (unsigned)ctx->tstamp);
+        }
+    }
+    QSPY_printStat();
+}
+/*..........................................................................*/
+static void QSTAT_irqReport(void) {
+    uint32_t i;
+    for (i = 0U; i < IRQ_NEST_MAX; ++i) {
+        if (l_crit[i].n != 0U) {
+            SNPRINTF_LINE("   <CRIT>  Nest=%u", (unsigned)(i + 1U));
+            QSTAT_histAppend(&l_crit[i]);
+            QSPY_printStat();
+        }
+    }
+    for (i = 0U; i < l_isrIdx.n; ++i) {
+        SNPRINTF_LINE("   <ISR>   Pri=%u", (unsigned)l_isr[i].pri);
+        QSTAT_histAppend(&l_isr[i].hist);
+        QSPY_printStat();
+    }
+    if ((l_critUnpaired != 0U) || (l_isrUnpaired != 0U)
+        || (l_outliers != 0U))
+    {
+        SNPRINTF_LINE("   <CRIT>  Unpaired<Crit=%u,Isr=%u>,Outliers=%u",
+                      (unsigned)l_critUnpaired, (unsigned)l_isrUnpaired,
+                      (unsigned)l_outliers);
+        if (l_outlierUs != 0U) {
+            SNPRINTF_APPEND("(>%uus)", (unsigned)l_outlierUs);
+        }
+        QSPY_printStat();
+    }
+}
+
+/*..........................................................................*/
+static void QSTAT_evtOnDecoded(QSpyDecoded const * const dec) {
+    if (dec->rec == QS_QF_NEW) { /* a: event size, c: signal */
+        int const k = QSTAT_index(&l_evtIdx, (KeyType)dec->num[2]);
+        if (k < 0) {
+            return;
+        }
+        EvtSig * const es = &l_evtSig[k];
+        if (l_evtIdx.added) {
+            es->sig    = dec->num[2];
+            es->oldest = -1;
+            es->newest = -1;
+        }
+
+        int i;
+        if (l_evtFree >= 0) {
+            i = l_evtFree;
+            l_evtFree = l_evt[i].next;
+        }
+        else if (l_evtUsed < EVT_MAX) {
+            i = (int)l_evtUsed++;
+        }
+        else { /* drop the oldest live instance */
+            i = l_evtOldest;
+            QSTAT_evtFree(i);
+            ++l_evtDropped;
+            i = l_evtFree;
+            l_evtFree = l_evt[i].next;
+        }
+        EvtInst * const ev = &l_evt[i];
+        ev->tNew   = l_clk.t;
+        ev->rec    = l_nRec;
+        ev->sig    = (uint16_t)k;
+        ev->ref    = 0U;
+        ev->pub    = false;
+        ev->fanout = 0U;
+        ev->got    = 0U;
+        ev->queued = 0U;
+        ev->prev   = es->newest; /* append to the live instances */
+        ev->next   = -1;
+        if (es->newest >= 0) {
+            l_evt[es->newest].next = (int16_t)i;
+        }
+        else {
+            es->oldest = (int16_t)i;
+        }
+        es->newest = (int16_t)i;
+        ev->older  = l_evtNewest;
+        ev->newer  = -1;
+        if (l_evtNewest >= 0) {
+            l_evt[l_evtNewest].newer = (int16_t)i;
+        }
+        else {
+            l_evtOldest = (int16_t)i;
+        }
+        l_evtNewest = (int16_t)i;
+        ++es->news;
+        ++es->live;
+        return;
+    }
+
+    /* a: signal, b: pool, c: reference counter (before the change) */
+    int const i = QSTAT_evtFind(dec);
+    if (i < 0) {
+        return;
+    }
+    EvtInst * const ev = &l_evt[i];
+    switch (dec->rec) {
+        case QS_QF_PUBLISH:
+            ev->pub = true;
+            ev->ref = (uint8_t)(dec->num[2] + 1U);
+            break;
+        case QS_QF_NEW_REF:
+            ev->ref = (uint8_t)(dec->num[2] + 1U);
+            break;
+        case QS_QF_GC_ATTEMPT:
+            ev->ref = (uint8_t)(dec->num[2] - 1U);
+            break;
+        case QS_QF_DELETE_REF:
+            /* QF_deleteRef_() goes on with QF_gc(), whose QS_QF_GC_ATTEMPT
+            * or QS_QF_GC still carries this counter and takes the decrement
+            * (an unknown counter is a mismatch already here)
+            */
+            break;
+        case QS_QF_ACTIVE_GET:
+        case QS_QF_EQUEUE_GET:
+            ev->got = l_nRec;
+            if (ev->queued != 0U) {
+                --ev->queued;
+            }
+            break;
+        case QS_QF_GC: {
+            EvtSig * const es = &l_evtSig[ev->sig];
+            QSTAT_histAdd(&es->hist, (uint32_t)(l_clk.t - ev->tNew), ev->rec);
+            ++es->gcs;
+            if (ev->pub) {
+                ++es->pubs;
+                es->fanSum += ev->fanout;
+                if (ev->fanout > es->fanMax) {
+                    es->fanMax = ev->fanout;
+                }
+            }
+            QSTAT_evtFree(i);
+            break;
+        }
+        default: /* QS_QF_ACTIVE_POST..., QS_QF_EQUEUE_POST... */
+            ev->ref = (uint8_t)(dec->num[2] + 1U);
+            ++ev->fanout;
+            ++ev->queued;
+            break;
+    }
+}
+/*..........................................................................*/
+static int QSTAT_evtFind(QSpyDecoded const * const dec) {
+    /* the live instance of the signal with the reference counter: the
+    * oldest one still in a queue for the gets, the one taken last from
+    * a queue for the garbage collection (also after a deleted reference),
+    * and the oldest one otherwise
+    */
+    int const k = QSTAT_index(&l_evtIdx, (KeyType)dec->num[0]);
+    if ((k >= 0) && l_evtIdx.added) {
+        l_evtSig[k].sig    = dec->num[0];
+        l_evtSig[k].oldest = -1;
+        l_evtSig[k].newest = -1;
+    }
+    if ((k < 0) || (l_evtSig[k].oldest < 0)) {
+        ++l_evtUnknown; /* allocated before the tracking, for example */
+        return -1;
+    }
+    int found = -1;
+    uint64_t best = 0U;
+    int i;
+    for (i = l_evtSig[k].oldest; i >= 0; i = l_evt[i].next) {
+        if (l_evt[i].ref != (uint8_t)dec->num[2]) {
+            continue;
+        }
+        uint64_t rank = 0U;
+        switch (dec->rec) {
+            case QS_QF_ACTIVE_GET:
+            case QS_QF_EQUEUE_GET:
+                rank = (l_evt[i].queued != 0U) ? 1U : 0U;
+                break;
+            case QS_QF_DELETE_REF:
+            case QS_QF_GC_ATTEMPT:
+            case QS_QF_GC:
+                rank = l_evt[i].got;
+                break;
+            default:
+                break;
+        }
+        if ((found < 0) || (rank > best)) {
+            found = i;
+            best  = rank;
+        }
+    }
+    if (found < 0) {
+        ++l_evtMismatch;
+        found = l_evtSig[k].oldest;
+    }
+    return found;
+}
+/*..........................................................................*/
+static void QSTAT_evtFree(int i) {
+    EvtInst * const ev = &l_evt[i];
+    EvtSig * const es = &l_evtSig[ev->sig];
+    if (ev->prev >= 0) {
+        l_evt[ev->prev].next = ev->next;
+    }
+    else {
+        es->oldest = ev->next;
+    }
+    if (ev->next >= 0) {
+        l_evt[ev->next].prev = ev->prev;
+    }
+    else {
+        es->newest = ev->prev;
+    }
+    if (ev->older >= 0) {
+        l_evt[ev->older].newer = ev->newer;
+    }
+    else {
+        l_evtOldest = ev->newer;
+    }
+    if (ev->newer >= 0) {
+        l_evt[ev->newer].older = ev->older;
+    }
+    else {
+        l_evtNewest = ev->older;
+    }
+    --es->live;
+    ev->next  = l_evtFree;
+    l_evtFree = (int16_t)i;
+}
+/*..........................................................................*/
+static void QSTAT_evtReset(void) {
+    while (l_evtOldest >= 0) {
+        QSTAT_evtFree(l_evtOldest);
+    }
+}
+/*..........................................................................*/
+static void QSTAT_evtReport(void) {
+    double const us = QSTAT_usPerTick();
+    uint16_t k;
+    for (k = 0U; k < l_evtIdx.n; ++k) {
+        EvtSig const * const es = &l_evtSig[k];
+        if (es->news == 0U) {
+            continue; /* only seen with the untracked events */
+        }
+        SNPRINTF_LINE("   <EVENT> Sig=%s,New=%u,Gc=%u,Live=%u",
+                      SigDictionary_get(&QSPY_sigDict, es->sig, 0, (char *)0),
+                      (unsigned)es->news, (unsigned)es->gcs,
+                      (unsigned)es->live);
+        if (es->pubs != 0U) {
+            SNPRINTF_APPEND(",Fanout<Pub=%u,Avg=%.1f,Max=%u>",
+                            (unsigned)es->pubs,
+                            (double)es->fanSum / (double)es->pubs,
+                            (unsigned)es->fanMax);
+        }
+        QSTAT_histAppend(&es->hist);
+        QSPY_printStat();
+    }
+
+    /* the instances live longer than the leak window */
+    if ((us > 0.0) && (l_evtLeakMs != 0U)) {
+        uint64_t const window = (uint64_t)((double)l_evtLeakMs * 1e3 / us);
+        uint32_t leaks = 0U;
+        int i;
+        for (i = l_evtOldest;
+             (i >= 0) && (l_clk.t - l_evt[i].tNew > window);
+             i = l_evt[i].newer)
+        {
+            if (leaks < 8U) { /* show a few of the oldest */
+                if (leaks == 0U) {
+                    SNPRINTF_LINE("   <EVENT> Leaks?(>%ums) ",
+                                  (unsigned)l_evtLeakMs);
+                }
+                else {
+                    SNPRINTF_APPEND("%s", ",");
+                }
+                EvtSig const * const es = &l_evtSig[l_evt[i].sig];
+                SNPRINTF_APPEND("%s@Rec=%" PRIu64 "(Ref=%u,Age=%.0fms)",
+                    SigDictionary_get(&QSPY_sigDict, es->sig, 0, (char *)0),
+                    l_evt[i].rec, (unsigned)l_evt[i].ref,
+                    us * (double)(l_clk.t - l_evt[i].tNew) / 1e3);
+            }
+            ++leaks;
+        }
+        if (leaks != 0U) {
+            if (leaks > 8U) {
+                SNPRINTF_APPEND(",... %u in total", (unsigned)leaks);
+            }
+            QSPY_printStat();
+        }
+    }
+    if ((l_evtDropped != 0U) || (l_evtUnknown != 0U)
+        || (l_evtMismatch != 0U) || (l_evtIdx.over != 0U))
+    {
+        SNPRINTF_LINE("   <EVENT> Dropped=%u,Untracked=%u,RefMismatch=%u",
+                      (unsigned)l_evtDropped,
+                      (unsigned)(l_evtUnknown + l_evtIdx.over),
+                      (unsigned)l_evtMismatch);
+        QSPY_printStat();
+    }
+}
+
+/*..........................................................................*/
+static void QSTAT_cpuOnDecoded(QSpyDecoded const * const dec) {
+    QSTAT_cpuAdvance(); /* the time so far goes to the running priority */
+
+    uint32_t const next = (dec->rec == QS_SCHED_IDLE) ? 0U : dec->num[0];
+    if (next > CPU_PRIO_MAX) {
+        return;
+    }
+    if (dec->rec == QS_SCHED_NEXT) { /* a: next priority, b: previous */
+        ++l_cpuAct[next];
+        ++l_cpuCurAct[next];
+        if ((dec->num[1] != 0U) && (dec->num[1] < next)
+            && (dec->num[1] <= CPU_PRIO_MAX))
+        {
+            ++l_cpuPre[dec->num[1]];
+            ++l_cpuCurPre[dec->num[1]];
+        }
+    }
+    l_cpuPrio = next;
+}
+/*..........................................................................*/
+static void QSTAT_cpuAdvance(void) {
+    if (!l_cpuOn || (l_clk.t < l_cpuT)) { /* the first or after a reset? */
+        l_cpuOn     = true;
+        l_cpuT      = l_clk.t;
+        l_cpuWinEnd = 0U;
+        return;
+    }
+    if (l_cpuWinEnd == 0U) { /* the window length not known yet? */
+        double const us = QSTAT_usPerTick();
+        if (us > 0.0) {
+            l_cpuWinTicks = (uint64_t)((double)l_cpuWinMs * 1e3 / us);
+            if (l_cpuWinTicks == 0U) {
+                l_cpuWinTicks = 1U;
+            }
+            l_cpuWinEnd   = l_cpuT + l_cpuWinTicks;
+        }
+    }
+
+    uint32_t n = 0U;
+    while ((l_cpuWinEnd != 0U) && (l_clk.t >= l_cpuWinEnd)) {
+        if (++n > CPU_GAP_MAX) { /* the gap too long to fill? */
+            l_cpuT = l_clk.t;
+            l_cpuWinEnd = l_clk.t + l_cpuWinTicks;
+            break;
+        }
+        QSTAT_cpuAccount(l_cpuWinEnd - l_cpuT);
+        l_cpuT = l_cpuWinEnd;
+        QSTAT_cpuCloseWin();
+        l_cpuWinEnd += l_cpuWinTicks;
+    }
+    QSTAT_cpuAccount(l_clk.t - l_cpuT);
+    l_cpuT = l_clk.t;
+}
+/*..........................................................................*/
+static void QSTAT_cpuAccount(uint64_t dt) {
+    l_cpuCur.busy[l_cpuPrio] += dt;
+    l_cpuTot[l_cpuPrio] += dt;
+}
+/*..........................................................................*/
+static void QSTAT_cpuCloseWin(void) {
+    ++l_cpuWinNo;
+    if (l_cpuFile != (FILE *)0) {
+        double const us = QSTAT_usPerTick();
+        char host[24]; /* empty without the clock model (e.g., file input) */
+        uint64_t hostUs;
+        host[0] = '\0';
+        if (QSTAT_clkHostUs(l_cpuWinEnd, &hostUs)) {
+            SNPRINTF_S(host, sizeof(host), "%" PRIu64, hostUs);
+        }
+        uint32_t p;
+        for (p = 0U; p <= CPU_PRIO_MAX; ++p) {
+            if ((p == 0U) || (l_cpuCur.busy[p] != 0U)
+                || (l_cpuCurAct[p] != 0U))
+            {
+                FPRINTF_S(l_cpuFile,
+                    "%" PRIu64 ",%.6f,%s,%u,%s,%.2f,%u,%u\n",
+                    l_cpuWinNo,
+                    us * (double)l_cpuWinEnd / 1e6,
+                    host,
+                    (unsigned)p,
+                    (p == 0U) ? "IDLE"
+                        : Dictionary_get(&QSPY_objDict, l_cpuObj[p],
+                                         (char *)0),
+                    100.0 * (double)l_cpuCur.busy[p]
+                        / (double)l_cpuWinTicks,
+                    (unsigned)l_cpuCurAct[p],
+                    (unsigned)l_cpuCurPre[p]);
+            }
+        }
+    }
+    l_cpuWin[l_cpuWinHead] = l_cpuCur;
+    l_cpuWinHead = (l_cpuWinHead + 1U) % CPU_WIN_N;
+    if (l_cpuWinCnt < CPU_WIN_N) {
+        ++l_cpuWinCnt;
+    }
+    memset(&l_cpuCur, 0, sizeof(l_cpuCur));
+    memset(l_cpuCurAct, 0, sizeof(l_cpuCurAct));
+    memset(l_cpuCurPre, 0, sizeof(l_cpuCurPre));
+}
+/*..........................................................................*/
+static void QSTAT_cpuReport(void) {
+    if (!l_cpuOn) {
+        return;
+    }
+    QSTAT_cpuAdvance();
+
+    /* the sliding windows: the last one, the last 10, and all kept */
+    static uint32_t const span[3] = { 1U, 10U, CPU_WIN_N };
+    static uint64_t sum[3][CPU_PRIO_MAX + 1];
+    uint64_t tot[3] = { 0U, 0U, 0U };
+    uint64_t all = 0U;
+    uint32_t k;
+    uint32_t p;
+    memset(sum, 0, sizeof(sum));
+    for (k = 0U; k < l_cpuWinCnt; ++k) {
+        CpuWin const * const win =
+            &l_cpuWin[(l_cpuWinHead + CPU_WIN_N - 1U - k) % CPU_WIN_N];
+        uint32_t j;
+        for (j = 0U; j < 3U; ++j) {
+            if (k < span[j]) {
+                for (p = 0U; p <= CPU_PRIO_MAX; ++p) {
+                    sum[j][p] += win->busy[p];
+                    tot[j]    += win->busy[p];
+                }
+            }
+        }
+    }
+    for (p = 0U; p <= CPU_PRIO_MAX; ++p) {
+        all += l_cpuTot[p];
+    }
+    if (all == 0U) {
+        return;
+    }
+
+    SNPRINTF_LINE("   <CPU>   Window=%ums,Windows=%" PRIu64,
+                  (unsigned)l_cpuWinMs, l_cpuWinNo);
+    if (l_cpuWinEnd == 0U) {
+        SNPRINTF_APPEND("%s", " (unknown timestamp rate)");
+    }
+    QSPY_printStat();
+    SNPRINTF_LINE("   <CPU>   %-4s %6s %6s %6s %6s %8s %8s %s",
+                  "Pri", "Last", "10W", "60W", "All", "Act", "Preempt",
+                  "Obj");
+    QSPY_printStat();
+    for (p = 0U; p <= CPU_PRIO_MAX; ++p) {
+        if ((l_cpuTot[p] == 0U) && (l_cpuAct[p] == 0U) && (p != 0U)) {
+            continue;
+        }
+        SNPRINTF_LINE("   <CPU>   %-4u", (unsigned)p);
+        uint32_t j;
+        for (j = 0U; j < 3U; ++j) {
+            if (tot[j] != 0U) {
+                SNPRINTF_APPEND(" %5.1f%%",
+                                100.0 * (double)sum[j][p] / (double)tot[j]);
+            }
+            else {
+                SNPRINTF_APPEND(" %6s", "-");
+            }
+        }
+        SNPRINTF_APPEND(" %5.1f%% %8u %8u %s",
+                        100.0 * (double)l_cpuTot[p] / (double)all,
+                        (unsigned)l_cpuAct[p], (unsigned)l_cpuPre[p],
+                        (p == 0U) ? "IDLE"
+                            : Dictionary_get(&QSPY_objDict, l_cpuObj[p],
+                                             (char *)0));
+        QSPY_printStat();
+    }
+}
+
+/*..........................................................................*/
+/* signed difference of the tick counters wrapping at the tevtCtrSize */
+static int32_t QSTAT_ctrDiff(uint32_t c1, uint32_t c0) {
+    uint32_t const bits = 8U * QSPY_conf.tevtCtrSize;
+    uint32_t d = c1 - c0;
+    if (bits < 32U) {
+        uint32_t const sign = (uint32_t)1U << (bits - 1U);
+        d &= (sign << 1) - 1U;
+        return (d & sign) ? (int32_t)d - (int32_t)(sign << 1) : (int32_t)d;
+    }
+    return (int32_t)d;
+}
+/*..........................................................................*/
+static void QSTAT_tickOnDecoded(QSpyDecoded const * const dec) {
+    /* a: tick counter, b: tick rate */
+    if (dec->num[1] >= TICK_RATE_MAX) {
+        return;
+    }
+    StatTick * const tick = &l_tick[dec->num[1]];
+    if (tick->haveCtr) {
+        int32_t const d = QSTAT_ctrDiff(dec->num[0], tick->ctr);
+        if (d > 1) {
+            tick->lost += (uint32_t)(d - 1);
+        }
+    }
+    tick->ctr     = dec->num[0];
+    tick->haveCtr = true;
+    ++tick->ticks;
+    l_tickPend = (int)dec->num[1];
+}
+/*..........................................................................*/
+static void QSTAT_tickTimed(StatTick * const tick) {
+    int32_t const dCtr = QSTAT_ctrDiff(tick->ctr, tick->tCtr);
+    uint32_t const dTicks = (dCtr > 0) ? (uint32_t)dCtr : 0U;
+    if (tick->timed && (l_clk.t > tick->t) && (dTicks != 0U)) {
+        uint64_t const dt = l_clk.t - tick->t;
+        tick->sumT     += dt;
+        tick->sumTicks += dTicks;
+        if (dTicks == 1U) {
+            if (tick->n >= TICK_FIT_MIN) { /* classify the period */
+                double const ratio = (double)dt / tick->mean;
+                if (ratio >= 1.5) {
+                    tick->missed += (uint32_t)floor(ratio - 0.5);
+                }
+                else if (ratio > 1.0 + TICK_LATE_PCT / 100.0) {
+                    ++tick->late;
+                }
+            }
+            ++tick->n;
+            double const d = (double)dt - tick->mean;
+            tick->mean += d / (double)tick->n;
+            tick->m2   += d * ((double)dt - tick->mean);
+            QSTAT_histAdd(&tick->hist, (uint32_t)dt, l_nRec);
+        }
+    }
+    tick->t     = l_clk.t;
+    tick->tCtr  = tick->ctr;
+    tick->timed = true;
+}
+/*..........................................................................*/
+static void QSTAT_teOnDecoded(QSpyDecoded const * const dec) {
+    /* p: time event, q: AO, b: tick rate; arming: c timeout, d interval */
+    int const i = QSTAT_index(&l_teIdx, dec->key[0]);
+    if (i < 0) {
+        return;
+    }
+    StatTimeEvt * const te = &l_te[i];
+    if (l_teIdx.added) {
+        te->obj = dec->key[0];
+    }
+    te->ao = dec->key[1];
+    if (dec->num[1] >= TICK_RATE_MAX) {
+        return;
+    }
+    te->rate = (uint8_t)dec->num[1];
+    StatTick const * const tick = &l_tick[te->rate];
+
+    switch (dec->rec) {
+        case QS_QF_TIMEEVT_ARM:
+        case QS_QF_TIMEEVT_REARM:
+            te->armed    = tick->haveCtr;
+            te->due      = tick->ctr + dec->num[2];
+            te->interval = dec->num[3];
+            te->havePost = false;
+            break;
+        case QS_QF_TIMEEVT_POST: {
+            ++te->posts;
+            if (te->armed) {
+                int32_t const late = QSTAT_ctrDiff(tick->ctr, te->due);
+                if (late > 0) {
+                    te->lateTicks += (uint32_t)late;
+                }
+                te->due   = tick->ctr + te->interval; /* reloaded */
+                te->armed = (te->interval != 0U);
+            }
+            if (te->havePost && (te->interval != 0U)
+                && (tick->sumTicks != 0U) && (l_clk.t > te->tPost))
+            {
+                double const nominal = (double)te->interval
+                    * (double)tick->sumT / (double)tick->sumTicks;
+                int64_t const jit = (int64_t)(l_clk.t - te->tPost)
+                                    - (int64_t)(nominal + 0.5);
+                if (jit < te->early) {
+                    te->early = jit;
+                }
+                if (jit > te->lateMax) {
+                    te->lateMax = jit;
+                }
+                QSTAT_histAdd(&te->hist,
+                              (uint32_t)((jit < 0) ? -jit : jit), l_nRec);
+            }
+            te->tPost    = l_clk.t;
+            te->havePost = (te->interval != 0U);
+            break;
+        }
+        case QS_QF_TIMEEVT_DISARM:
+            te->armed    = false;
+            te->havePost = false;
+            break;
+        default: /* QS_QF_TIMEEVT_AUTO_DISARM precedes the one-shot post */
+            break;
+    }
+}
+/*..........................................................................*/
+static int QSTAT_teCmp(void const *p1, void const *p2) {
+    uint32_t const w1 = l_te[*(uint16_t const *)p1].hist.worst[0];
+    uint32_t const w2 = l_te[*(uint16_t const *)p2].hist.worst[0];
+    return (w1 < w2) ? 1 : ((w1 > w2) ? -1 : 0); /* descending */
+}
+/*..........................................................................*/
+static void QSTAT_tickReport(void) {
+    double const us = QSTAT_usPerTick();
+    char const * const fmt = (us > 0.0) ? "%s=%.1fus" : "%s=%.0ft";
+    double const k = (us > 0.0) ? us : 1.0;
+    uint32_t r;
+    for (r = 0U; r < TICK_RATE_MAX; ++r) {
+        StatTick const * const tick = &l_tick[r];
+        if (tick->ticks == 0U) {
+            continue;
+        }
+        SNPRINTF_LINE("   <TICK>  Rate=%u,Ticks=%u,Lost=%u",
+                      (unsigned)r, (unsigned)tick->ticks,
+                      (unsigned)tick->lost);
+        if (tick->sumTicks != 0U) {
+            SNPRINTF_APPEND(fmt, ",Period",
+                            k * (double)tick->sumT / (double)tick->sumTicks);
+        }
+        if (tick->n > 1U) {
+            SNPRINTF_APPEND(fmt, ",Std",
+                            k * sqrt(tick->m2 / (double)(tick->n - 1U)));
+            SNPRINTF_APPEND(",Late=%u,Missed=%u",
+                            (unsigned)tick->late, (unsigned)tick->missed);
+            QSTAT_histAppend(&tick->hist);
+        }
+        QSPY_printStat();
+    }
+
+    static uint16_t order[TE_MAX];
+    uint16_t i;
+    for (i = 0U; i < l_teIdx.n; ++i) {
+        order[i] = i;
+    }
+    qsort(order, l_teIdx.n, sizeof(order[0]), &QSTAT_teCmp);
+    for (i = 0U; (i < l_teIdx.n) && (i < TE_REPORT_MAX); ++i) {
+        StatTimeEvt const * const te = &l_te[order[i]];
+        char aoName[QS_DNAME_LEN_MAX];
+        if (te->posts == 0U) {
+            continue;
+        }
+        SNPRINTF_LINE("   <TIMER> Obj=%s,AO=%s,Rate=%u,Int=%u,Posts=%u,"
+                      "LateTicks=%u",
+                      Dictionary_get(&QSPY_objDict, te->obj, (char *)0),
+                      Dictionary_get(&QSPY_objDict, te->ao, aoName),
+                      (unsigned)te->rate, (unsigned)te->interval,
+                      (unsigned)te->posts, (unsigned)te->lateTicks);
+        if (te->hist.n != 0U) {
+            SNPRINTF_APPEND(fmt, ",Early", k * (double)-te->early);
+            SNPRINTF_APPEND(fmt, ",Late", k * (double)te->lateMax);
+            QSTAT_histAppend(&te->hist);
+        }
+        QSPY_printStat();
+    }
+    if (l_teIdx.n > TE_REPORT_MAX) {
+        SNPRINTF_LINE("   <TIMER> ... %u more time events not shown",
+                      (unsigned)(l_teIdx.n - TE_REPORT_MAX));
+        QSPY_printStat();
+    }
+    if (l_teIdx.over != 0U) {
+        SNPRINTF_LINE("   <TIMER> Untracked=%u (more than %u time events)",
+                      (unsigned)l_teIdx.over, (unsigned)TE_MAX);
+        QSPY_printStat();
+    }
+}
+
+/*..........................................................................*/
+static void QSTAT_smOnDecoded(QSpyDecoded const * const dec) {
+    /* p: state machine, q: state (entry, initial target) or source,
+    * r: target of QS_QEP_TRAN
+    */
+    int const i = QSTAT_index(&l_smIdx, dec->key[0]);
+    if (i < 0) {
+        return;
+    }
+    StatSm * const sm = &l_sm[i];
+    if (l_smIdx.added) {
+        sm->obj = dec->key[0];
+        sm->cur = -1;
+    }
+    if (dec->rec == QS_QEP_STATE_ENTRY) {
+        sm->next = dec->key[1];
+        return;
+    }
+
+    /* the end of a transition (QS_QEP_TRAN or QS_QEP_INIT_TRAN) */
+    KeyType const leaf = (sm->next != 0U) ? sm->next
+                         : dec->key[(dec->rec == QS_QEP_TRAN) ? 2 : 1];
+    sm->next = 0U;
+    int const to = QSTAT_index(&l_smStIdx,
+                       leaf ^ ((KeyType)(i + 1) << 56));
+    if (to < 0) {
+        sm->cur = -1;
+        return;
+    }
+    StatSmState * const st = &l_smSt[to];
+    if (l_smStIdx.added) {
+        st->sm    = (uint16_t)i;
+        st->state = leaf;
+    }
+    uint16_t from = SMST_INIT;
+    if ((sm->cur >= 0) && (dec->rec == QS_QEP_TRAN)) {
+        uint64_t const dt = (l_clk.t > sm->t0) ? (l_clk.t - sm->t0) : 0U;
+        l_smSt[sm->cur].time += dt;
+        sm->time += dt;
+        from = (uint16_t)sm->cur;
+    }
+    int const tr = QSTAT_index(&l_smTrIdx,
+                       ((KeyType)from << 16) | (KeyType)to);
+    if (tr >= 0) {
+        if (l_smTrIdx.added) {
+            l_smTr[tr].sm   = (uint16_t)i;
+            l_smTr[tr].from = from;
+            l_smTr[tr].to   = (uint16_t)to;
+        }
+        ++l_smTr[tr].n;
+    }
+    ++sm->trans;
+    ++st->visits;
+    sm->cur = to;
+    sm->t0  = l_clk.t;
+}
+/*..........................................................................*/
+static void QSTAT_smReset(void) {
+    uint16_t i;
+    for (i = 0U; i < l_smIdx.n; ++i) {
+        l_sm[i].cur  = -1;
+        l_sm[i].next = 0U;
+    }
+}
+/*..........................................................................*/
+/* Target time in the state including the current visit */
+static uint64_t QSTAT_smStTime(uint16_t st) {
+    StatSm const * const sm = &l_sm[l_smSt[st].sm];
+    uint64_t t = l_smSt[st].time;
+    if ((sm->cur == (int)st) && (l_clk.t > sm->t0)) {
+        t += l_clk.t - sm->t0;
+    }
+    return t;
+}
+/*..........................................................................*/
+static uint64_t QSTAT_smTime(uint16_t i) {
+    StatSm const * const sm = &l_sm[i];
+    uint64_t t = sm->time;
+    if ((sm->cur >= 0) && (l_clk.t > sm->t0)) {
+        t += l_clk.t - sm->t0;
+    }
+    return t;
+}
+/*..........................................................................*/
+static int QSTAT_smStCmp(void const *p1, void const *p2) {
+    uint16_t const s1 = *(uint16_t const *)p1;
+    uint16_t const s2 = *(uint16_t const *)p2;
+    if (l_smSt[s1].sm != l_smSt[s2].sm) { /* by the SMs first... */
+        return (l_smSt[s1].sm < l_smSt[s2].sm) ? -1 : 1;
+    }
+    uint64_t const t1 = QSTAT_smStTime(s1);
+    uint64_t const t2 = QSTAT_smStTime(s2);
+    return (t1 < t2) ? 1 : ((t1 > t2) ? -1 : 0); /* ...then descending */
+}
+/*..........................................................................*/
+static int QSTAT_smTrCmp(void const *p1, void const *p2) {
+    uint32_t const n1 = l_smTr[*(uint16_t const *)p1].n;
+    uint32_t const n2 = l_smTr[*(uint16_t const *)p2].n;
+    return (n1 < n2) ? 1 : ((n1 > n2) ? -1 : 0); /* descending */
+}
+/*..........................................................................*/
+static void QSTAT_smReport(void) {
+    static uint16_t order[SMTR_MAX];
+    double const us = QSTAT_usPerTick();
+    char const * const fmt = (us > 0.0) ? "%s=%.1fus" : "%s=%.0ft";
+    double const k = (us > 0.0) ? us : 1.0;
+    char buf[QS_DNAME_LEN_MAX];
+    uint16_t i;
+    uint16_t shown = 0U;
+
+    for (i = 0U; i < l_smStIdx.n; ++i) {
+        order[i] = i;
+    }
+    qsort(order, l_smStIdx.n, sizeof(order[0]), &QSTAT_smStCmp);
+    for (i = 0U; i < l_smStIdx.n; ++i) {
+        StatSmState const * const st = &l_smSt[order[i]];
+        if ((i == 0U) || (l_smSt[order[i - 1U]].sm != st->sm)) {
+            shown = 0U; /* the next state machine */
+        }
+        if (++shown > SMST_REPORT_MAX) {
+            continue;
+        }
+        uint64_t const smT = QSTAT_smTime(st->sm);
+        uint64_t const t   = QSTAT_smStTime(order[i]);
+        SNPRINTF_LINE("   <STATE> Obj=%s,State=%s,Time=%.1f%%,Visits=%u",
+                      Dictionary_get(&QSPY_objDict, l_sm[st->sm].obj,
+                                     (char *)0),
+                      Dictionary_get(&QSPY_funDict, st->state, buf),
+                      (smT != 0U) ? 100.0 * (double)t / (double)smT : 0.0,
+                      (unsigned)st->visits);
+        if (st->visits != 0U) {
+            SNPRINTF_APPEND(fmt, ",Dwell",
+                            k * (double)t / (double)st->visits);
+        }
+        QSPY_printStat();
+    }
+
+    for (i = 0U; i < l_smTrIdx.n; ++i) {
+        order[i] = i;
+    }
+    qsort(order, l_smTrIdx.n, sizeof(order[0]), &QSTAT_smTrCmp);
+    for (i = 0U; (i < l_smTrIdx.n) && (i < SMTR_REPORT_MAX); ++i) {
+        StatSmTran const * const tr = &l_smTr[order[i]];
+        StatSm const * const sm = &l_sm[tr->sm];
+        SNPRINTF_LINE("   <TRAN>  Obj=%s,%s->",
+                      Dictionary_get(&QSPY_objDict, sm->obj, (char *)0),
+                      (tr->from == SMST_INIT) ? "init"
+                          : Dictionary_get(&QSPY_funDict,
+                                           l_smSt[tr->from].state, buf));
+        SNPRINTF_APPEND("%s,Count=%u(%.1f%%)",
+                        Dictionary_get(&QSPY_funDict, l_smSt[tr->to].state,
+                                       buf),
+                        (unsigned)tr->n,
+                        100.0 * (double)tr->n / (double)sm->trans);
+        QSPY_printStat();
+    }
+    if (l_smTrIdx.n > SMTR_REPORT_MAX) {
+        SNPRINTF_LINE("   <TRAN>  ... %u more transitions not shown",
+                      (unsigned)(l_smTrIdx.n - SMTR_REPORT_MAX));
+        QSPY_printStat();
+    }
+    if ((l_smIdx.over | l_smStIdx.over | l_smTrIdx.over) != 0U) {
+        SNPRINTF_LINE("   <STATE> Untracked=%u/%u/%u "
+                      "(more than %u SMs/%u states/%u transitions)",
+                      (unsigned)l_smIdx.over, (unsigned)l_smStIdx.over,
+                      (unsigned)l_smTrIdx.over, (unsigned)SM_MAX,
+                      (unsigned)SMST_MAX, (unsigned)SMTR_MAX);
+        QSPY_printStat();
+    }
+}
+/*..........................................................................*/
+void QSTAT_writeGraph(void *graphFile) {
+    FILE * const f = (FILE *)graphFile;
+    uint32_t nMax = 1U;
+    uint16_t i;
+
+    for (i = 0U; i < l_smTrIdx.n; ++i) {
+        if (l_smTr[i].n > nMax) {
+            nMax = l_smTr[i].n;
+        }
+    }
+    FPRINTF_S(f, "%s\n", "digraph qspy {");
+    FPRINTF_S(f, "%s\n", "    rankdir=LR;");
+    FPRINTF_S(f, "%s\n", "    node [shape=box, style=rounded];");
+    for (i = 0U; i < l_smIdx.n; ++i) {
+        uint64_t const smT = QSTAT_smTime(i);
+        uint16_t j;
+        FPRINTF_S(f, "    subgraph cluster_%u {\n", (unsigned)i);
+        FPRINTF_S(f, "        label=\"%s\";\n",
+                  Dictionary_get(&QSPY_objDict, l_sm[i].obj, (char *)0));
+        FPRINTF_S(f, "        i%u [shape=point];\n", (unsigned)i);
+        for (j = 0U; j < l_smStIdx.n; ++j) {
+            if (l_smSt[j].sm == i) {
+                FPRINTF_S(f, "        s%u [label=\"%s\\n%.1f%% %u\"];\n",
+                          (unsigned)j,
+                          Dictionary_get(&QSPY_funDict, l_smSt[j].state,
+                                         (char *)0),
+                          (smT != 0U)
+                              ? 100.0 * (double)QSTAT_smStTime(j)
+                                / (double)smT
+                              : 0.0,
+                          (unsigned)l_smSt[j].visits);
+            }
+        }
+        FPRINTF_S(f, "%s\n", "    }");
+    }
+    for (i = 0U; i < l_smTrIdx.n; ++i) {
+        StatSmTran const * const tr = &l_smTr[i];
+        if (tr->from == SMST_INIT) {
+            FPRINTF_S(f, "    i%u", (unsigned)tr->sm);
+        }
+        else {
+            FPRINTF_S(f, "    s%u", (unsigned)tr->from);
+        }
+        FPRINTF_S(f, " -> s%u [label=\"%u\", penwidth=%.1f];\n",
+                  (unsigned)tr->to, (unsigned)tr->n,
+                  1.0 + 4.0 * (double)tr->n / (double)nMax);
+    }
+    FPRINTF_S(f, "%s\n", "}");
+}
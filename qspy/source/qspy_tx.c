@@ -50,25 +50,6 @@ static uint8_t   l_dstBuf[1024]; /* for encoding from FE to Target */
 static uint8_t   l_txTargetSeq;  /* transmit Target sequence number */
 static ObjType   l_currSM;       /* current State Machine Object from FE */
 
-/****************************************************************************/
-/*! helper macro to insert an un-escaped byte into the QSPY buffer */
-#define QSPY_INSERT_BYTE(b_)                      \
-    *dst++ = (b_);                                \
-    if ((uint8_t)(dst - &dstBuf[0]) >= dstSize) { \
-        return 0U;                                \
-    }
-
-/*! helper macro to insert an escaped byte into the QS buffer */
-#define QSPY_INSERT_ESC_BYTE(b_)                  \
-    chksum = (uint8_t)(chksum + (b_));            \
-    if (((b_) != QS_FRAME) && ((b_) != QS_ESC)) { \
-        QSPY_INSERT_BYTE(b_)                      \
-    }                                             \
-    else {                                        \
-        QSPY_INSERT_BYTE(QS_ESC)                  \
-        QSPY_INSERT_BYTE((uint8_t)((b_) ^ QS_ESC_XOR)) \
-    }
-
 /*..........................................................................*/
 uint32_t QSPY_encode(uint8_t *dstBuf, uint32_t dstSize,
                    uint8_t const *srcBuf, uint32_t srcBytes)
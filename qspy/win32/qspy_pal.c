@@ -86,8 +86,10 @@ static HANDLE       l_serHNDL;
 static COMMTIMEOUTS l_timeouts;
 
 static SOCKET  l_beSock = INVALID_SOCKET;
-static fe_addr l_feAddr;
-static int     l_feAddrSize = FE_DETACHED;
+/* table of Front-Ends, FE_DETACHED size means a free entry */
+static fe_addr l_feAddr[PAL_FE_MAX];
+static int     l_feAddrSize[PAL_FE_MAX];
+static int     l_feCurr; /* Front-End of the last received packet */
 
 static SOCKET l_serverSock = INVALID_SOCKET;
 static SOCKET l_clientSock = INVALID_SOCKET;
@@ -290,6 +292,19 @@ static QSpyStatus ser_send2Target(unsigned char *buf, uint32_t nBytes) {
 static void ser_cleanup(void) {
     CloseHandle(l_serHNDL);
 }
+/*..........................................................................*/
+QSpyStatus PAL_configRxThread(uint32_t *pRingKB) {
+    (void)pRingKB; /* unused parameter */
+    return QSPY_ERROR; /* no receive thread on Windows (yet) */
+}
+/*..........................................................................*/
+void PAL_configSer(int vmin, int vtime) {
+    /* NOTE: the COMMTIMEOUTS set in PAL_openTargetSer() already return
+    * whatever is available, which VMIN/VTIME cannot improve on
+    */
+    (void)vmin;  /* unused parameter */
+    (void)vtime; /* unused parameter */
+}
 
 
 /*==========================================================================*/
@@ -638,9 +653,40 @@ QSpyStatus PAL_openBE(int portNum) {
     return QSPY_SUCCESS;
 }
 /*..........................................................................*/
+QSpyStatus PAL_openBEUnix(char const *path) {
+    SNPRINTF_LINE("   <F-END> ERROR    Unix-domain socket not supported "
+                  "Path=%s", path);
+    QSPY_printError();
+    return QSPY_ERROR;
+}
+/*..........................................................................*/
+QSpyStatus PAL_openBETcp(int portNum) {
+    SNPRINTF_LINE("   <F-END> ERROR    TCP Back-End not supported "
+                  "Port=%d", portNum);
+    QSPY_printError();
+    return QSPY_ERROR;
+}
+/*..........................................................................*/
+QSpyStatus PAL_configShmFE(int fe, bool shm) {
+    (void)fe; /* unused parameter */
+    if (!shm) {
+        return QSPY_SUCCESS;
+    }
+    SNPRINTF_LINE("   <F-END> ERROR    %s",
+                  "Shared memory not supported on this platform");
+    QSPY_printError();
+    return QSPY_ERROR;
+}
+/*..........................................................................*/
 void PAL_closeBE(void) {
     if (l_beSock != INVALID_SOCKET) {
-        if (l_feAddrSize != FE_DETACHED) { /* front-end attached? */
+        int fe;
+        for (fe = 0; fe < PAL_FE_MAX; ++fe) {
+            if (l_feAddrSize[fe] != FE_DETACHED) { /* attached? */
+                break;
+            }
+        }
+        if (fe < PAL_FE_MAX) { /* any front-end attached? */
             fd_set writeSet;
             struct timeval delay;
 
@@ -667,12 +713,13 @@ void PAL_closeBE(void) {
     WSACleanup();
 }
 /*..........................................................................*/
-void PAL_send2FE(unsigned char const *buf, uint32_t nBytes) {
-    if (l_feAddrSize != FE_DETACHED) { /* front-end attached? */
+void PAL_send2FE(int fe, unsigned char const *buf, uint32_t nBytes) {
+    if (l_feAddrSize[fe] != FE_DETACHED) { /* front-end attached? */
         if (sendto(l_beSock, (char *)buf, (int)nBytes, 0,
-                   &l_feAddr.addr, l_feAddrSize) == SOCKET_ERROR)
+                   &l_feAddr[fe].addr, l_feAddrSize[fe]) == SOCKET_ERROR)
         {
-            PAL_detachFE(); /* detach the Front-End */
+            PAL_detachFE(fe); /* detach the Front-End */
+            BE_onDetach(fe);
 
             SNPRINTF_LINE("   <F-END> ERROR    UDP socket failed Err=%d",
                           WSAGetLastError());
@@ -681,8 +728,16 @@ void PAL_send2FE(unsigned char const *buf, uint32_t nBytes) {
     }
 }
 /*..........................................................................*/
-void PAL_detachFE(void) {
-    l_feAddrSize = FE_DETACHED;
+void PAL_detachFE(int fe) {
+    l_feAddrSize[fe] = FE_DETACHED;
+}
+/*..........................................................................*/
+int PAL_currFE(void) {
+    return l_feCurr;
+}
+/*..........................................................................*/
+void PAL_flushBE(void) {
+    /* UDP packets are sent immediately */
 }
 
 /*..........................................................................*/
@@ -708,34 +763,45 @@ QSPYEvtType PAL_receiveBe(unsigned char *buf, uint32_t *pBytes) {
     if (status == SOCKET_ERROR) { /* socket error - most likely would block */
         status = WSAGetLastError();
         if (status != WSAEWOULDBLOCK) {
-            PAL_detachFE(); /* detach from the Front-End */
-
             SNPRINTF_LINE("   <F-END> ERROR    UDP socket failed Err=%d",
                           status);
             QSPY_printError();
             return QSPY_ERROR_EVT;
         }
     }
-    else if (l_feAddrSize == 0) { /* not attached yet? */
-        memcpy(&l_feAddr, &feAddr, feAddrSize);
-        l_feAddrSize = feAddrSize; /* attach connection */
-        *pBytes = (uint32_t)status;
-        return QSPY_FE_INPUT_EVT;
-    }
-    else { /* already attached */
-        /* is this from the attached front-end address? */
-        if ((feAddrSize == l_feAddrSize)
-            && (feAddr.data[1] == l_feAddr.data[1])
-            && (feAddr.data[0] == l_feAddr.data[0]))
-        {
-            *pBytes = (uint32_t)status;
-            return QSPY_FE_INPUT_EVT;
+    else {
+        int fe;
+        int feFree = PAL_FE_MAX;
+
+        /* is this from one of the attached front-end addresses? */
+        for (fe = 0; fe < PAL_FE_MAX; ++fe) {
+            if (l_feAddrSize[fe] == FE_DETACHED) {
+                if (feFree == PAL_FE_MAX) {
+                    feFree = fe; /* remember the first free entry */
+                }
+            }
+            else if ((feAddrSize == l_feAddrSize[fe])
+                && (feAddr.data[1] == l_feAddr[fe].data[1])
+                && (feAddr.data[0] == l_feAddr[fe].data[0]))
+            {
+                break;
+            }
         }
-        else {
-            SNPRINTF_LINE("   <F-END> WARN     %s", "UDP socket in use");
-            QSPY_printError();
-            /* this packet is from a DIFFERENT front-end -- ignore it */
+        if (fe == PAL_FE_MAX) { /* a new front-end? */
+            if (feFree == PAL_FE_MAX) { /* no free entries? */
+                SNPRINTF_LINE("   <F-END> WARN     %s",
+                              "UDP socket in use (too many Front-Ends)");
+                QSPY_printError();
+                /* this packet is from yet another front-end -- ignore it */
+                return QSPY_NO_EVT;
+            }
+            fe = feFree;
+            memcpy(&l_feAddr[fe], &feAddr, feAddrSize);
+            l_feAddrSize[fe] = feAddrSize; /* attach connection */
         }
+        l_feCurr = fe;
+        *pBytes = (uint32_t)status;
+        return QSPY_FE_INPUT_EVT;
     }
     return QSPY_NO_EVT;
 }
@@ -759,3 +825,15 @@ QSPYEvtType PAL_receiveKbd(unsigned char *buf, uint32_t *pBytes) {
     return QSPY_NO_EVT;
 }
 
+/*..........................................................................*/
+QSpyStatus PAL_setTimer(uint32_t periodMs) {
+    /* NOTE: the Windows event loop polls every PAL_TOUT_MS instead, so
+    * the output needs to be flushed after every event
+    */
+    (void)periodMs; /* unused parameter */
+    return QSPY_ERROR;
+}
+/*..........................................................................*/
+uint64_t PAL_rxTimeUs(void) {
+    return 0U; /* no receipt times on Windows (yet) */
+}
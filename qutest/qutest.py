@@ -40,7 +40,10 @@ if os.name == "nt":
     import msvcrt
 else:
     import select
+    import mmap
+    import array
 
+from collections import deque
 from fnmatch import fnmatchcase
 from glob import glob
 from platform import python_version
@@ -893,6 +896,17 @@ class QSpy:
     _host_addr = ["localhost", 7701] # list, to be converted to a tuple
     _local_port = 0 # let the OS decide the best local port
     _tcp_port = 6601
+    _unix_path = None # QSpy Unix-domain socket (instead of UDP)
+    _use_shm = False  # receive through the shared-memory ring from QSpy
+    _ring = None      # the shared-memory ring (ShmRing)
+    _use_tcp = False  # QSpy TCP socket (instead of UDP)
+    _rx_buf = bytearray() # TCP stream not framed into packets yet
+    _reliable = False # request retransmission of the lost packets from QSpy
+    _rx_seq = 0       # last in-order packet from QSpy (reliable mode)
+    _rx_unacked = 0   # packets received, but not acknowledged yet
+    _nack_sent = False
+    _ACK_EVERY = 16   # acknowledge every so many packets
+    _NACK_TOUT = 0.1  # ask for the lost tail after this silence [s]
 
     # formats of various packet elements from the Target
     fmt_objPtr   = "L"
@@ -912,6 +926,11 @@ class QSpy:
     _PKT_ASSERTION   = 69
     _PKT_ATTACH_CONF = 128
     _PKT_DETACH      = 129
+    _PKT_TEXT_BATCH  = 140
+    _PKT_NACK        = 143 # resync after packets lost for good
+
+    # text lines received in a batch, but not processed yet
+    _rx_lines = deque()
 
     # records to the Target...
     _TRGT_INFO       = 0
@@ -945,6 +964,8 @@ class QSpy:
     _QSPY_SEND_CURR_OBJ   = 137
     _QSPY_SEND_COMMAND    = 138
     _QSPY_SEND_TEST_PROBE = 139
+    _QSPY_ACK        = 142
+    _QSPY_NACK       = 143
 
     # gloal filter groups...
     _GRP_ALL= 0xF0
@@ -1113,6 +1134,31 @@ class QSpy:
 
     @staticmethod
     def _init():
+        if QSpy._unix_path is not None: # local Unix-domain socket?
+            try:
+                QSpy._sock = socket.socket(socket.AF_UNIX,
+                                           socket.SOCK_SEQPACKET)
+                QSpy._sock.settimeout(QUTest._TOUT)
+                QSpy._sock.connect(QSpy._unix_path)
+            except OSError:
+                print("Can't connect to the QSpy Unix socket: "
+                      + QSpy._unix_path)
+                return -1
+            return 0
+
+        if QSpy._use_tcp: # TCP connection to QSpy?
+            try:
+                QSpy._sock = socket.create_connection(QSpy._host_addr,
+                                                      QUTest._TOUT)
+                QSpy._sock.setsockopt(socket.IPPROTO_TCP,
+                                      socket.TCP_NODELAY, 1)
+            except OSError:
+                print("Can't connect to the QSpy TCP socket: %s:%d"%(
+                      QSpy._host_addr[0], QSpy._host_addr[1]))
+                return -1
+            QSpy._rx_buf = bytearray()
+            return 0
+
         # Create socket
         QSpy._sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
         QSpy._sock.settimeout(QUTest._TOUT) # timeout for blocking socket
@@ -1129,10 +1175,21 @@ class QSpy:
         return 0
 
     @staticmethod
-    def _attach(channels = 0x2):
-        # channels: 1-binary, 2-text, 3-both
-        print("Attaching to QSpy (%s:%d) ... "%(
-              QSpy._host_addr[0], QSpy._host_addr[1]), end = "")
+    def _attach(channels = 0x6):
+        # channels: 1-binary, 2-text, 3-both, 4-batched text, 8-shm ring,
+        # 16-reliable
+        if QSpy._unix_path is not None:
+            print("Attaching to QSpy (%s) ... "%(QSpy._unix_path), end = "")
+        else:
+            print("Attaching to QSpy (%s:%d) ... "%(
+                  QSpy._host_addr[0], QSpy._host_addr[1]), end = "")
+        if QSpy._use_shm:
+            channels |= 0x8
+        if QSpy._reliable:
+            channels |= 0x10
+        if QSpy._ring is not None: # QSpy creates a new ring on attach
+            QSpy._ring.close()
+            QSpy._ring = None
         QSpy._is_attached = False
         QSpy._sendTo(struct.pack("<BB", QSpy._QSPY_ATTACH, channels))
         try:
@@ -1156,14 +1213,23 @@ class QSpy:
         #QSpy._sock.shutdown(socket.SHUT_RDWR)
         QSpy._sock.close()
         QSpy._sock = None
+        if QSpy._ring is not None:
+            QSpy._ring.close()
+            QSpy._ring = None
 
     ## returns True if packet received, False if timed out
     #
     @staticmethod
     def _receive():
+        if QSpy._rx_lines: # any text lines left from the last batch?
+            rec, QUTest._last_record = QSpy._rx_lines.popleft()
+            if rec == QSpy._PKT_ASSERTION:
+                QUTest._need_reset = True
+            return True # some input received
+
         if not QUTest._is_debug:
             try:
-                packet = QSpy._sock.recv(4096)
+                packet = QSpy._recv()
             except socket.timeout:
                 QUTest._last_record = ""
                 return False # timeout
@@ -1171,7 +1237,7 @@ class QSpy:
         else:
             while True:
                 try:
-                    packet = QSpy._sock.recv(4096)
+                    packet = QSpy._recv()
                     break
                 except socket.timeout:
                     print("\nwaiting for Target "\
@@ -1201,6 +1267,15 @@ class QSpy:
             if dlen > 3 and packet[2] == QSpy._PKT_ASSERTION:
                 QUTest._need_reset = True
 
+        elif recID == QSpy._PKT_TEXT_BATCH: # batch of text lines
+            QSpy._rx_lines.extend(QSpy._unpack_batch(packet))
+            if QSpy._rx_lines:
+                rec, QUTest._last_record = QSpy._rx_lines.popleft()
+                if rec == QSpy._PKT_ASSERTION:
+                    QUTest._need_reset = True
+            else:
+                QUTest._last_record = ""
+
         elif recID == QSpy._PKT_TARGET_INFO: # target info?
             QUTest._last_record = ""
             if dlen != 18:
@@ -1239,6 +1314,110 @@ class QSpy:
 
         return True # some input received
 
+    ## receives the next packet from QSpy
+    # raises socket.timeout if nothing arrives within QUTest._TOUT
+    @staticmethod
+    def _recv():
+        if not QSpy._reliable:
+            return QSpy._recv0(QUTest._TOUT)
+
+        # reliable mode: deliver the packets strictly in sequence
+        deadline = QUTest._time() + QUTest._TOUT
+        while True:
+            tout = min(QSpy._NACK_TOUT, deadline - QUTest._time())
+            if tout <= 0:
+                raise socket.timeout()
+            try:
+                packet = QSpy._recv0(tout)
+            except socket.timeout:
+                if QSpy._is_attached: # maybe the last packets were lost
+                    QSpy._ack(QSpy._QSPY_NACK)
+                continue
+            if len(packet) < 2:
+                return packet
+
+            seq = packet[0]
+            if packet[1] == QSpy._PKT_ATTACH_CONF: # sequence starts over
+                QSpy._rx_seq = seq
+                QSpy._rx_unacked = 0
+                QSpy._nack_sent = False
+                return packet
+            if packet[1] == QSpy._PKT_NACK: # packets lost for good
+                print(QUTest._STR_EXC1 + "\nPackets lost by QSpy"
+                      + QUTest._STR_EXC2)
+                QSpy._rx_seq = seq
+                QSpy._nack_sent = False
+                continue
+            if seq == ((QSpy._rx_seq + 1) & 0xFF): # the next in sequence?
+                QSpy._rx_seq = seq
+                QSpy._nack_sent = False
+                QSpy._rx_unacked += 1
+                if QSpy._rx_unacked >= QSpy._ACK_EVERY:
+                    QSpy._ack(QSpy._QSPY_ACK)
+                return packet
+            if ((seq - QSpy._rx_seq) & 0xFF) < 0x80: # gap (not a duplicate)?
+                if QSpy._is_attached and not QSpy._nack_sent:
+                    QSpy._ack(QSpy._QSPY_NACK)
+                    QSpy._nack_sent = True
+
+    ## acknowledges all packets up to QSpy._rx_seq (cumulative),
+    # QSPY_NACK additionally asks for retransmission of all after it
+    @staticmethod
+    def _ack(kind):
+        QSpy._sendTo(struct.pack("<BB", kind, QSpy._rx_seq))
+        QSpy._rx_unacked = 0
+
+    ## receives one packet from QSpy (socket or shared-memory ring)
+    # raises socket.timeout if nothing arrives within tout [s]
+    @staticmethod
+    def _recv0(tout):
+        if QSpy._ring is not None:
+            return QSpy._ring.recv(tout)
+        QSpy._sock.settimeout(tout)
+        if QSpy._use_tcp:
+            return QSpy._recv_tcp()
+        if QSpy._use_shm and not QSpy._is_attached:
+            # the ring comes with the attach confirmation (SCM_RIGHTS)
+            packet, ancdata, flags, addr = QSpy._sock.recvmsg(
+                4096, socket.CMSG_SPACE(2 * array.array("i").itemsize))
+            for level, kind, data in ancdata:
+                if level == socket.SOL_SOCKET and kind == socket.SCM_RIGHTS:
+                    fds = array.array("i")
+                    fds.frombytes(data[:len(data) - len(data) % fds.itemsize])
+                    QSpy._ring = ShmRing(fds[0], fds[1])
+            return packet
+        return QSpy._sock.recv(4096)
+
+    ## receives one packet from the TCP stream: [len-lo][len-hi][packet]...
+    @staticmethod
+    def _recv_tcp():
+        buf = QSpy._rx_buf
+        while True:
+            if len(buf) >= 2:
+                n = buf[0] | (buf[1] << 8)
+                if len(buf) >= 2 + n:
+                    packet = bytes(buf[2:2 + n])
+                    del buf[:2 + n]
+                    return packet
+            data = QSpy._sock.recv(65536)
+            if not data:
+                raise OSError("Connection closed by QSpy")
+            buf.extend(data)
+
+    ## unpacks the batch of text lines: [rec][len(2)][text]...
+    # returns a list of (rec, text) tuples
+    @staticmethod
+    def _unpack_batch(packet):
+        lines = []
+        offset = 2 # skip the [seq][recID] header
+        dlen = len(packet)
+        while offset + 3 <= dlen:
+            rec, n = struct.unpack_from("<BH", packet, offset)
+            offset += 3
+            lines.append((rec, packet[offset:offset+n].decode("utf-8")))
+            offset += n
+        return lines
+
     @staticmethod
     def _sendTo(packet, str=None):
         tx_packet = bytearray([QSpy._tx_seq])
@@ -1246,7 +1425,12 @@ class QSpy:
         if str is not None:
             tx_packet.extend(bytes(str, "utf-8"))
             tx_packet.extend(b"\0") # zero-terminate
-        QSpy._sock.sendto(tx_packet, QSpy._host_addr)
+        if QSpy._unix_path is not None:
+            QSpy._sock.send(tx_packet)
+        elif QSpy._use_tcp:
+            QSpy._sock.sendall(struct.pack("<H", len(tx_packet)) + tx_packet)
+        else:
+            QSpy._sock.sendto(tx_packet, QSpy._host_addr)
         QSpy._tx_seq = (QSpy._tx_seq + 1) & 0xFF
         #print("sendTo", QSpy._tx_seq)
 
@@ -1271,6 +1455,64 @@ class QSpy:
                 packet.extend(parameters)
             QSpy._sendTo(packet, signal)
 
+#=============================================================================
+# Shared-memory ring from QSpy (Linux, see PAL_configShmFE() in QSpy)
+# layout: [magic][size][dropped]... [head]@64 [tail]@128 [data]@192
+# each packet: [len(2)][packet] padded to 4 bytes, len=0xFFFF wraps to 0
+#
+class ShmRing:
+    _MAGIC = 0x52505351
+    _HEAD  = 64
+    _TAIL  = 128
+    _DATA  = 192
+    _WRAP  = 0xFFFF
+    _POLL  = 0.01 # re-check the ring even without the eventfd wakeup [s]
+
+    def __init__(self, mem_fd, evt_fd):
+        self._mem = mmap.mmap(mem_fd, 0)
+        os.close(mem_fd) # the mapping remains
+        self._evt = evt_fd
+        magic, self._size = struct.unpack_from("<II", self._mem, 0)
+        if magic != ShmRing._MAGIC:
+            raise RuntimeError("Corrupted shared-memory ring from QSpy")
+
+    def close(self):
+        self._mem.close()
+        os.close(self._evt)
+
+    ## returns the next packet or None if the ring is empty
+    def poll(self):
+        head, = struct.unpack_from("<I", self._mem, ShmRing._HEAD)
+        tail, = struct.unpack_from("<I", self._mem, ShmRing._TAIL)
+        if head == tail:
+            return None
+        pos = tail & (self._size - 1)
+        n, = struct.unpack_from("<H", self._mem, ShmRing._DATA + pos)
+        if n == ShmRing._WRAP:
+            tail += self._size - pos
+            pos = 0
+            n, = struct.unpack_from("<H", self._mem, ShmRing._DATA)
+        start = ShmRing._DATA + pos + 2
+        packet = self._mem[start:start + n]
+        tail = (tail + ((2 + n + 3) & ~3)) & 0xFFFFFFFF
+        struct.pack_into("<I", self._mem, ShmRing._TAIL, tail)
+        return packet
+
+    ## returns the next packet, raises socket.timeout if none arrives in time
+    def recv(self, timeout):
+        deadline = time.time() + timeout
+        while True:
+            packet = self.poll()
+            if packet is not None:
+                return packet
+            remaining = deadline - time.time()
+            if remaining <= 0:
+                raise socket.timeout()
+            r, w, e = select.select([self._evt], [], [],
+                                    min(remaining, ShmRing._POLL))
+            if r:
+                os.read(self._evt, 8) # reset the eventfd counter
+
 
 #=============================================================================
 # main entry point to QUTest
@@ -1281,8 +1523,10 @@ def main(*args):
     arg  = 1 # skip the "qutest" argument
 
     if "-h" in argv or "--help" in argv or "?" in argv:
-        print("\nusage: python qutest.py [-x] [test-scripts] "
-              "[host_exe] [qspy_host[:udp_port]] [qspy_tcp_port]\n\n"
+        print("\nusage: python qutest.py [-x] [-r] [test-scripts] "
+              "[host_exe] [qspy_host[:udp_port]|tcp:host:port|unix:path|"
+              "shm:path] "
+              "[qspy_tcp_port]\n\n"
               "help at: https://www.state-machine.com/qtools/qutest.html")
         return sys.exit(0)
 
@@ -1304,8 +1548,11 @@ def main(*args):
     # list of scripts to exectute...
     scripts = []
 
-    if arg < argc and argv[arg] == "-x":
-        QUTest._exit_on_fail = True
+    while arg < argc and argv[arg] in ("-x", "-r"):
+        if argv[arg] == "-x":
+            QUTest._exit_on_fail = True
+        else: # reliable mode (retransmission of lost packets)
+            QSpy._reliable = True
         arg += 1
 
     # scan argv for test scripts...
@@ -1326,7 +1573,15 @@ def main(*args):
             QUTest._host_exe = ""
             QUTest._is_debug = True
     if arg < argc:
-        host_port = argv[arg].split(":")
+        if argv[arg].startswith(("unix:", "shm:")): # local QSpy socket?
+            QSpy._use_shm = argv[arg].startswith("shm:")
+            QSpy._unix_path = argv[arg].split(":", 1)[1]
+            host_port = []
+        elif argv[arg].startswith("tcp:"): # QSpy TCP socket?
+            QSpy._use_tcp = True
+            host_port = argv[arg].split(":")[1:]
+        else:
+            host_port = argv[arg].split(":")
         arg += 1
         if len(host_port) > 0:
             QSpy._host_addr[0] = host_port[0]
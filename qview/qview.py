@@ -37,6 +37,9 @@ import struct
 import os
 import traceback
 import webbrowser
+if os.name != "nt":
+    import mmap
+    import array
 
 from tkinter import *
 from tkinter.ttk import * # override the basic Tk widgets with Ttk widgets
@@ -1048,6 +1051,18 @@ class QSpy:
     _host_addr = ["localhost", 7701] # list, to be converted to a tuple
     _local_port = 0 # let the OS decide the best local port
     _after_id = None
+    _sub_objs = () # objects subscribed to with subscribe()
+    _unix_path = None # QSpy Unix-domain socket (instead of UDP)
+    _use_shm = False  # receive through the shared-memory ring from QSpy
+    _ring = None      # the shared-memory ring (ShmRing)
+    _use_tcp = False  # QSpy TCP socket (instead of UDP)
+    _rx_buf = bytearray() # TCP stream not framed into packets yet
+    _str_table = {0: ""}  # strings interned by QSpy (pre-decoded records)
+
+    # pre-decoded record from QSpy (see QSpyDecoded in qspy.h):
+    # (rec, sigIdx, sigObjIdx, reserved, tstamp, a, b, c, d, e, sigName,
+    #  p, q, r, pName, qName, rName, pad)
+    _dec_struct = struct.Struct("=BBBBI5II3Q3II")
 
     # formats of various packet elements from the Target
     _fmt_target    = "UNKNOWN"
@@ -1204,6 +1219,9 @@ class QSpy:
     _PKT_QF_RUN      = 70
     _PKT_ATTACH_CONF = 128
     _PKT_DETACH      = 129
+    _PKT_TEXT_BATCH  = 140
+    _PKT_DECODED     = 144
+    _PKT_STR_TABLE   = 145
 
     # records to the Target...
     _TRGT_INFO       = 0
@@ -1240,6 +1258,9 @@ class QSpy:
     _QSPY_SEND_COMMAND    = 138
     _QSPY_SEND_TEST_PROBE = 139
 
+    # packets to QSpy only (continued)...
+    _QSPY_SUBSCRIBE    = 141
+
     # special event sub-commands for QSPY_SEND_EVENT
     _EVT_PUBLISH   = 0
     _EVT_POST      = 253
@@ -1248,6 +1269,35 @@ class QSpy:
 
     @staticmethod
     def _init():
+        if QSpy._unix_path is not None: # local Unix-domain socket?
+            try:
+                QSpy._sock = socket.socket(socket.AF_UNIX,
+                                           socket.SOCK_SEQPACKET)
+                QSpy._sock.connect(QSpy._unix_path)
+                QSpy._sock.setblocking(0) # NON-BLOCKING socket
+            except OSError:
+                QView._showerror("Unix Socket Error",
+                   "Can't connect to the QSpy Unix socket\n"
+                   + QSpy._unix_path)
+                QView._quit(-1)
+                return -1
+            return 0
+
+        if QSpy._use_tcp: # TCP connection to QSpy (e.g., over the LAN)?
+            try:
+                QSpy._sock = socket.create_connection(QSpy._host_addr, 2.0)
+                QSpy._sock.setsockopt(socket.IPPROTO_TCP,
+                                      socket.TCP_NODELAY, 1)
+                QSpy._sock.setblocking(0) # NON-BLOCKING socket
+            except OSError:
+                QView._showerror("TCP Socket Error",
+                   "Can't connect to the QSpy TCP socket\n"
+                   "%s:%d"%(QSpy._host_addr[0], QSpy._host_addr[1]))
+                QView._quit(-1)
+                return -1
+            QSpy._rx_buf = bytearray()
+            return 0
+
         # Create socket
         QSpy._sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
         QSpy._sock.setblocking(0) # NON-BLOCKING socket
@@ -1264,14 +1314,27 @@ class QSpy:
             return -1
         return 0
 
+    # channels: 0x1-binary, 0x2-text, 0x4-batched text, 0x20-pre-decoded
+    @staticmethod
+    def _channels():
+        if getattr(QView._cust, "on_decoded", None) is not None:
+            channels = 0x20 # pre-decoded records instead of binary
+        else:
+            channels = 0x1
+        if QView._echo_text.get():
+            channels |= 0x6
+        return channels
+
     @staticmethod
     def _attach():
         QSpy._is_attached = False
         QView._have_info  = False
-        if QView._echo_text.get():
-            channels = 0x3
-        else:
-            channels = 0x1
+        channels = QSpy._channels()
+        if QSpy._use_shm:
+            channels |= 0x8
+        if QSpy._ring is not None: # QSpy creates a new ring on attach
+            QSpy._ring.close()
+            QSpy._ring = None
         QSpy._sendTo(pack("<BB", QSpy._QSPY_ATTACH, channels))
         QSpy._attach_ctr = 50
         QSpy._after_id = QView._gui.after(1, QSpy._poll0) # start poll0
@@ -1285,15 +1348,37 @@ class QSpy:
         #QSpy._sock.shutdown(socket.SHUT_RDWR)
         QSpy._sock.close()
         QSpy._sock = None
+        if QSpy._ring is not None:
+            QSpy._ring.close()
+            QSpy._ring = None
 
     @staticmethod
     def _reattach():
-        # channels: 0x1-binary, 0x2-text, 0x3-both
-        if QView._echo_text.get():
-            channels = 0x3
+        if QSpy._use_shm: # QSpy passes a new ring with the confirmation
+            QView._gui.after_cancel(QSpy._after_id)
+            QSpy._attach()
+            return
+        QSpy._sendTo(pack("<BB", QSpy._QSPY_ATTACH, QSpy._channels()))
+        QSpy._subscribe() # ATTACH resets the subscription in QSpy
+
+    # subscribe to the records and objects actually displayed, so that
+    # QSpy does not send (and QView does not parse) anything else
+    @staticmethod
+    def _subscribe():
+        if QView._echo_text.get() or QView._cust is None \
+           or getattr(QView._cust, "on_decoded", None) is not None:
+            recs = QSpy._GLB_FLT_MASK_ALL # all records are echoed
         else:
-            channels = 0x1
-        QSpy._sendTo(pack("<BB", QSpy._QSPY_ATTACH, channels))
+            recs = 0 # only the records with a handler
+            for recID in range(len(QSpy._QS)):
+                if getattr(QView._cust, QSpy._QS[recID], None) is not None:
+                    recs |= 1 << recID
+        packet = bytearray(pack("<BQQ", QSpy._QSPY_SUBSCRIBE,
+                                recs & 0xFFFFFFFFFFFFFFFF, recs >> 64))
+        for obj in QSpy._sub_objs:
+            packet.extend(bytes(obj, "utf-8"))
+            packet.extend(b"\0") # zero-terminate
+        QSpy._sendTo(packet)
 
     # poll the UDP socket until the QSpy confirms ATTACH
     @staticmethod
@@ -1306,7 +1391,7 @@ class QSpy:
             return
 
         try:
-            packet = QSpy._sock.recv(4096)
+            packet = QSpy._recv0()
             if not packet:
                 QView._showerror("UDP Socket Error",
                    "Connection closed by QSpy")
@@ -1335,6 +1420,8 @@ class QSpy:
             if QView._attach_dialog is not None:
                 QView._attach_dialog.close()
 
+            QSpy._subscribe()
+
             # send either reset or target-info request
             # (keep the poll0 loop running)
             if QView._reset_request:
@@ -1355,12 +1442,53 @@ class QSpy:
             return
 
 
+    # receive a packet while attaching; with the shared-memory ring,
+    # the ring comes with the attach confirmation (SCM_RIGHTS)
+    @staticmethod
+    def _recv0():
+        if QSpy._use_tcp:
+            return QSpy._recv_tcp()
+        if not QSpy._use_shm:
+            return QSpy._sock.recv(4096)
+        packet, ancdata, flags, addr = QSpy._sock.recvmsg(
+            4096, socket.CMSG_SPACE(2 * array.array("i").itemsize))
+        for level, kind, data in ancdata:
+            if level == socket.SOL_SOCKET and kind == socket.SCM_RIGHTS:
+                fds = array.array("i")
+                fds.frombytes(data[:len(data) - len(data) % fds.itemsize])
+                QSpy._ring = ShmRing(fds[0], fds[1])
+        return packet
+
+    # receive a packet from the TCP stream: [len-lo][len-hi][packet]...
+    # raises BlockingIOError (like the socket) until a packet is complete
+    @staticmethod
+    def _recv_tcp():
+        buf = QSpy._rx_buf
+        while True:
+            if len(buf) >= 2:
+                n = buf[0] | (buf[1] << 8)
+                if len(buf) >= 2 + n:
+                    packet = bytes(buf[2:2 + n])
+                    del buf[:2 + n]
+                    return packet
+            data = QSpy._sock.recv(65536)
+            if not data:
+                return data # connection closed by QSpy
+            buf.extend(data)
+
     # regullar poll of the UDP socket after it has attached.
     @staticmethod
     def _poll():
         while True:
             try:
-                packet = QSpy._sock.recv(4096)
+                if QSpy._ring is not None:
+                    packet = QSpy._ring.poll()
+                    if packet is None:
+                        raise BlockingIOError # like the empty socket
+                elif QSpy._use_tcp:
+                    packet = QSpy._recv_tcp()
+                else:
+                    packet = QSpy._sock.recv(4096)
                 if not packet:
                     QView._showerror("UDP Socket Error",
                                      "Connection closed by QSpy")
@@ -1389,6 +1517,38 @@ class QSpy:
                 # because the text channel is closed
                 QView.print_text(packet[3:])
 
+            elif recID == QSpy._PKT_TEXT_BATCH:
+                # [rec][len(2)][text]... after the [seq][recID] header
+                offset = 2
+                while offset + 3 <= dlen:
+                    n = packet[offset+1] | (packet[offset+2] << 8)
+                    offset += 3
+                    QView.print_text(packet[offset:offset+n])
+                    offset += n
+
+            elif recID == QSpy._PKT_STR_TABLE:
+                # [id(4)][name]\0... after the [seq][recID] header
+                offset = 2
+                while offset + 4 < dlen:
+                    (strId,) = struct.unpack_from("=I", packet, offset)
+                    end = packet.index(0, offset + 4)
+                    QSpy._str_table[strId] = \
+                        packet[offset + 4:end].decode()
+                    offset = end + 1
+
+            elif recID == QSpy._PKT_DECODED:
+                handler = getattr(QView._cust, "on_decoded", None)
+                if handler is not None:
+                    try:
+                        # the whole batch at once, see qstr()
+                        handler(list(QSpy._dec_struct.iter_unpack(
+                            memoryview(packet)[2:])))
+                    except:
+                        QView._showerror("Runtime Error",
+                                         traceback.format_exc(3))
+                        QView._quit(-3)
+                        return
+
             elif recID == QSpy._PKT_TARGET_INFO:
                 if dlen != 18:
                     QView._showerror("UDP Socket Data Error",
@@ -1470,7 +1630,12 @@ class QSpy:
             tx_packet.extend(bytes(str, "utf-8"))
             tx_packet.extend(b"\0") # zero-terminate
         try:
-            QSpy._sock.sendto(tx_packet, QSpy._host_addr)
+            if QSpy._unix_path is not None:
+                QSpy._sock.send(tx_packet)
+            elif QSpy._use_tcp:
+                QSpy._sock.sendall(pack("<H", len(tx_packet)) + tx_packet)
+            else:
+                QSpy._sock.sendto(tx_packet, QSpy._host_addr)
         except:
             QView._showerror("UDP Socket Error",
                                  traceback.format_exc(3))
@@ -1502,6 +1667,49 @@ class QSpy:
             QSpy._sendTo(packet, signal)
 
 
+#=============================================================================
+## Shared-memory ring from QSpy (Linux, see PAL_configShmFE() in QSpy)
+# layout: [magic][size][dropped]... [head]@64 [tail]@128 [data]@192
+# each packet: [len(2)][packet] padded to 4 bytes, len=0xFFFF wraps to 0
+# NOTE: QView polls the ring, so it does not need the eventfd wakeup
+#
+class ShmRing:
+    _MAGIC = 0x52505351
+    _HEAD  = 64
+    _TAIL  = 128
+    _DATA  = 192
+    _WRAP  = 0xFFFF
+
+    def __init__(self, mem_fd, evt_fd):
+        self._mem = mmap.mmap(mem_fd, 0)
+        os.close(mem_fd) # the mapping remains
+        self._evt = evt_fd
+        magic, self._size = struct.unpack_from("<II", self._mem, 0)
+        if magic != ShmRing._MAGIC:
+            raise RuntimeError("Corrupted shared-memory ring from QSpy")
+
+    def close(self):
+        self._mem.close()
+        os.close(self._evt)
+
+    ## returns the next packet or None if the ring is empty
+    def poll(self):
+        head, = struct.unpack_from("<I", self._mem, ShmRing._HEAD)
+        tail, = struct.unpack_from("<I", self._mem, ShmRing._TAIL)
+        if head == tail:
+            return None
+        pos = tail & (self._size - 1)
+        n, = struct.unpack_from("<H", self._mem, ShmRing._DATA + pos)
+        if n == ShmRing._WRAP:
+            tail += self._size - pos
+            pos = 0
+            n, = struct.unpack_from("<H", self._mem, ShmRing._DATA)
+        start = ShmRing._DATA + pos + 2
+        packet = self._mem[start:start + n]
+        tail = (tail + ((2 + n + 3) & ~3)) & 0xFFFFFFFF
+        struct.pack_into("<I", self._mem, ShmRing._TAIL, tail)
+        return packet
+
 #=============================================================================
 # DSL for QView customizations
 
@@ -1700,6 +1908,31 @@ def ao_filter(obj_id):
         QSpy._sendTo(pack("<BB" + QSpy._fmt[QSpy._size_objPtr],
             QSpy._TRGT_AO_FILTER, remove, obj_id))
 
+## @brief Limit the records sent by QSpy to the given objects.
+# @description
+# The objects are resolved by QSpy from its Object Dictionary, so this
+# should be called after the Target has produced its dictionaries
+# (e.g., from the on_reset() or on_run() callbacks). Records that are not
+# about a single object (e.g., user records) are not affected.
+# @param objs names of the objects (none means all objects)
+def subscribe(*objs):
+    QSpy._sub_objs = objs
+    if QSpy._is_attached:
+        QSpy._subscribe()
+
+## @brief Name of a string interned by QSpy for the pre-decoded records.
+# @description
+# When the customization defines on_decoded(self, recs), QView receives
+# the records pre-decoded by QSpy instead of the binary records (the
+# record handlers and on_run() are not called then). Each record in recs
+# is a tuple: (rec, sigIdx, sigObjIdx, reserved, tstamp, a, b, c, d, e,
+# sigName, p, q, r, pName, qName, rName, pad), where the numeric arguments
+# a..e and the pointers p..r are the same as in the QSpy MATLAB output.
+# @param name_id ID of the name (sigName, pName, qName or rName)
+# @returns the name or "" for unknown names
+def qstr(name_id):
+    return QSpy._str_table.get(name_id, "")
+
 ## @brief Set the Current-Object in the Target.
 # @sa qutest_dsl.current_obj()
 def current_obj(obj_kind, obj_id):
@@ -1835,7 +2068,8 @@ def main():
 
     if "-h" in argv or "--help" in argv or "?" in argv:
         print("\nUsage: python qview.pyw [custom-script] "
-            "[qspy_host[:udp_port]] [local_port]\n\n"
+            "[qspy_host[:udp_port]|tcp:host:port|unix:path|shm:path] "
+            "[local_port]\n\n"
             "help at: https://www.state-machine.com/qtools/QView.html")
         sys.exit(0)
 
@@ -1847,7 +2081,15 @@ def main():
             arg += 1
 
         if arg < argc:
-            host_port = argv[arg].split(":")
+            if argv[arg].startswith(("unix:", "shm:")): # local QSpy socket?
+                QSpy._use_shm = argv[arg].startswith("shm:")
+                QSpy._unix_path = argv[arg].split(":", 1)[1]
+                host_port = []
+            elif argv[arg].startswith("tcp:"): # QSpy TCP socket?
+                QSpy._use_tcp = True
+                host_port = argv[arg].split(":")[1:]
+            else:
+                host_port = argv[arg].split(":")
             arg += 1
             if len(host_port) > 0:
                 QSpy._host_addr[0] = host_port[0]